@@ -0,0 +1,176 @@
+#include "cache.hh"
+#include "parallel.hh"
+#include <map>
+
+namespace DAWG {
+
+  const uint64_t FNV_OFFSET     = 0xCBF29CE484222325ULL;    /// FNV-1a starting value.
+  const uint64_t FNV_PRIME      = 0x100000001B3ULL;         /// FNV-1a multiplier.
+  const size_t   ENTRY_OVERHEAD = 96;                       /// Bytes of bookkeeping counted for each entry.
+
+  /// A query's results. Entries with no bytes are free.
+  struct ResultCache::Entry {
+    uint64_t                    hash;
+    std::string                 key;
+    uint8_t                     status;
+    std::vector<std::string>    words;
+    size_t                      bytes;
+    bool                        referenced;     ///< Found since the hand last passed
+
+    Entry() : hash(0), status(0), bytes(0), referenced(false) {}
+  };
+
+  /// Part of the cache, with its own lock, entries and share of the memory.
+  struct ResultCache::Shard {
+    Mutex                       lock;
+    std::map<uint64_t, size_t>  index;          ///< Entry for each key's hash
+    std::vector<Entry>          entries;
+    std::vector<size_t>         free;           ///< Free entries
+    size_t                      hand;           ///< Next entry the clock looks at
+    size_t                      bytes;
+    size_t                      max_bytes;
+    uint64_t                    hits;
+    uint64_t                    misses;
+    uint64_t                    insertions;
+    uint64_t                    evictions;
+
+    Shard() : hand(0), bytes(0), max_bytes(0), hits(0), misses(0), insertions(0), evictions(0) {}
+
+    // Drop an entry, freeing its memory
+    void remove( size_t e ) {
+      Entry& entry = entries[e];
+      index.erase( entry.hash );
+      bytes -= entry.bytes;
+      std::string().swap( entry.key );
+      std::vector<std::string>().swap( entry.words );
+      entry.bytes       = 0;
+      entry.referenced  = false;
+      free.push_back( e );
+    }
+  };
+
+  static uint64_t hash_key( const std::string& key ) {
+    uint64_t hash = FNV_OFFSET;
+    for ( size_t i = 0; i < key.length(); ++i )
+      hash = (hash ^ (unsigned char)key[i]) * FNV_PRIME;
+    return hash;
+  }
+
+  //----------------------------------------------------------------------------//
+  // ResultCache                                                                //
+  //----------------------------------------------------------------------------//
+
+  ResultCache::ResultCache( size_t max_bytes, unsigned shards )
+    : shards_(new Shard[shards != 0 ? shards : 1]), num_shards_(shards != 0 ? shards : 1) {
+    for ( unsigned s = 0; s < num_shards_; ++s )
+      shards_[s].max_bytes = max_bytes / num_shards_;
+  }
+
+  ResultCache::~ResultCache() {
+    delete[] shards_;
+  }
+
+  // The top bits of the hash pick the shard, the whole of it the entry
+  bool ResultCache::find( const std::string& key, uint8_t* status, std::vector<std::string>* words ) {
+    uint64_t    hash    = hash_key( key );
+    Shard&      shard   = shards_[(hash >> 32) % num_shards_];
+    bool        found   = false;
+
+    shard.lock.lock();
+    std::map<uint64_t, size_t>::const_iterator i = shard.index.find( hash );
+    if ( i != shard.index.end() && shard.entries[i->second].key == key ) {
+      Entry& entry = shard.entries[i->second];
+      entry.referenced = true;
+      *status = entry.status;
+      *words  = entry.words;
+      found   = true;
+      ++shard.hits;
+    } else {
+      ++shard.misses;
+    }
+    shard.lock.unlock();
+    return found;
+  }
+
+  // Go round the clock until there's room: entries found since the hand
+  // last passed lose their mark, unmarked ones are dropped
+  void ResultCache::insert( const std::string& key, uint8_t status, const std::vector<std::string>& words ) {
+    uint64_t    hash    = hash_key( key );
+    Shard&      shard   = shards_[(hash >> 32) % num_shards_];
+    size_t      bytes   = ENTRY_OVERHEAD + key.length();
+
+    for ( size_t w = 0; w < words.size(); ++w )
+      bytes += sizeof(std::string) + words[w].length();
+    if ( bytes > shard.max_bytes )
+      return;
+
+    shard.lock.lock();
+    std::map<uint64_t, size_t>::iterator i = shard.index.find( hash );
+    if ( i != shard.index.end() )
+      shard.remove( i->second );
+    while ( shard.bytes + bytes > shard.max_bytes ) {
+      if ( shard.hand >= shard.entries.size() )
+        shard.hand = 0;
+      Entry& entry = shard.entries[shard.hand];
+      if ( entry.bytes != 0 ) {
+        if ( entry.referenced ) {
+          entry.referenced = false;
+        } else {
+          shard.remove( shard.hand );
+          ++shard.evictions;
+        }
+      }
+      ++shard.hand;
+    }
+
+    size_t e;
+    if ( !shard.free.empty() ) {
+      e = shard.free.back();
+      shard.free.pop_back();
+    } else {
+      e = shard.entries.size();
+      shard.entries.push_back( Entry() );
+    }
+    Entry& entry = shard.entries[e];
+    entry.hash          = hash;
+    entry.key           = key;
+    entry.status        = status;
+    entry.words         = words;
+    entry.bytes         = bytes;
+    entry.referenced    = false;
+    shard.index[hash]   = e;
+    shard.bytes        += bytes;
+    ++shard.insertions;
+    shard.lock.unlock();
+  }
+
+  void ResultCache::clear() {
+    for ( unsigned s = 0; s < num_shards_; ++s ) {
+      Shard& shard = shards_[s];
+      shard.lock.lock();
+      shard.index.clear();
+      std::vector<Entry>().swap( shard.entries );
+      std::vector<size_t>().swap( shard.free );
+      shard.hand  = 0;
+      shard.bytes = 0;
+      shard.lock.unlock();
+    }
+  }
+
+  void ResultCache::stats( Stats* out ) const {
+    out->hits = out->misses = out->insertions = out->evictions = 0;
+    out->entries = out->bytes = 0;
+    for ( unsigned s = 0; s < num_shards_; ++s ) {
+      Shard& shard = shards_[s];
+      shard.lock.lock();
+      out->hits       += shard.hits;
+      out->misses     += shard.misses;
+      out->insertions += shard.insertions;
+      out->evictions  += shard.evictions;
+      out->entries    += shard.index.size();
+      out->bytes      += shard.bytes;
+      shard.lock.unlock();
+    }
+  }
+
+}
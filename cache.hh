@@ -0,0 +1,74 @@
+#ifndef _CACHE_HH
+#define _CACHE_HH 1
+
+#include "dawg.hh"
+#include <string>
+#include <vector>
+
+namespace DAWG {
+
+  /// Keeps the results of recent queries, so popular ones needn't walk the
+  /// DAWG again. Keys are whatever decides a query's answer, with the
+  /// version of the dictionary it ran against (see Protocol::cache_key()),
+  /// so a reloaded dictionary simply misses until its old entries age out.
+  ///
+  /// The cache is split into shards, each behind its own lock, so threads
+  /// mostly don't wait for each other. Each shard keeps to its share of the
+  /// memory bound by CLOCK eviction: entries found since the hand last
+  /// passed get another turn, the rest are dropped.
+  class ResultCache {
+    public:
+      /// Counts of what the cache has done, summed over the shards.
+      struct Stats {
+        uint64_t    hits;
+        uint64_t    misses;
+        uint64_t    insertions;
+        uint64_t    evictions;      ///< Entries dropped to make room
+        size_t      entries;        ///< Entries held now
+        size_t      bytes;          ///< Memory they take, roughly
+
+        /// Share of lookups that hit.
+        inline double hit_rate() const { return hits + misses != 0 ? (double)hits / (hits + misses) : 0; }
+      };
+
+      ResultCache(
+          size_t        max_bytes,          ///< Memory to use at most, roughly
+          unsigned      shards = 16         ///< Number of independently locked parts
+      );
+
+      ~ResultCache();
+
+      /// Look for a key's results.
+      /// @return   whether they were found
+      bool find(
+          const std::string&        key,        ///< Key of the query
+          uint8_t*                  status,     ///< Receives the status stored with them
+          std::vector<std::string>* words       ///< Receives the words
+      );
+
+      /// Keep a query's results, in place of any under the same key. Results
+      /// too big for a shard aren't kept.
+      void insert(
+          const std::string&                key,        ///< Key of the query
+          uint8_t                           status,     ///< Status to store with them
+          const std::vector<std::string>&   words       ///< Words found
+      );
+
+      /// Drop every entry; the counts are kept.
+      void clear();
+
+      /// Get the counts.
+      void stats(
+          Stats*        out         ///< Receives the counts
+      ) const;
+
+    private:
+      struct Entry;
+      struct Shard;
+
+      Shard*        shards_;
+      unsigned      num_shards_;
+  };
+}
+
+#endif /* not _CACHE_HH */
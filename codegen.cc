@@ -0,0 +1,194 @@
+#include "codegen.hh"
+#include <algorithm>
+#include <ctype.h>
+
+namespace DAWG {
+
+  const Index NO_WORDS = 0xFFFFFFFF;    /// Marks a node whose words haven't been counted.
+
+  // Write a letter as a number, with the character alongside if it prints
+  static void put_letter( std::ostream& output, char letter ) {
+    unsigned c = (unsigned char)letter;
+    output << c;
+    if ( isprint( c ) && c != '\\' && c != '*' && c != '/' )
+      output << " /* " << letter << " */";
+  }
+
+  //----------------------------------------------------------------------------//
+  // Codegen                                                                    //
+  //----------------------------------------------------------------------------//
+
+  // Make sure there's something to match and the name will compile
+  Status Codegen::check( const DAWG& dawg, const std::string& name ) {
+    if ( dawg.num_edges() == 0 || dawg.begin().index() == 0 ) {
+      error_() << "Can't write a matcher for an empty DAWG";
+      return FAILURE;
+    }
+    bool valid = !name.empty() && !isdigit( (unsigned char)name[0] );
+    for ( size_t i = 0; i < name.length(); ++i )
+      valid = valid && (isalnum( (unsigned char)name[i] ) || name[i] == '_');
+    if ( !valid ) {
+      error_() << "\"" << name << "\" isn't a valid function name";
+      return FAILURE;
+    }
+    return SUCCESS;
+  }
+
+  // Number of words below a node
+  Index Codegen::count_words( const DAWG& dawg, Index node ) {
+    if ( node == 0 )
+      return 0;
+    if ( counts_[node] != NO_WORDS )
+      return counts_[node];
+
+    Index count = 0;
+    for ( Index i = node; ; ++i ) {
+      const Edge* edge = dawg.edge( i );
+      count += edge->end_of_word() + count_words( dawg, edge->child() );
+      if ( edge->end_of_node() )
+        break;
+    }
+    counts_[node] = count;
+    return count;
+  }
+
+  // Write the function. id counts the words that come before the current
+  // path; each case adds the words below the edges before it in the node.
+  Status Codegen::write_source( const DAWG& dawg, const std::string& name, std::ostream& output ) {
+    if ( check( dawg, name ) != SUCCESS )
+      return FAILURE;
+
+    Index root = dawg.begin().index();
+    counts_.assign( dawg.num_edges() + 1, NO_WORDS );
+    output << "// Generated by dawg_codegen from " << count_words( dawg, root ) << " words. Do not edit.\n"
+           << "\n"
+           << "#include <stddef.h>\n"
+           << "\n"
+           << "int " << name << "( const char* word, size_t length ) {\n"
+           << "  const unsigned char*  p     = (const unsigned char*)word;\n"
+           << "  const unsigned char*  end   = p + length;\n"
+           << "  int                   id    = 0;\n"
+           << "\n"
+           << "  if ( p == end )\n"
+           << "    return -1;\n";
+
+    // Lay the nodes out depth first, so a node with one edge can fall through
+    // to its child, then label only the nodes some goto jumps to
+    std::vector<Index>  order;
+    std::vector<Index>  stack( 1, root );
+    std::vector<bool>   seen( dawg.num_edges() + 1, false );
+    seen[root] = true;
+    while ( !stack.empty() ) {
+      Index node = stack.back();
+      stack.pop_back();
+      order.push_back( node );
+
+      // Children not laid out yet, the first on top
+      size_t first = stack.size();
+      for ( Index i = node; ; ++i ) {
+        Index child = dawg.edge( i )->child();
+        if ( child != 0 && !seen[child] ) {
+          seen[child] = true;
+          stack.push_back( child );
+        }
+        if ( dawg.edge( i )->end_of_node() )
+          break;
+      }
+      std::reverse( stack.begin() + first, stack.end() );
+    }
+
+    std::vector<bool>   labelled( dawg.num_edges() + 1, false );
+    for ( size_t n = 0; n < order.size(); ++n ) {
+      Index next    = n + 1 < order.size() ? order[n + 1] : 0;
+      bool  single  = dawg.edge( order[n] )->end_of_node();
+      for ( Index i = order[n]; ; ++i ) {
+        Index child = dawg.edge( i )->child();
+        if ( child != 0 && !(single && child == next) )
+          labelled[child] = true;
+        if ( dawg.edge( i )->end_of_node() )
+          break;
+      }
+    }
+
+    for ( size_t n = 0; n < order.size(); ++n ) {
+      Index node    = order[n];
+      Index next    = n + 1 < order.size() ? order[n + 1] : 0;
+      if ( labelled[node] )
+        output << "n" << node << ":\n";
+
+      bool  single  = dawg.edge( node )->end_of_node();
+      Index before  = 0;
+      if ( !single )
+        output << "  switch ( *p++ ) {\n";
+      for ( Index i = node; ; ++i ) {
+        const Edge* edge  = dawg.edge( i );
+        Index       child = edge->child();
+        const char* space = single ? "\n  " : " ";
+
+        if ( single ) {
+          output << "  if ( *p++ != ";
+          put_letter( output, edge->letter() );
+          output << " ) return -1;\n  ";
+        } else {
+          output << "    case ";
+          put_letter( output, edge->letter() );
+          output << ": ";
+        }
+        if ( child == 0 ) {
+          if ( edge->end_of_word() )
+            output << "return p == end ? id + " << before << " : -1;\n";
+          else
+            output << "return -1;\n";
+        } else {
+          if ( edge->end_of_word() )
+            output << "if ( p == end ) return id + " << before << ";";
+          else
+            output << "if ( p == end ) return -1;";
+          if ( before + edge->end_of_word() != 0 )
+            output << space << "id += " << before + edge->end_of_word() << ";";
+          if ( single && child == next )
+            output << space << "// fall through\n";
+          else
+            output << space << "goto n" << child << ";\n";
+        }
+
+        before += edge->end_of_word() + count_words( dawg, child );
+        if ( edge->end_of_node() )
+          break;
+      }
+      if ( !single )
+        output << "  }\n"
+               << "  return -1;\n";
+    }
+    output << "}\n";
+
+    if ( output.fail() ) {
+      error_() << "Couldn't write source";
+      return FAILURE;
+    }
+    return SUCCESS;
+  }
+
+  // Write the declaration
+  Status Codegen::write_header( const DAWG& dawg, const std::string& name, std::ostream& output ) {
+    if ( check( dawg, name ) != SUCCESS )
+      return FAILURE;
+
+    counts_.assign( dawg.num_edges() + 1, NO_WORDS );
+    Index num_words = count_words( dawg, dawg.begin().index() );
+    output << "// Generated by dawg_codegen from " << num_words << " words. Do not edit.\n"
+           << "\n"
+           << "#include <stddef.h>\n"
+           << "\n"
+           << "/// Look a word up in a fixed dictionary of " << num_words << " words.\n"
+           << "/// @return   its position in the dictionary, from 0, or -1 if it isn't there\n"
+           << "int " << name << "( const char* word, size_t length );\n";
+
+    if ( output.fail() ) {
+      error_() << "Couldn't write header";
+      return FAILURE;
+    }
+    return SUCCESS;
+  }
+
+}
@@ -0,0 +1,50 @@
+#ifndef _CODEGEN_HH
+#define _CODEGEN_HH 1
+
+#include "dawg.hh"
+#include <string>
+#include <vector>
+
+namespace DAWG {
+
+  /// Writes C++ source for a function that looks words up in one fixed DAWG.
+  ///
+  /// The function follows the graph with a switch on each byte, one labelled
+  /// block per node; a node shared by several words is written once and
+  /// reached by goto, so the code grows with the DAWG rather than with the
+  /// word list. It returns a word's position in DAWG order, counting from 0,
+  /// or -1 if the word isn't there. Meant for small, hot sets such as
+  /// keywords or header names, where the compiler turns each switch into a
+  /// jump table or a few compares.
+  class Codegen {
+    public:
+      /// Default constructor
+      Codegen() {}
+
+      /// Write the definition of the function.
+      Status write_source(
+          const DAWG&           dawg,       ///< Words to match
+          const std::string&    name,       ///< Name of the function
+          std::ostream&         output      ///< Stream to write to
+      );
+
+      /// Write a declaration of the function.
+      Status write_header(
+          const DAWG&           dawg,       ///< Words to match
+          const std::string&    name,       ///< Name of the function
+          std::ostream&         output      ///< Stream to write to
+      );
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      std::vector<Index>    counts_;    ///< Words below each node, NO_WORDS until known
+      Error                 error_;
+
+      Status    check( const DAWG& dawg, const std::string& name );
+      Index     count_words( const DAWG& dawg, Index node );
+  };
+}
+
+#endif /* not _CODEGEN_HH */
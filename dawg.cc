@@ -1,455 +1,1313 @@
-#include "dawg.hh"
-#include <iostream>
-
-namespace DAWG {
-
-  const uint32_t HASH_TABLE_SIZE    = 1000003;              /// Size of hash table - use a prime number.
-  const uint32_t MAX_EDGES          = (HASH_TABLE_SIZE-1);  /// Maximum number of edges that can be created.
-  const uint32_t MAX_CHARS          = 256;                  /// Maximum number of characters in a node.
-  const uint32_t MAX_WORD_LENGTH    = 32;                   /// Maximum length of a word.
-  typedef uint32_t Magic;                                   /// Special type for magic number.
-  const Magic    MAGIC_NUMBER       = 0xC6ACC231;           /// Arbitrary number to identify files we write.
-
-  //----------------------------------------------------------------------------//
-  // DAWG                                                                       //
-  //----------------------------------------------------------------------------//
-
-  // Destructor
-  DAWG::~DAWG() {
-    clear();
-  }
-
-  // Clear DAWG
-  void DAWG::clear() {
-    // Free nodes if needed
-    if (edges_ != NULL)
-      delete [] edges_;
-    edges_ = NULL;
-    // Update count
-    num_edges_ = 0;
-  }
-
-  // Load DAWG data from a stream
-  Status DAWG::load( std::istream& input ) {
-    assert( input.good() );
-    clear(); // clear any old data
-
-    std::streamsize     num_read    = 0;
-    Magic               magic       = 0;
-    Index               num_edges   = 0;
-
-    // read magic number
-    input.read( (char*)&magic, sizeof(magic) );
-    num_read = input.gcount();
-    if ( num_read != sizeof(magic) ) {
-      error_() << "Couldn't read file identifier: Expected " << sizeof(magic)
-               << " bytes but got " << num_read << ".";
-      // failure
-      return FAILURE;
-    }
-
-    // check magic number
-    if ( magic != MAGIC_NUMBER ) {
-      error_() << "File identifier mismtached: Expected " << MAGIC_NUMBER
-               << " but got " << magic;
-      return FAILURE;
-    }
-
-    // read number of edges
-    input.read( (char*)&num_edges, sizeof(num_edges) );
-    num_read = input.gcount();
-    if ( num_read != sizeof(num_edges) ) {
-      error_() << "Couldn't read number of edges: Expected " << sizeof(num_edges)
-               << " bytes but got " << num_read << ".";
-      // failure
-      return FAILURE;
-    }
-
-    // allocate space for edges
-    edges_ = new Edge[num_edges + 1];
-
-    // read in data
-    input.read( (char*)edges_, sizeof(Edge) * num_edges );
-    num_read = input.gcount(); 
-    if ( (unsigned)num_read != (sizeof(Edge) * num_edges) ) {
-      error_() << "Couldn't read edges: Expected " << (sizeof(Edge) * num_edges)
-               << " bytes but got " << num_read << ".";
-
-      // data is no good, clear it
-      clear();
-
-      // failure
-      return FAILURE;
-    }
-
-    // set edge count
-    num_edges_ = num_edges;
-
-    // init root edge
-    edge(num_edges_)->child(1);
-
-    // success
-    return SUCCESS;
-
-  }
-
-  // Load DAWG from binary data.
-  Status DAWG::load( Index num_edges, const Edge* edges ) {
-    // clear any old data
-    clear();
-    // allocate space for edges
-    edges_ = new Edge[num_edges+1];
-    // copy edges
-    memcpy( (void*) edges_, (void*) edges, sizeof(Edge) * num_edges );
-    // update edge count
-    num_edges_ = num_edges;
-    // init root edge
-    edge(num_edges_)->child(1);
-    // success
-    return SUCCESS;
-  }
-
-  // Save DAWG to stream.
-  Status DAWG::save( std::ostream& out ) {
-    // make sure the stream is good
-    assert( out.good() );
-
-    // write magic number
-    out.write( (const char*) &MAGIC_NUMBER, sizeof(MAGIC_NUMBER) );
-    if ( out.fail() ) {
-      error_() << "Couldn't write magic number";
-      return FAILURE;
-    }
-
-    // write number of nodes
-    out.write( (const char*) &num_edges_, sizeof(num_edges_) );
-    if ( out.fail() ) {
-      error_() << "Couldn't write number of edges";
-      return FAILURE;
-    }
-
-    // write node data
-    out.write( (const char*) edges_, sizeof(Edge) * num_edges_ );
-    if ( out.fail() ) {
-      error_() << "Couldn't write data";
-      return FAILURE;
-    }
-
-    // success
-    return SUCCESS;
-  }
-
-  Iterator DAWG::find_edge( char letter, const Iterator& start ) const {
-    Iterator i = start;
-    while ( i != end() ) {
-      if ( i->letter() == letter )
-        break;
-      else
-        ++i;
-    }
-
-    return i;
-  }
-
-  bool DAWG::contains_word(const std::string& word) {
-    std::string::const_iterator si;
-    Iterator                    di = begin();
-    bool                        eow = false;
-
-    for ( si = word.begin(); si != word.end(); ++si ) {
-      di  = find_edge(*si, di);
-      if ( di == end() ) {
-        return false;
-      }
-      eow = di->end_of_word();
-      di  = di.child();
-    }
-
-    return eow;
-  }
-
-
-  // Iterator pointing before first edge
-  Iterator DAWG::root() const { return Iterator( this, num_edges_ ); }
-  // Iterator pointing to first edge
-  Iterator DAWG::begin() const { return Iterator( this, 1 ); }
-  // Iterator pointing to null edge
-  Iterator DAWG::end()   const { return Iterator( this, 0 ); }
-
-  //----------------------------------------------------------------------------//
-  // DAWG Creator                                                               //
-  //----------------------------------------------------------------------------//
-
-  Creator::Creator() {
-    edges_          = NULL;
-    num_edges_      = 0;
-    hash_table_     = NULL;
-    edge_stack_     = NULL;
-    num_edges_stack_= NULL;
-    stack_pos_      = 0;
-  }
-
-  Creator::~Creator() {
-    clear();
-  }
-
-  void Creator::clear() {
-    if ( edges_ != NULL )
-      delete [] edges_;
-    edges_      = NULL;
-    num_edges_  = 0;
-
-    if ( hash_table_ != NULL )
-      delete [] hash_table_;
-    hash_table_ = NULL;
-
-    if ( edge_stack_ != NULL )
-      delete [] edge_stack_;
-    edge_stack_ = NULL;
-
-    if ( num_edges_stack_ != NULL )
-      delete [] num_edges_stack_;
-    num_edges_stack_ = NULL;
-
-    stack_pos_  = 0;
-  }
-
-  /// Initialize internal structures for creating a DAWG.
-  Status Creator::start() {
-    assert( hash_table_         == NULL );
-    assert( edges_              == NULL );
-    assert( edge_stack_         == NULL );
-    assert( num_edges_stack_    == NULL );
-
-    edges_          = new Edge[MAX_EDGES];
-    edge_stack_     = new Edge[MAX_CHARS * MAX_WORD_LENGTH];
-    hash_table_     = new Index[HASH_TABLE_SIZE];
-    memset( (void*)hash_table_, 0, sizeof(Index) * HASH_TABLE_SIZE );
-    num_edges_stack_= new Index[MAX_WORD_LENGTH];
-    memset( (void*)num_edges_stack_, 0, sizeof(Index) * MAX_WORD_LENGTH );
-    stack_pos_      = 0;
-    
-    // The first node is reserved for the null node, and the first MAX_CHARS
-    // nodes are reserved for the bottom of the tree.
-    num_edges_      = 1 + MAX_CHARS;
-
-    return SUCCESS;
-  }
-  
-  Edge* Creator::get_edge( Index stack_pos, Index edge ) {
-    return edge_stack_ + (stack_pos * MAX_CHARS + edge);
-  }
-  Edge* Creator::get_cur_edge( Index stack_pos ) {
-    return get_edge( stack_pos, num_edges_stack_[stack_pos]-1 );
-  }
-
-  /// Add a word to the DAWG.
-  Status Creator::add_word( std::string word ) {
-    // Check preconditions
-    assert( hash_table_         != NULL );
-    assert( edges_              != NULL );
-    assert( edge_stack_         != NULL );
-    assert( num_edges_stack_    != NULL );
-
-    // Make sure word will fit.
-    if ( word.length() >= MAX_WORD_LENGTH ) {
-      error_() << "Word is too long (\"" << word << "\" is " << word.length()
-               << " chars, max is " << MAX_WORD_LENGTH << ")";
-      return FAILURE;
-    }
-
-    // If stack position isn't 0
-    if ( stack_pos_ > 0 ) {
-      // Find the first different letter in the stack
-      Index i;
-      for ( i = 0; i <= stack_pos_ && i < word.length(); i++ ) {
-        if ( word[i] != get_cur_edge(i)->letter() )
-          break;
-      }
-
-      // If there's a difference before the current stack position
-      if ( i <= stack_pos_ ) {
-        //std::cout << "difference! " << word << "[" << i << "](" << word[i] << ") != " << get_cur_edge(i)->letter() << std::endl;
-        // Make sure word is in order
-        if ( word[i] < get_cur_edge(i)->letter() ) {
-          error_() << "Word out of order: " << word << "[" << i << "] (" << word[i] << " < " << get_cur_edge(i)->letter() << ")";
-          return FAILURE;
-        }
-        // Finish all nodes above the difference
-        for ( ; stack_pos_ > i; --stack_pos_ ) {
-          Status status = finish_node( stack_pos_ );
-          if ( status != SUCCESS ) {
-            return status;
-          }
-        }
-      }
-      // If there's a difference after the current stack position
-      else if ( i > stack_pos_ ) {
-        // move the stack up a level, so we 
-        // start adding letters after the end of the last word
-        ++stack_pos_;
-      }
-    }
-
-    // Add each additional letter to the stack  
-    for ( ; stack_pos_ < word.length(); ++stack_pos_ ) {
-      //std::cout << "adding " << word[stack_pos_] << " at " << stack_pos_ << std::endl;
-      ++num_edges_stack_[stack_pos_];
-      get_cur_edge(stack_pos_)->letter( word[stack_pos_] );
-    }
-    // stack_pos_ will be word.length() now (ie 1 past end), move it back
-    --stack_pos_;
-
-    //std::cout << "stack: ";
-    //for ( int i = 0 ; i <= stack_pos_ ; ++i ) {
-    //  std::cout << get_cur_edge(i)->letter();
-    //}
-    //std::cout << std::endl;
-
-    // Set end of word flag
-    get_cur_edge(stack_pos_)->end_of_word(true);
-
-    // Success
-    return SUCCESS;
-  }
-
-  DAWG* Creator::finish() {
-    // Check preconditions
-    assert( hash_table_         != NULL );
-    assert( edges_              != NULL );
-    assert( edge_stack_         != NULL );
-    assert( num_edges_stack_    != NULL );
-
-    // Finish all remaining nodes
-    for ( ; stack_pos_ > 0; --stack_pos_ ) {
-      Status status = finish_node( stack_pos_ );
-      if ( status != SUCCESS )
-        return NULL;
-    }
-
-    // Set end-of-node on last used edge
-    get_cur_edge(0)->end_of_node(true);
-
-    // Copy the bottom of the stack into into the beginning of the DAWG
-    Index i;
-    for ( i = 0; i < MAX_CHARS; ++i )
-      edges_[1+i] = *get_edge( 0, i );
-
-    // Set end-of-node on last opening edge
-    edges_[1+i-1].end_of_node(true);
-
-    // Create the DAWG
-    DAWG* new_dawg = new DAWG;
-    new_dawg->load( num_edges_, edges_ );
-
-    // Clear our data
-    clear();
-
-    // Return the DAWG
-    return new_dawg;
-  }
-
-  Status Creator::finish_node(Index pos) {
-    //std::cout << "finish_node(" << pos << ")" << std::endl;
-    // Set end-of-node on last node
-    get_cur_edge(pos)->end_of_node(true);
-
-    // Find our spot in the hash table
-    Index hash_idx;
-    Status status = find_hash_index( get_edge(pos, 0), num_edges_stack_[pos], &hash_idx );
-    if ( status != SUCCESS ) {
-      // error will be set by find_hash_index()
-      return status;
-    }
-
-    // Get the index from the hash table
-    Index idx       = hash_table_[hash_idx];
-
-    // If there's no matching node
-    if ( idx == 0 ) {
-      // Make sure DAWG isn't full
-      if ( num_edges_ + num_edges_stack_[pos] > MAX_EDGES ) {
-        error_() << "DAWG is full";
-        return FAILURE;
-      }
-
-      idx = num_edges_;
-
-      // Copy edges into DAWG
-      Index i;
-      for ( i = 0; i < num_edges_stack_[pos]; ++i ) {
-        edges_[idx + i] = *get_edge(pos, i);
-      }
-
-      // Add to hash table
-      hash_table_[hash_idx] = idx;
-
-      // Update edge count
-      num_edges_ += num_edges_stack_[pos];
-    }
-
-    // Make parent edge point to us
-    //std::cout << pos << "-1->child(" << idx <<" '" << get_edge(pos,0)->letter() << "')" << std::endl;
-    get_cur_edge(pos - 1)->child( idx );
-
-    // Clear this stack position
-    memset( (void*) get_edge(pos, 0), 0, sizeof(Edge) * MAX_CHARS );
-    num_edges_stack_[pos] = 0;
-
-    // Success
-    return SUCCESS;
-  }
-
-  Status Creator::find_hash_index( Edge* edges, Index num_edges, Index* out_hash_index ) {
-    Index idx           = compute_hash( edges, num_edges ) % HASH_TABLE_SIZE;
-    Index first_idx     = idx;
-    Index step          = 9;
-
-    //std::cout << "hash for '" << edges[0].letter() << "' = " << idx << std::endl;
-    //std::cout << "entry is --> " << hash_table_[idx] << std::endl;
-    // Loop
-    for (;;) {
-      // If there's no entry at this position, hand it back
-      if ( hash_table_[idx] == 0 ) {
-        *out_hash_index = idx;
-        return SUCCESS;
-      }
-
-      // See if the node at this entry matches
-      Index i;
-      Index start = hash_table_[idx];
-      for ( i = 0; i < num_edges; ++i )
-        if ( edges_[start + i] != edges[i] ) break;
-
-      // If so, return this index
-      if ( i == num_edges ) {
-        *out_hash_index = idx;
-        return SUCCESS;
-      }
-
-      // Otherwise, look further in the table
-      idx   += step;
-      step  += 9;
-      if ( idx >  HASH_TABLE_SIZE ) idx  -= HASH_TABLE_SIZE;
-      if ( step > HASH_TABLE_SIZE ) step -= HASH_TABLE_SIZE;
-
-      // If we're back where we started, return an error
-      if ( idx == first_idx ) {
-        error_() << "Hash table is full";
-        return FAILURE;
-      }
-    }
-    // Should never get here!
-    assert(false);
-    error_() << "Internal Error";
-    return FAILURE;
-  }
-
-  Index Creator::compute_hash( Edge* edges, Index num_edges ) {
-    Index result = 0;
-    for ( Index i = 0; i < num_edges; ++i )
-      result = ((result << 1) | (result >> 31)) ^ edges[i].data();
-    return result;
-  }
-
-}
+#include "dawg.hh"
+#include <iostream>
+#include <string.h>
+#include <deque>
+#include <fstream>
+#include <stdio.h>
+
+#ifdef __unix__
+# include <errno.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif /* __unix__ */
+
+#if defined(__GNUC__) && defined(__x86_64__)
+# define DAWG_HAVE_AVX512 1
+# include <immintrin.h>
+#endif /* __GNUC__ && __x86_64__ */
+
+namespace DAWG {
+
+  const uint32_t HASH_TABLE_SIZE    = 1000003;              /// Size of hash table - use a prime number.
+  const uint32_t MAX_EDGES          = (HASH_TABLE_SIZE-1);  /// Maximum number of edges that can be created.
+  const uint32_t MAX_CHARS          = 256;                  /// Maximum number of characters in a node.
+  const uint32_t MAX_WORD_LENGTH    = 32;                   /// Maximum length of a word.
+  typedef uint32_t Magic;                                   /// Special type for magic number.
+  const Magic    MAGIC_NUMBER       = 0xC6ACC231;           /// Identifies files saved without header padding.
+  const Magic    CHECKPOINT_MAGIC   = 0xC6ACC2C9;           /// Identifies Creator checkpoints.
+  const Magic    PAGED_MAGIC        = 0xC6ACC232;           /// Identifies files whose edges start a page in.
+  const uint32_t MAX_INDEX          = 0x003FFFFF;           /// Largest edge index a child can point to.
+  const uint32_t CACHE_LINE_SIZE    = 64;                   /// Size of a cache line in bytes.
+  const uint32_t EDGES_PER_LINE     = CACHE_LINE_SIZE / sizeof(Edge); /// Number of edges in a cache line.
+  const uint32_t PAGE_SIZE          = 4096;                 /// Size of a memory page in bytes.
+  const uint32_t EDGES_PER_PAGE     = PAGE_SIZE / sizeof(Edge); /// Number of edges in a page.
+  const uint32_t EDGE_ALIGNMENT     = PAGE_SIZE;            /// Alignment of edge data in memory.
+  const uint32_t CLUSTER_LOOKAHEAD  = 8;                    /// Queued nodes to try when filling a cache line.
+  const Index    NO_INDEX           = 0xFFFFFFFF;           /// Marks an index that hasn't been assigned.
+  const uint64_t FNV_OFFSET         = 0xCBF29CE484222325ULL; /// Starting value for FNV-1a hashes.
+  const uint64_t FNV_PRIME          = 0x100000001B3ULL;     /// Multiplier for FNV-1a hashes.
+
+  // Compare two words in DAWG order
+  int compare_words( const std::string& a, const std::string& b ) {
+    size_t length = a.length() < b.length() ? a.length() : b.length();
+    for ( size_t i = 0; i < length; ++i ) {
+      if ( a[i] != b[i] )
+        return a[i] < b[i] ? -1 : 1;
+    }
+    if ( a.length() == b.length() )
+      return 0;
+    return a.length() < b.length() ? -1 : 1;
+  }
+
+  //----------------------------------------------------------------------------//
+  // FoldTable                                                                  //
+  //----------------------------------------------------------------------------//
+
+  // Constructor
+  FoldTable::FoldTable() {
+    for ( int c = 0; c < 256; ++c )
+      table_[c] = (char)c;
+  }
+
+  // ASCII case folding
+  FoldTable FoldTable::ascii_case() {
+    FoldTable fold;
+    for ( char c = 'A'; c <= 'Z'; ++c )
+      fold.set( c, c - 'A' + 'a' );
+    return fold;
+  }
+
+  // Latin-1 case and accent folding. Letters with no plain letter underneath
+  // (ae, eth, thorn) fold to lower case; sharp s and the signs stay put.
+  FoldTable FoldTable::latin1_accents() {
+    static const char folded[] =                // 0xC0 to 0xFF
+      "aaaaaa\xE6" "ceeeeiiii"
+      "\xF0nooooo\xD7ouuuuy\xFE\xDF"
+      "aaaaaa\xE6" "ceeeeiiii"
+      "\xF0nooooo\xF7ouuuuy\xFEy";
+    FoldTable fold = ascii_case();
+    for ( int c = 0xC0; c <= 0xFF; ++c )
+      fold.set( (char)c, folded[c - 0xC0] );
+    return fold;
+  }
+
+  // Free memory for edges, however it was got
+  static void release( char* memory, size_t mapped ) {
+#ifdef __unix__
+    if ( mapped != 0 ) {
+      munmap( memory, mapped );
+      return;
+    }
+#endif /* __unix__ */
+    delete [] memory;
+  }
+
+  //----------------------------------------------------------------------------//
+  // DAWG                                                                       //
+  //----------------------------------------------------------------------------//
+
+  // Destructor
+  DAWG::~DAWG() {
+    clear();
+  }
+
+  // Clear DAWG
+  void DAWG::clear() {
+    // Free nodes if needed
+    if (memory_ != NULL)
+      release( memory_, mapped_ );
+    memory_ = NULL;
+    mapped_ = 0;
+    edges_ = NULL;
+    // Update count
+    num_edges_ = 0;
+  }
+
+  // Allocate zeroed space for edges plus the root edge. Edges are aligned so
+  // that edge indices map predictably onto cache lines.
+  void DAWG::allocate( Index num_edges ) {
+    size_t size = sizeof(Edge) * (num_edges + 1);
+    memory_ = new char[size + EDGE_ALIGNMENT - 1];
+    mapped_ = 0;
+    edges_  = (Edge*)(((size_t)memory_ + EDGE_ALIGNMENT - 1) & ~(size_t)(EDGE_ALIGNMENT - 1));
+    memset( (void*) edges_, 0, size );
+  }
+
+  // Load DAWG data from a stream
+  Status DAWG::load( std::istream& input ) {
+    assert( input.good() );
+    clear(); // clear any old data
+
+    std::streamsize     num_read    = 0;
+    Magic               magic       = 0;
+    Index               num_edges   = 0;
+
+    // read magic number
+    input.read( (char*)&magic, sizeof(magic) );
+    num_read = input.gcount();
+    if ( num_read != sizeof(magic) ) {
+      error_() << "Couldn't read file identifier: Expected " << sizeof(magic)
+               << " bytes but got " << num_read << ".";
+      // failure
+      return FAILURE;
+    }
+
+    // check magic number
+    if ( magic != PAGED_MAGIC && magic != MAGIC_NUMBER ) {
+      error_() << "File identifier mismtached: Expected " << PAGED_MAGIC
+               << " but got " << magic;
+      return FAILURE;
+    }
+
+    // read number of edges
+    input.read( (char*)&num_edges, sizeof(num_edges) );
+    num_read = input.gcount();
+    if ( num_read != sizeof(num_edges) ) {
+      error_() << "Couldn't read number of edges: Expected " << sizeof(num_edges)
+               << " bytes but got " << num_read << ".";
+      // failure
+      return FAILURE;
+    }
+
+    // skip the padding before the edges, which older files don't have
+    if ( magic == PAGED_MAGIC ) {
+      const std::streamsize padding = PAGE_SIZE - sizeof(magic) - sizeof(num_edges);
+      input.ignore( padding );
+      num_read = input.gcount();
+      if ( num_read != padding ) {
+        error_() << "Couldn't read header: Expected " << padding
+                 << " bytes of padding but got " << num_read << ".";
+        return FAILURE;
+      }
+    }
+
+    // allocate space for edges
+    allocate( num_edges );
+
+    // read in data
+    input.read( (char*)edges_, sizeof(Edge) * num_edges );
+    num_read = input.gcount(); 
+    if ( (unsigned)num_read != (sizeof(Edge) * num_edges) ) {
+      error_() << "Couldn't read edges: Expected " << (sizeof(Edge) * num_edges)
+               << " bytes but got " << num_read << ".";
+
+      // data is no good, clear it
+      clear();
+
+      // failure
+      return FAILURE;
+    }
+
+    // set edge count
+    num_edges_ = num_edges;
+
+    // init root edge
+    edge(num_edges_)->child(1);
+
+    // success
+    return SUCCESS;
+
+  }
+
+  // Load DAWG from binary data.
+  Status DAWG::load( Index num_edges, const Edge* edges ) {
+    // clear any old data
+    clear();
+    // allocate space for edges
+    allocate( num_edges );
+    // copy edges
+    memcpy( (void*) edges_, (void*) edges, sizeof(Edge) * num_edges );
+    // update edge count
+    num_edges_ = num_edges;
+    // init root edge
+    edge(num_edges_)->child(1);
+    // success
+    return SUCCESS;
+  }
+
+  // Use someone else's edges
+  void DAWG::share( const Edge* edges, Index num_edges ) {
+    clear();
+    edges_      = const_cast<Edge*>(edges);
+    num_edges_  = num_edges;
+  }
+
+  // Map a saved DAWG file
+  Status DAWG::map( const std::string& path ) {
+#ifdef __unix__
+    const size_t        header      = sizeof(Magic) + sizeof(Index);
+    char                data[header];
+    struct stat         st;
+    Magic               magic       = 0;
+    Index               num_edges   = 0;
+
+    clear();
+    int fd = open( path.c_str(), O_RDONLY );
+    if ( fd < 0 || fstat( fd, &st ) < 0 ) {
+      error_() << "Couldn't open " << path << ": " << strerror(errno);
+      if ( fd >= 0 )
+        close( fd );
+      return FAILURE;
+    }
+    if ( pread( fd, data, header, 0 ) != (ssize_t)header ) {
+      error_() << "Couldn't read header of " << path;
+      close( fd );
+      return FAILURE;
+    }
+    memcpy( &magic, data, sizeof(magic) );
+    memcpy( &num_edges, data + sizeof(magic), sizeof(num_edges) );
+    if ( magic == MAGIC_NUMBER ) {
+      // Older files start the edges just past the header, which would leave
+      // them off page and cache line boundaries, so read those into memory.
+      close( fd );
+      std::ifstream input( path.c_str(), std::ios::binary );
+      if ( !input.good() ) {
+        error_() << "Couldn't open " << path;
+        return FAILURE;
+      }
+      return load( input );
+    }
+    if ( magic != PAGED_MAGIC ) {
+      error_() << "File identifier mismtached: Expected " << PAGED_MAGIC
+               << " but got " << magic;
+      close( fd );
+      return FAILURE;
+    }
+    if ( (size_t)st.st_size != PAGE_SIZE + sizeof(Edge) * num_edges ) {
+      error_() << path << " should be " << (PAGE_SIZE + sizeof(Edge) * num_edges)
+               << " bytes but is " << st.st_size << ".";
+      close( fd );
+      return FAILURE;
+    }
+
+    // The root edge goes just past the end of the file, so reserve room for
+    // it in zeroed memory and map the file over the start. Private mappings
+    // only copy the pages we write, which is just the root edge's. Mappings
+    // start on a page, so the edges a page into the file do too.
+    size_t  size    = st.st_size + sizeof(Edge);
+    void*   memory  = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( memory == MAP_FAILED
+         || mmap( memory, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0 ) == MAP_FAILED ) {
+      error_() << "Couldn't map " << path << ": " << strerror(errno);
+      if ( memory != MAP_FAILED )
+        munmap( memory, size );
+      close( fd );
+      return FAILURE;
+    }
+    close( fd );
+
+    memory_     = (char*)memory;
+    mapped_     = size;
+    edges_      = (Edge*)(memory_ + PAGE_SIZE);
+    num_edges_  = num_edges;
+    edge(num_edges_)->child(1);
+    return SUCCESS;
+#else /* not __unix__ */
+    std::ifstream input( path.c_str(), std::ios::binary );
+    if ( !input.good() ) {
+      error_() << "Couldn't open " << path;
+      return FAILURE;
+    }
+    return load( input );
+#endif /* not __unix__ */
+  }
+
+  // Hash of the edge data, FNV-1a over each edge's bytes
+  uint64_t DAWG::fingerprint() const {
+    uint64_t hash = FNV_OFFSET;
+    for ( Index i = 0; i < num_edges_; ++i ) {
+      uint32_t data = edges_[i].data();
+      for ( int b = 0; b < 4; ++b, data >>= 8 )
+        hash = (hash ^ (data & 0xFF)) * FNV_PRIME;
+    }
+    return hash;
+  }
+
+  // Save DAWG to stream.
+  Status DAWG::save( std::ostream& out ) {
+    // make sure the stream is good
+    assert( out.good() );
+
+    // the file format has nowhere to say where else the root might be
+    if ( begin().index() != 1 ) {
+      error_() << "Can't save a DAWG whose root node isn't first";
+      return FAILURE;
+    }
+
+    // write magic number
+    out.write( (const char*) &PAGED_MAGIC, sizeof(PAGED_MAGIC) );
+    if ( out.fail() ) {
+      error_() << "Couldn't write magic number";
+      return FAILURE;
+    }
+
+    // write number of nodes
+    out.write( (const char*) &num_edges_, sizeof(num_edges_) );
+    if ( out.fail() ) {
+      error_() << "Couldn't write number of edges";
+      return FAILURE;
+    }
+
+    // pad the header out to a page, so that the edges keep their alignment
+    // when the file is mapped
+    const char padding[PAGE_SIZE - sizeof(PAGED_MAGIC) - sizeof(num_edges_)] = { 0 };
+    out.write( padding, sizeof(padding) );
+    if ( out.fail() ) {
+      error_() << "Couldn't write header";
+      return FAILURE;
+    }
+
+    // write node data
+    out.write( (const char*) edges_, sizeof(Edge) * num_edges_ );
+    if ( out.fail() ) {
+      error_() << "Couldn't write data";
+      return FAILURE;
+    }
+
+    // success
+    return SUCCESS;
+  }
+
+  Iterator DAWG::find_edge( char letter, const Iterator& start ) const {
+    Iterator i = start;
+    while ( i != end() ) {
+      if ( i->letter() == letter )
+        break;
+      else
+        ++i;
+    }
+
+    return i;
+  }
+
+  bool DAWG::contains_word(const std::string& word) const {
+    std::string::const_iterator si;
+    Iterator                    di = begin();
+    bool                        eow = false;
+
+    for ( si = word.begin(); si != word.end(); ++si ) {
+      di  = find_edge(*si, di);
+      if ( di == end() ) {
+        return false;
+      }
+      eow = di->end_of_word();
+      di  = di.child();
+    }
+
+    return eow;
+  }
+
+  // The first edge from i on, in i's node, whose letter matches
+  // @return  its index, or 0 if there is none
+  Index DAWG::find_folded( Index i, char letter, const FoldTable& fold ) const {
+    for ( ; i != 0; ++i ) {
+      if ( fold.match( edges_[i].letter(), letter ) )
+        return i;
+      if ( edges_[i].end_of_node() )
+        return 0;
+    }
+    return 0;
+  }
+
+  // Depth-first over every path that matches, keeping the edge being tried
+  // at each depth so we can back up and try its matching siblings
+  bool DAWG::contains_word( const std::string& word, const FoldTable& fold ) const {
+    Index   stack[MAX_WORD_LENGTH];
+    size_t  depth   = 0;
+
+    if ( word.empty() || word.length() >= MAX_WORD_LENGTH || edges_ == NULL )
+      return false;
+    stack[0] = find_folded( begin().index(), word[0], fold );
+    for ( ; ; ) {
+      Index i = stack[depth];
+      if ( i != 0 ) {
+        const Edge& edge = edges_[i];
+        if ( depth + 1 == word.length() ) {
+          if ( edge.end_of_word() )
+            return true;
+        } else if ( edge.child() != 0 ) {
+          ++depth;
+          stack[depth] = find_folded( edge.child(), word[depth], fold );
+          continue;
+        }
+      } else {
+        // Nothing left at this depth
+        if ( depth == 0 )
+          return false;
+        i = stack[--depth];
+      }
+      stack[depth] = edges_[i].end_of_node() ? 0 : find_folded( i + 1, word[depth], fold );
+    }
+  }
+
+
+  // Number of edges in the node starting at an edge
+  Index DAWG::node_size( Index start ) const {
+    Index i = start;
+    while ( !edge(i)->end_of_node() )
+      ++i;
+    return i - start + 1;
+  }
+
+  // List the first edge of every node reachable from the root, breadth-first
+  void DAWG::collect_nodes( std::vector<Index>* starts ) const {
+    std::vector<bool> seen( num_edges_ + 1, false );
+
+    starts->clear();
+    starts->push_back( begin().index() );
+    seen[begin().index()] = true;
+    for ( size_t n = 0; n < starts->size(); ++n ) {
+      for ( Index i = (*starts)[n]; ; ++i ) {
+        Index child = edge(i)->child();
+        if ( child != 0 && !seen[child] ) {
+          seen[child] = true;
+          starts->push_back( child );
+        }
+        if ( edge(i)->end_of_node() )
+          break;
+      }
+    }
+  }
+
+  // Move every node to a new position. new_start maps the old first edge of
+  // each reachable node to its new one; the root has to stay where it is.
+  Status DAWG::relayout( const std::vector<Index>& new_start, Index num_edges ) {
+    assert( new_start[begin().index()] == begin().index() );
+
+    if ( num_edges > MAX_INDEX ) {
+      error_() << "Layout needs " << num_edges << " edges, max is " << MAX_INDEX;
+      return FAILURE;
+    }
+
+    char*   old_memory  = memory_;
+    size_t  old_mapped  = mapped_;
+    Edge*   old_edges   = edges_;
+
+    allocate( num_edges );
+    for ( Index start = 0; start < new_start.size(); ++start ) {
+      if ( new_start[start] == NO_INDEX )
+        continue;
+      for ( Index i = 0; ; ++i ) {
+        Edge e = old_edges[start + i];
+        if ( e.child() != 0 )
+          e.child( new_start[e.child()] );
+        edges_[new_start[start] + i] = e;
+        if ( e.end_of_node() )
+          break;
+      }
+    }
+
+    release( old_memory, old_mapped );
+
+    // update edge count
+    num_edges_ = num_edges;
+    // init root edge
+    edge(num_edges_)->child(1);
+    // success
+    return SUCCESS;
+  }
+
+  // Move a position to the start of the next cache line, keeping what's left
+  // of the current one as a hole.
+  static void skip_to_line( Index* cursor, std::vector< std::vector<Index> >* holes ) {
+    Index left = EDGES_PER_LINE - *cursor % EDGES_PER_LINE;
+    if ( left != EDGES_PER_LINE ) {
+      (*holes)[left].push_back( *cursor );
+      *cursor += left;
+    }
+  }
+
+  // Bin-pack nodes into cache lines
+  Status DAWG::align_nodes() {
+    std::vector<Index>  starts;
+    collect_nodes( &starts );
+
+    // Bucket nodes by size, keeping breadth-first order within a bucket. The
+    // root stays first, so it's left out.
+    std::vector< std::vector<Index> > by_size;
+    for ( size_t n = 1; n < starts.size(); ++n ) {
+      Index size = node_size( starts[n] );
+      if ( size >= by_size.size() )
+        by_size.resize( size + 1 );
+      by_size[size].push_back( starts[n] );
+    }
+
+    // holes[n] holds positions with n free edges before the next line boundary
+    std::vector< std::vector<Index> > holes( EDGES_PER_LINE );
+    std::vector<Index>  new_start( num_edges_ + 1, NO_INDEX );
+    Index               root    = begin().index();
+    Index               cursor  = root + node_size( root );
+    Index               end     = cursor;
+
+    new_start[root] = root;
+    skip_to_line( &cursor, &holes );
+    // Place nodes largest first
+    for ( size_t size = by_size.size(); size-- > 1; ) {
+      for ( size_t n = 0; n < by_size[size].size(); ++n ) {
+        Index   pos = NO_INDEX;
+
+        // Best fit into an existing hole
+        for ( Index free = size; free < EDGES_PER_LINE; ++free ) {
+          if ( !holes[free].empty() ) {
+            pos = holes[free].back();
+            holes[free].pop_back();
+            if ( free > size )
+              holes[free - size].push_back( pos + size );
+            break;
+          }
+        }
+
+        // Otherwise start a new line
+        if ( pos == NO_INDEX ) {
+          pos     = cursor;
+          cursor += size;
+          skip_to_line( &cursor, &holes );
+        }
+
+        new_start[by_size[size][n]] = pos;
+        if ( pos + size > end )
+          end = pos + size;
+      }
+    }
+
+    return relayout( new_start, end );
+  }
+
+  /// Orders nodes into pages and cache lines of connected subgraphs.
+  ///
+  /// A line is filled depth-first from the nodes already in it, so it holds a
+  /// short chain of levels. After that it takes nodes from the rest of the
+  /// page's subgraph breadth-first, and only then starts a new subgraph. Nodes
+  /// a page doesn't reach become the roots of later pages.
+  class NodeClusterer {
+    public:
+      NodeClusterer(
+          const DAWG&                 dawg,
+          const std::vector<Index>&   sizes,
+          std::vector<Index>*         new_start
+      ) : dawg_(dawg), sizes_(sizes), new_start_(*new_start), cursor_(0), end_(0) {}
+
+      /// Lay out everything reachable from the root.
+      /// @return   the number of edges used
+      Index run( Index root ) {
+        cursor_ = root;
+        place( root, &frontier_ );
+        for (;;) {
+          Index space = EDGES_PER_LINE - cursor_ % EDGES_PER_LINE;
+          Index node  = NO_INDEX;
+
+          // Children of this line, then of this page, then a new subgraph
+          while ( node == NO_INDEX && !line_.empty() ) {
+            node = line_.back();
+            line_.pop_back();
+            if ( placed(node) ) {
+              node = NO_INDEX;
+            } else if ( sizes_[node] > space ) {
+              frontier_.push_back( node );
+              node = NO_INDEX;
+            }
+          }
+          if ( node == NO_INDEX )
+            node = take( &frontier_, space );
+          if ( node == NO_INDEX && frontier_.empty() )
+            node = take( &seeds_, space );
+          if ( node != NO_INDEX ) {
+            place( node, &line_ );
+            continue;
+          }
+
+          std::deque<Index>* queue = frontier_.empty() ? &seeds_ : &frontier_;
+          if ( queue->empty() )
+            break;
+
+          // Nothing fits. At the start of a line that means the next node needs
+          // more than one, so give it as many as it needs.
+          if ( space == EDGES_PER_LINE ) {
+            node = queue->front();
+            queue->pop_front();
+            if ( !placed(node) ) {
+              if ( sizes_[node] > EDGES_PER_PAGE - cursor_ % EDGES_PER_PAGE )
+                next_page();
+              place( node, &line_ );
+            }
+            continue;
+          }
+
+          // Otherwise pad out the line
+          cursor_ += space;
+          if ( cursor_ % EDGES_PER_PAGE == 0 )
+            next_page();
+        }
+        return end_;
+      }
+
+    private:
+      const DAWG&                 dawg_;
+      const std::vector<Index>&   sizes_;       ///< Node sizes by first edge
+      std::vector<Index>&         new_start_;   ///< New position by first edge
+      std::deque<Index>           line_;        ///< Children of the current line
+      std::deque<Index>           frontier_;    ///< Children of the current page
+      std::deque<Index>           seeds_;       ///< Roots for later pages
+      Index                       cursor_;
+      Index                       end_;
+
+      inline bool placed( Index node ) const { return new_start_[node] != NO_INDEX; }
+
+      /// Place a node at the cursor and queue its children.
+      void place( Index node, std::deque<Index>* children ) {
+        Index page = cursor_ / EDGES_PER_PAGE;
+
+        new_start_[node] = cursor_;
+        cursor_ += sizes_[node];
+        if ( cursor_ > end_ )
+          end_ = cursor_;
+        for ( Index i = node; ; ++i ) {
+          Index child = dawg_.edge(i)->child();
+          if ( child != 0 && !placed(child) )
+            children->push_back( child );
+          if ( dawg_.edge(i)->end_of_node() )
+            break;
+        }
+        if ( cursor_ / EDGES_PER_PAGE != page )
+          next_page();
+      }
+
+      /// Take the first of the next few queued nodes that fits in space.
+      Index take( std::deque<Index>* queue, Index space ) {
+        for ( size_t i = 0; i < queue->size() && i < CLUSTER_LOOKAHEAD; ) {
+          Index node = (*queue)[i];
+          if ( placed(node) ) {
+            queue->erase( queue->begin() + i );
+          } else if ( sizes_[node] <= space ) {
+            queue->erase( queue->begin() + i );
+            return node;
+          } else {
+            ++i;
+          }
+        }
+        return NO_INDEX;
+      }
+
+      /// Move to the start of the next page. Whatever this page didn't reach
+      /// is left for later ones.
+      void next_page() {
+        if ( cursor_ % EDGES_PER_PAGE != 0 )
+          cursor_ += EDGES_PER_PAGE - cursor_ % EDGES_PER_PAGE;
+        seeds_.insert( seeds_.end(), line_.begin(), line_.end() );
+        seeds_.insert( seeds_.end(), frontier_.begin(), frontier_.end() );
+        line_.clear();
+        frontier_.clear();
+      }
+  };
+
+  // Cluster nodes into pages and cache lines
+  Status DAWG::cluster_nodes() {
+    std::vector<Index>  starts;
+    std::vector<Index>  sizes( num_edges_ + 1, 0 );
+    std::vector<Index>  new_start( num_edges_ + 1, NO_INDEX );
+
+    collect_nodes( &starts );
+    for ( size_t n = 0; n < starts.size(); ++n )
+      sizes[starts[n]] = node_size( starts[n] );
+
+    NodeClusterer clusterer( *this, sizes, &new_start );
+    return relayout( new_start, clusterer.run( begin().index() ) );
+  }
+
+  // Measure the current node layout
+  void DAWG::layout_stats( LayoutStats* stats ) const {
+    std::vector<Index>  starts;
+    Index               used = 1; // the null edge
+
+    collect_nodes( &starts );
+    stats->num_nodes    = starts.size();
+    stats->split_nodes  = 0;
+    stats->line_jumps   = 0;
+    stats->page_jumps   = 0;
+    for ( size_t n = 0; n < starts.size(); ++n ) {
+      Index size = node_size( starts[n] );
+      Index last = starts[n] + size - 1;
+      if ( size <= EDGES_PER_LINE && starts[n] / EDGES_PER_LINE != last / EDGES_PER_LINE )
+        ++stats->split_nodes;
+      for ( Index i = starts[n]; i <= last; ++i ) {
+        Index child = edge(i)->child();
+        if ( child == 0 )
+          continue;
+        if ( i / EDGES_PER_LINE != child / EDGES_PER_LINE )
+          ++stats->line_jumps;
+        if ( i / EDGES_PER_PAGE != child / EDGES_PER_PAGE )
+          ++stats->page_jumps;
+      }
+      used += size;
+    }
+    stats->padding = num_edges_ - used;
+  }
+
+#ifdef DAWG_HAVE_AVX512
+  const uint32_t SIMD_LANES         = 16;                   /// Words looked up at once by the AVX-512 kernel.
+
+  // Look up words 16 at a time. Each lane holds one word's current edge and
+  // position. Every round gathers the lanes' edges and letters; lanes that
+  // match move to the child, lanes that don't move to the next edge in the
+  // node, and lanes that reach the end of their word or node drop out.
+  __attribute__((target("avx512f")))
+  static void contains_words_avx512( const DAWG& dawg, const std::string* words, size_t count, bool* results ) {
+    // Take the bit layout from Edge itself
+    const uint32_t eow          = Edge(0, true).data();
+    const uint32_t eon          = Edge(0, false, true).data();
+    const uint32_t child        = Edge(0, false, false, MAX_INDEX).data();
+    const __m512i letter_mask   = _mm512_set1_epi32( ~(eow | eon | child) );
+    const __m512i eow_bit       = _mm512_set1_epi32( eow );
+    const __m512i eon_bit       = _mm512_set1_epi32( eon );
+    const __m512i child_mask    = _mm512_set1_epi32( child );
+    const __m512i zero          = _mm512_setzero_si512();
+    const __m512i one           = _mm512_set1_epi32( 1 );
+    const __m512i row_offsets   = _mm512_mullo_epi32( _mm512_set_epi32( 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 ),
+                                                      _mm512_set1_epi32( MAX_WORD_LENGTH ) );
+    const int      child_shift  = __builtin_ctz( child );
+
+    // One row of letters per lane, plus slack for the 4-byte gathers
+    uint8_t     letters[SIMD_LANES * MAX_WORD_LENGTH + sizeof(uint32_t)];
+    uint32_t    lengths[SIMD_LANES];
+
+    for ( size_t first = 0; first < count; first += SIMD_LANES ) {
+      __mmask16 active = 0;
+
+      for ( Index lane = 0; lane < SIMD_LANES; ++lane ) {
+        lengths[lane] = 0;
+        if ( first + lane >= count )
+          continue;
+        const std::string& word = words[first + lane];
+        results[first + lane] = false;
+        if ( word.empty() )
+          continue;
+        if ( word.length() >= MAX_WORD_LENGTH ) {
+          // Doesn't fit in a row, look it up on its own
+          results[first + lane] = dawg.contains_word( word );
+          continue;
+        }
+        memcpy( letters + lane * MAX_WORD_LENGTH, word.data(), word.length() );
+        lengths[lane] = word.length();
+        active |= 1 << lane;
+      }
+
+      __m512i   edge    = _mm512_set1_epi32( dawg.begin().index() );
+      __m512i   pos     = zero;
+      __m512i   length  = _mm512_loadu_si512( lengths );
+      __mmask16 found   = 0;
+
+      while ( active ) {
+        __m512i   data    = _mm512_mask_i32gather_epi32( zero, active, edge, dawg.edge(0), 4 );
+        __m512i   letter  = _mm512_mask_i32gather_epi32( zero, active, _mm512_add_epi32( row_offsets, pos ), letters, 1 );
+        __mmask16 match   = _mm512_mask_cmpeq_epi32_mask( active,
+                                                          _mm512_and_si512( data, letter_mask ),
+                                                          _mm512_and_si512( letter, letter_mask ) );
+        __mmask16 miss    = active & ~match;
+
+        // Matched the last letter: found if a word ends here
+        __m512i   next    = _mm512_add_epi32( pos, one );
+        __mmask16 last    = _mm512_mask_cmpeq_epi32_mask( match, next, length );
+        found  |= _mm512_mask_test_epi32_mask( last, data, eow_bit );
+
+        // Matched another letter: follow the child, unless there isn't one
+        __mmask16 follow  = _mm512_mask_test_epi32_mask( match & ~last, data, child_mask );
+        edge   = _mm512_mask_srli_epi32( edge, follow, data, child_shift );
+        pos    = _mm512_mask_mov_epi32( pos, follow, next );
+
+        // Missed: try the next edge, unless this was the node's last
+        __mmask16 step    = _mm512_mask_testn_epi32_mask( miss, data, eon_bit );
+        edge   = _mm512_mask_add_epi32( edge, step, edge, one );
+
+        active = follow | step;
+      }
+
+      for ( Index lane = 0; lane < SIMD_LANES && first + lane < count; ++lane ) {
+        if ( found & (1 << lane) )
+          results[first + lane] = true;
+      }
+    }
+  }
+#endif /* DAWG_HAVE_AVX512 */
+
+  void DAWG::contains_words( const std::string* words, size_t count, bool* results ) const {
+#ifdef DAWG_HAVE_AVX512
+    if ( __builtin_cpu_supports("avx512f") ) {
+      contains_words_avx512( *this, words, count, results );
+      return;
+    }
+#endif /* DAWG_HAVE_AVX512 */
+    for ( size_t i = 0; i < count; ++i )
+      results[i] = contains_word( words[i] );
+  }
+
+  // Iterator pointing before first edge
+  Iterator DAWG::root() const { return Iterator( this, num_edges_ ); }
+  // Iterator pointing to first edge
+  Iterator DAWG::begin() const { return Iterator( this, edges_ != NULL ? edges_[num_edges_].child() : 1 ); }
+  // Iterator pointing to null edge
+  Iterator DAWG::end()   const { return Iterator( this, 0 ); }
+
+  //----------------------------------------------------------------------------//
+  // DAWG Creator                                                               //
+  //----------------------------------------------------------------------------//
+
+  Creator::Creator() {
+    edges_          = NULL;
+    num_edges_      = 0;
+    hash_table_     = NULL;
+    edge_stack_     = NULL;
+    num_edges_stack_= NULL;
+    stack_pos_      = 0;
+    num_words_      = 0;
+    lenient_        = false;
+    error_code_     = ERROR_NONE;
+    error_pos_      = 0;
+    error_letter_   = 0;
+    memset( (void*)skipped_, 0, sizeof(skipped_) );
+  }
+
+  Creator::~Creator() {
+    clear();
+  }
+
+  void Creator::clear() {
+    if ( edges_ != NULL )
+      delete [] edges_;
+    edges_      = NULL;
+    num_edges_  = 0;
+
+    if ( hash_table_ != NULL )
+      delete [] hash_table_;
+    hash_table_ = NULL;
+
+    if ( edge_stack_ != NULL )
+      delete [] edge_stack_;
+    edge_stack_ = NULL;
+
+    if ( num_edges_stack_ != NULL )
+      delete [] num_edges_stack_;
+    num_edges_stack_ = NULL;
+
+    stack_pos_  = 0;
+  }
+
+  /// Initialize internal structures for creating a DAWG.
+  Status Creator::start() {
+    assert( hash_table_         == NULL );
+    assert( edges_              == NULL );
+    assert( edge_stack_         == NULL );
+    assert( num_edges_stack_    == NULL );
+
+    edges_          = new Edge[MAX_EDGES];
+    edge_stack_     = new Edge[MAX_CHARS * MAX_WORD_LENGTH];
+    hash_table_     = new Index[HASH_TABLE_SIZE];
+    memset( (void*)hash_table_, 0, sizeof(Index) * HASH_TABLE_SIZE );
+    num_edges_stack_= new Index[MAX_WORD_LENGTH];
+    memset( (void*)num_edges_stack_, 0, sizeof(Index) * MAX_WORD_LENGTH );
+    stack_pos_      = 0;
+    num_words_      = 0;
+    error_code_     = ERROR_NONE;
+    memset( (void*)skipped_, 0, sizeof(skipped_) );
+    
+    // The first node is reserved for the null node, and the first MAX_CHARS
+    // nodes are reserved for the bottom of the tree.
+    num_edges_      = 1 + MAX_CHARS;
+
+    return SUCCESS;
+  }
+  
+  Edge* Creator::get_edge( Index stack_pos, Index edge ) {
+    return edge_stack_ + (stack_pos * MAX_CHARS + edge);
+  }
+  Edge* Creator::get_cur_edge( Index stack_pos ) {
+    return get_edge( stack_pos, num_edges_stack_[stack_pos]-1 );
+  }
+
+  /// Add a word to the DAWG.
+  Status Creator::add_word( std::string word ) {
+    // Check preconditions
+    assert( hash_table_         != NULL );
+    assert( edges_              != NULL );
+    assert( edge_stack_         != NULL );
+    assert( num_edges_stack_    != NULL );
+
+    // Make sure word will fit.
+    if ( word.empty() )
+      return bad_word( ERROR_EMPTY_WORD, word );
+    if ( word.length() >= MAX_WORD_LENGTH )
+      return bad_word( ERROR_WORD_TOO_LONG, word );
+
+    // If there's a word before this one
+    if ( num_words_ > 0 ) {
+      // Find the first different letter in the stack
+      Index i;
+      for ( i = 0; i <= stack_pos_ && i < word.length(); i++ ) {
+        if ( word[i] != get_cur_edge(i)->letter() )
+          break;
+      }
+
+      // If there's a difference before the current stack position
+      if ( i <= stack_pos_ ) {
+        //std::cout << "difference! " << word << "[" << i << "](" << word[i] << ") != " << get_cur_edge(i)->letter() << std::endl;
+        // Make sure word is in order. Running out of letters first means
+        // it's a prefix of the word before.
+        if ( i == word.length() || word[i] < get_cur_edge(i)->letter() )
+          return bad_word( ERROR_OUT_OF_ORDER, word, i, get_cur_edge(i)->letter() );
+        // Finish all nodes above the difference
+        for ( ; stack_pos_ > i; --stack_pos_ ) {
+          Status status = finish_node( stack_pos_ );
+          if ( status != SUCCESS ) {
+            return status;
+          }
+        }
+      }
+      // If it's the word before again
+      else if ( i == word.length() ) {
+        ++skipped_[ERROR_DUPLICATE];
+        return SUCCESS;
+      }
+      // If there's a difference after the current stack position
+      else if ( i > stack_pos_ ) {
+        // move the stack up a level, so we 
+        // start adding letters after the end of the last word
+        ++stack_pos_;
+      }
+    }
+
+    // Add each additional letter to the stack  
+    for ( ; stack_pos_ < word.length(); ++stack_pos_ ) {
+      //std::cout << "adding " << word[stack_pos_] << " at " << stack_pos_ << std::endl;
+      ++num_edges_stack_[stack_pos_];
+      get_cur_edge(stack_pos_)->letter( word[stack_pos_] );
+    }
+    // stack_pos_ will be word.length() now (ie 1 past end), move it back
+    --stack_pos_;
+
+    //std::cout << "stack: ";
+    //for ( int i = 0 ; i <= stack_pos_ ; ++i ) {
+    //  std::cout << get_cur_edge(i)->letter();
+    //}
+    //std::cout << std::endl;
+
+    // Set end of word flag
+    get_cur_edge(stack_pos_)->end_of_word(true);
+    ++num_words_;
+
+    // Success
+    return SUCCESS;
+  }
+
+  // Note a problem with a word, skipping it if we're lenient
+  Status Creator::bad_word( ErrorCode code, const std::string& word, Index pos, char letter ) {
+    if ( lenient_ ) {
+      ++skipped_[code];
+      return SUCCESS;
+    }
+    error_code_     = code;
+    error_word_     = word;
+    error_pos_      = pos;
+    error_letter_   = letter;
+    return FAILURE;
+  }
+
+  // Note a problem with the build
+  Status Creator::fail( ErrorCode code ) {
+    error_code_ = code;
+    return FAILURE;
+  }
+
+  // Format the last error
+  const std::string Creator::error() const {
+    std::ostringstream out;
+    switch ( error_code_ ) {
+      case ERROR_NONE:
+        break;
+      case ERROR_EMPTY_WORD:
+        out << "Word is empty";
+        break;
+      case ERROR_WORD_TOO_LONG:
+        out << "Word is too long (\"" << error_word_ << "\" is " << error_word_.length()
+            << " chars, max is " << MAX_WORD_LENGTH << ")";
+        break;
+      case ERROR_OUT_OF_ORDER:
+        out << "Word out of order: " << error_word_ << "[" << error_pos_ << "] (";
+        if ( error_pos_ < error_word_.length() )
+          out << error_word_[error_pos_] << " < " << error_letter_ << ")";
+        else
+          out << "ends before " << error_letter_ << ")";
+        break;
+      case ERROR_DAWG_FULL:
+        out << "DAWG is full";
+        break;
+      case ERROR_HASH_FULL:
+        out << "Hash table is full";
+        break;
+      default:
+        return error_.str();
+    }
+    return out.str();
+  }
+
+  // Sum up the build
+  std::string Creator::report() const {
+    static const char* const reasons[NUM_ERROR_CODES] = {
+      "", "empty", "too long", "out of order", "duplicate", "", "", ""
+    };
+    std::ostringstream  out;
+    size_t              total = 0;
+
+    for ( int code = 0; code < NUM_ERROR_CODES; ++code )
+      total += skipped_[code];
+    out << num_words_ << " words added, " << total << " skipped";
+    const char* separator = ": ";
+    for ( int code = 0; code < NUM_ERROR_CODES; ++code ) {
+      if ( skipped_[code] != 0 ) {
+        out << separator << skipped_[code] << " " << reasons[code];
+        separator = ", ";
+      }
+    }
+    return out.str();
+  }
+
+  // The last word added is the current edge at each level of the stack
+  std::string Creator::last_word() const {
+    std::string word;
+    if ( num_words_ == 0 || edge_stack_ == NULL )
+      return word;
+    for ( Index i = 0; i <= stack_pos_; ++i )
+      word.push_back( edge_stack_[i * MAX_CHARS + num_edges_stack_[i] - 1].letter() );
+    return word;
+  }
+
+  // Save the builder's state
+  Status Creator::checkpoint( const std::string& path ) {
+    assert( edges_ != NULL );
+
+    std::string     temp    = path + ".tmp";
+    std::ofstream   output( temp.c_str(), std::ios::binary );
+    Index           sizes[] = { HASH_TABLE_SIZE, MAX_CHARS, MAX_WORD_LENGTH };
+    uint64_t        words   = num_words_;
+    uint64_t        skipped[NUM_ERROR_CODES];
+
+    for ( int code = 0; code < NUM_ERROR_CODES; ++code )
+      skipped[code] = skipped_[code];
+    output.write( (const char*)&CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC) );
+    output.write( (const char*)sizes, sizeof(sizes) );
+    output.write( (const char*)&words, sizeof(words) );
+    output.write( (const char*)skipped, sizeof(skipped) );
+    output.write( (const char*)&num_edges_, sizeof(num_edges_) );
+    output.write( (const char*)&stack_pos_, sizeof(stack_pos_) );
+    output.write( (const char*)edges_, sizeof(Edge) * num_edges_ );
+    output.write( (const char*)hash_table_, sizeof(Index) * HASH_TABLE_SIZE );
+    output.write( (const char*)edge_stack_, sizeof(Edge) * MAX_CHARS * MAX_WORD_LENGTH );
+    output.write( (const char*)num_edges_stack_, sizeof(Index) * MAX_WORD_LENGTH );
+    output.close();
+    if ( output.fail() ) {
+      error_code_ = ERROR_CHECKPOINT;
+      error_() << "Couldn't write checkpoint " << temp;
+      remove( temp.c_str() );
+      return FAILURE;
+    }
+
+#ifdef __unix__
+    // Make sure it's on disk before it replaces the last good one
+    int fd = open( temp.c_str(), O_RDONLY );
+    if ( fd >= 0 ) {
+      fsync( fd );
+      close( fd );
+    }
+#endif /* __unix__ */
+
+    if ( rename( temp.c_str(), path.c_str() ) != 0 ) {
+      error_code_ = ERROR_CHECKPOINT;
+      error_() << "Couldn't rename " << temp << " to " << path;
+      remove( temp.c_str() );
+      return FAILURE;
+    }
+    return SUCCESS;
+  }
+
+  // Carry on from a checkpoint
+  Status Creator::resume( const std::string& path ) {
+    std::ifstream   input( path.c_str(), std::ios::binary );
+    Magic           magic   = 0;
+    Index           sizes[] = { 0, 0, 0 };
+    uint64_t        words   = 0;
+    uint64_t        skipped[NUM_ERROR_CODES];
+
+    if ( !input.good() ) {
+      error_code_ = ERROR_CHECKPOINT;
+      error_() << "Couldn't open checkpoint " << path;
+      return FAILURE;
+    }
+    input.read( (char*)&magic, sizeof(magic) );
+    input.read( (char*)sizes, sizeof(sizes) );
+    if ( !input.good() || magic != CHECKPOINT_MAGIC ) {
+      error_code_ = ERROR_CHECKPOINT;
+      error_() << path << " is not a checkpoint";
+      return FAILURE;
+    }
+    if ( sizes[0] != HASH_TABLE_SIZE || sizes[1] != MAX_CHARS || sizes[2] != MAX_WORD_LENGTH ) {
+      error_code_ = ERROR_CHECKPOINT;
+      error_() << path << " was written by a build with different limits";
+      return FAILURE;
+    }
+
+    start();
+    input.read( (char*)&words, sizeof(words) );
+    input.read( (char*)skipped, sizeof(skipped) );
+    input.read( (char*)&num_edges_, sizeof(num_edges_) );
+    input.read( (char*)&stack_pos_, sizeof(stack_pos_) );
+    if ( !input.good() || num_edges_ > MAX_EDGES || stack_pos_ >= MAX_WORD_LENGTH ) {
+      error_code_ = ERROR_CHECKPOINT;
+      error_() << "Checkpoint " << path << " is corrupt";
+      clear();
+      return FAILURE;
+    }
+    input.read( (char*)edges_, sizeof(Edge) * num_edges_ );
+    input.read( (char*)hash_table_, sizeof(Index) * HASH_TABLE_SIZE );
+    input.read( (char*)edge_stack_, sizeof(Edge) * MAX_CHARS * MAX_WORD_LENGTH );
+    input.read( (char*)num_edges_stack_, sizeof(Index) * MAX_WORD_LENGTH );
+    if ( (size_t)input.gcount() != sizeof(Index) * MAX_WORD_LENGTH ) {
+      error_code_ = ERROR_CHECKPOINT;
+      error_() << "Checkpoint " << path << " is truncated";
+      clear();
+      return FAILURE;
+    }
+    num_words_ = words;
+    for ( int code = 0; code < NUM_ERROR_CODES; ++code )
+      skipped_[code] = skipped[code];
+
+    // Success
+    return SUCCESS;
+  }
+
+  DAWG* Creator::finish() {
+    // Check preconditions
+    assert( hash_table_         != NULL );
+    assert( edges_              != NULL );
+    assert( edge_stack_         != NULL );
+    assert( num_edges_stack_    != NULL );
+
+    // Finish all remaining nodes
+    for ( ; stack_pos_ > 0; --stack_pos_ ) {
+      Status status = finish_node( stack_pos_ );
+      if ( status != SUCCESS )
+        return NULL;
+    }
+
+    // Set end-of-node on last used edge
+    if ( num_edges_stack_[0] > 0 )
+      get_cur_edge(0)->end_of_node(true);
+
+    // Copy the bottom of the stack into into the beginning of the DAWG
+    Index i;
+    for ( i = 0; i < MAX_CHARS; ++i )
+      edges_[1+i] = *get_edge( 0, i );
+
+    // Set end-of-node on last opening edge
+    edges_[1+i-1].end_of_node(true);
+
+    // Create the DAWG
+    DAWG* new_dawg = new DAWG;
+    new_dawg->load( num_edges_, edges_ );
+
+    // Clear our data
+    clear();
+
+    // Return the DAWG
+    return new_dawg;
+  }
+
+  Status Creator::finish_node(Index pos) {
+    //std::cout << "finish_node(" << pos << ")" << std::endl;
+    // Set end-of-node on last node
+    get_cur_edge(pos)->end_of_node(true);
+
+    // Find our spot in the hash table
+    Index hash_idx;
+    Status status = find_hash_index( get_edge(pos, 0), num_edges_stack_[pos], &hash_idx );
+    if ( status != SUCCESS ) {
+      // error will be set by find_hash_index()
+      return status;
+    }
+
+    // Get the index from the hash table
+    Index idx       = hash_table_[hash_idx];
+
+    // If there's no matching node
+    if ( idx == 0 ) {
+      // Make sure DAWG isn't full
+      if ( num_edges_ + num_edges_stack_[pos] > MAX_EDGES )
+        return fail( ERROR_DAWG_FULL );
+
+      idx = num_edges_;
+
+      // Copy edges into DAWG
+      Index i;
+      for ( i = 0; i < num_edges_stack_[pos]; ++i ) {
+        edges_[idx + i] = *get_edge(pos, i);
+      }
+
+      // Add to hash table
+      hash_table_[hash_idx] = idx;
+
+      // Update edge count
+      num_edges_ += num_edges_stack_[pos];
+    }
+
+    // Make parent edge point to us
+    //std::cout << pos << "-1->child(" << idx <<" '" << get_edge(pos,0)->letter() << "')" << std::endl;
+    get_cur_edge(pos - 1)->child( idx );
+
+    // Clear this stack position
+    memset( (void*) get_edge(pos, 0), 0, sizeof(Edge) * MAX_CHARS );
+    num_edges_stack_[pos] = 0;
+
+    // Success
+    return SUCCESS;
+  }
+
+  Status Creator::find_hash_index( Edge* edges, Index num_edges, Index* out_hash_index ) {
+    Index idx           = compute_hash( edges, num_edges ) % HASH_TABLE_SIZE;
+    Index first_idx     = idx;
+    Index step          = 9;
+
+    //std::cout << "hash for '" << edges[0].letter() << "' = " << idx << std::endl;
+    //std::cout << "entry is --> " << hash_table_[idx] << std::endl;
+    // Loop
+    for (;;) {
+      // If there's no entry at this position, hand it back
+      if ( hash_table_[idx] == 0 ) {
+        *out_hash_index = idx;
+        return SUCCESS;
+      }
+
+      // See if the node at this entry matches
+      Index i;
+      Index start = hash_table_[idx];
+      for ( i = 0; i < num_edges; ++i )
+        if ( edges_[start + i] != edges[i] ) break;
+
+      // If so, return this index
+      if ( i == num_edges ) {
+        *out_hash_index = idx;
+        return SUCCESS;
+      }
+
+      // Otherwise, look further in the table
+      idx   += step;
+      step  += 9;
+      if ( idx >  HASH_TABLE_SIZE ) idx  -= HASH_TABLE_SIZE;
+      if ( step > HASH_TABLE_SIZE ) step -= HASH_TABLE_SIZE;
+
+      // If we're back where we started, return an error
+      if ( idx == first_idx )
+        return fail( ERROR_HASH_FULL );
+    }
+    // Should never get here!
+    assert(false);
+    error_() << "Internal Error";
+    return FAILURE;
+  }
+
+  Index Creator::compute_hash( Edge* edges, Index num_edges ) {
+    Index result = 0;
+    for ( Index i = 0; i < num_edges; ++i )
+      result = ((result << 1) | (result >> 31)) ^ edges[i].data();
+    return result;
+  }
+
+}
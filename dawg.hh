@@ -1,292 +1,483 @@
-#ifndef _DAWG_HH
-#define _DAWG_HH 1
-
-#include <istream> // streams
-#include <ostream>
-#include <sstream>
-#include <assert.h>
-
-// Integer types 
-#ifndef _MSC_VER
-# include <stdint.h>
-#else /* not _MSC_VER */
-  typedef unsigned __int32 uint32_t;  // MSVC does not have stdint.h
-#endif /* not _MSC_VER */
-
-namespace DAWG {
-  typedef uint32_t Index;
-  typedef bool     Status;
-  const bool SUCCESS = true;
-  const bool FAILURE = false;
-
-  /// Encapsulate an error message stream.
-  class Error {
-    public:
-      inline std::ostream& operator()() {
-        stream_.str("");
-        return stream_;
-      }
-      inline std::string str() const { return stream_.str(); }
-    private:
-      std::ostringstream    stream_;
-  };
-
-  /// The edge of a DAWG node.
-  /// Bits 0 -7 : character
-  /// Bit  8    : end-of-word
-  /// Bit  9    : end-of-node
-  /// Bits 10-31: index of first child edge
-  class Edge {
-    // These are implementation details which should really be hidden, but for
-    // efficiency we want Edge's methods to be inline. Since inline methods have
-    // to be in the header, these have to be here too.
-    static const uint32_t MASK_LETTER       = 0x000000FF; ///< Bits 0 - 7 = character
-    static const uint32_t MASK_END_OF_WORD  = 0x00000100; ///< Bit      8 = end-of-word
-    static const uint32_t MASK_END_OF_NODE  = 0x00000200; ///< Bit      9 = end-of-node
-    static const uint32_t MASK_CHILD        = 0xFFFFFC00; ///< Bits 10-31 = index of first child edge
-    static const uint32_t SHIFT_CHILD       = 10;
-
-    public:
-      /// Default constructor
-      Edge() { data_ = 0; }
-
-      /// Initialized constructor
-      Edge(char _letter, bool _end_of_word = false, bool _end_of_node = false, Index _child = 0) {
-        data_ = 0;
-        letter(_letter);
-        end_of_word(_end_of_word);
-        end_of_node(_end_of_node);
-        child(_child);
-      }
-
-      /// Destructor
-      ~Edge() {};
-
-      inline Edge& operator=(const Edge& other) {
-        data_ = other.data_;
-        return *this;
-      }
-
-      /// Comparison
-      inline bool operator==(const Edge& other) const {
-        return data_ == other.data_;
-      }
-      inline bool operator!=(const Edge& other) const {
-        return data_ != other.data_;
-      }
-
-      /// The letter of this edge.
-      inline char   letter()          const { return (char)(data_ & MASK_LETTER); }
-      /// Whether or not a word ends at this edge.
-      inline bool   end_of_word()     const { return data_ & MASK_END_OF_WORD; }
-      /// Whether or not this is the last edge in a node.
-      inline bool   end_of_node()     const { return data_ & MASK_END_OF_NODE; }
-      /// Index of the first child edge of the node this points to.
-      inline Index  child()           const { return (data_ & MASK_CHILD) >> SHIFT_CHILD; }
-
-      /// Set the letter.
-      inline void   letter(char c)          { data_ = (data_ & ~MASK_LETTER) | c; }
-      /// Set the end-of-word flag.
-      inline void   end_of_word(bool v)     { if (v) data_ |= MASK_END_OF_WORD; else data_ &= ~MASK_END_OF_WORD; }
-      /// Set the end-of-node flag.
-      inline void   end_of_node(bool v)     { if (v) data_ |= MASK_END_OF_NODE; else data_ &= ~MASK_END_OF_NODE; }
-      /// Set the child index.
-      inline void   child(Index n)          { data_ = (data_ & ~MASK_CHILD) | (n << SHIFT_CHILD); }
-
-      inline uint32_t data()               const { return data_; }
-      inline void print(std::ostream& out) const { out << "(" << letter() << " -> " << child() << " eow:" << end_of_word() << " eon:" << end_of_node() << ")"; }
-
-    private:
-      uint32_t data_;
-  };
-
-  /// A Directed Acyclic Word Graph.
-  class DAWG {
-    public:
-      /// Default constructor
-      DAWG() : num_edges_(0), edges_(NULL) {};
-
-      /// Destructor
-      ~DAWG();
-
-      /// Clear DAWG.
-      void clear();
-
-      /// Load DAWG data from a stream.
-      Status load(
-          std::istream& input   ///< Stream containing DAWG data.
-      );
-
-      /// Load DAWG from binary data. The data will be copied.
-      Status load(
-          Index         num_edges,  ///< Number of edges in the data
-          const Edge*   edges       ///< The actual edge data
-      );
-
-      /// Save DAWG data to a stream.
-      Status save(
-          std::ostream& output  ///< Steam to write DAWG data to.
-      );
-
-      /// Find an edge in a node with the specified letter.
-      /// @return   an iterator pointing to the edge if found, or end() if not
-      class Iterator find_edge(
-          char letter,                      ///< The letter to look for
-          const class Iterator& start       ///< Where to start looking
-      ) const;
-
-      /// See if a word is in the DAWG.
-      bool contains_word(
-          const std::string& word   ///< Word to look for
-      );
-
-      /// Get a pointer to an individual edge.
-      inline Edge* edge(
-          Index index           ///< index of the edge to retrieve
-      ) const {
-        return &edges_[index];
-      }
-
-      class Iterator root()  const; ///< Iterator pointing before the first edge
-      class Iterator begin() const; ///< Iterator pointing to the first edge
-      class Iterator end()   const; ///< Iterator pointing to the null edge
-
-      /// Last error message.
-      inline const std::string error() const { return error_.str(); }
-
-    private:
-      Index                 num_edges_;     ///< Number of edges in the dawg
-      Edge*                 edges_;         ///< Edges
-      Error                 error_;
-  };
-
-  /// A class to create a DAWG.
-  class Creator {
-    public:
-      /// Default constructor
-      Creator();
-
-      /// Destructor
-      ~Creator();
-
-      /// Initialize internal structures for creating a DAWG.
-      Status start();
-
-      /// Add a word to the DAWG. Words must be fed in alphabetic order.
-      Status add_word(
-          std::string word  ///< The word to add.
-      );
-
-      /// Create final DAWG and clean up internal structures.
-      /// @return   a new DAWG on success, NULL on failure
-      DAWG* finish();
-
-      /// Last error message.
-      inline const std::string error() const { return error_.str(); }
-
-    private:
-      Index         num_edges_;     ///< Current number of edges
-      Edge*         edges_;         ///< Edge data
-      Index*        hash_table_;    ///< Hash table to speed finding of edges
-      Edge*         edge_stack_;
-      Index*        num_edges_stack_;
-      Index         stack_pos_;
-      Error         error_;
-
-      /// Clear data
-      void          clear();
-      Edge*         get_edge( Index stack_pos, Index edge );
-      Edge*         get_cur_edge( Index stack_pos );
-      Status        finish_node( Index stack_pos );
-      Status        find_hash_index( Edge* edges, Index num_edges, Index* out_hash_index );
-      Index         compute_hash( Edge* edges, Index num_edges );
-  };
-
-  /// An iterator to walk through a DAWG.
-  class Iterator {
-    public:
-      /// Empty constructor
-      Iterator() : dawg_(NULL), index_(0), data_(NULL) {}
-
-      /// Basic constructor
-      Iterator(
-          const DAWG*   dawg,       ///< Parent DAWG
-          Index         index       ///< Index of the node to point to
-      ) : dawg_(dawg), index_(index), data_(dawg_->edge(index_)) {}
-
-      /// Copy constructor
-      Iterator(
-          const Iterator& other       ///< Iterator to copy.
-       ) : dawg_(other.dawg_), index_(other.index_) , data_(other.data_) {}
-
-      ~Iterator() {};
-
-      /// Dereference
-      inline Edge& operator*() {
-        assert( data_ != NULL );
-        return *data_;
-      }
-      const inline Edge& operator*() const {
-        assert( data_ != NULL );
-        return *data_;
-      }
-      inline Edge* operator->() const {
-        assert( data_ != NULL );
-        return data_;
-      }
-
-      /// Prefix increment. For convenience, incrementing past the end of a node
-      /// goes to the NULL edge.
-      inline Iterator& operator++() {
-        if ( data_->end_of_node() ) {
-          index_ = 0;
-          data_  = dawg_->edge(0);
-        } else {
-          ++index_;
-          ++data_;
-        }
-        assert( data_ = dawg_->edge(index_) );
-        return *this;
-      }
-
-      /// Prefix decrement. 
-      inline Iterator& operator--() {
-        --index_;
-        --data_;
-        assert(data_ == dawg_->edge(index_));
-        assert(data_ >= dawg_->edge(0));
-        return *this;
-      }
-
-      Iterator  child() {
-        assert( dawg_ != NULL );
-        assert( data_ != NULL );
-        return Iterator( dawg_, data_->child() );
-      }
-      Iterator  end()   {
-        assert( dawg_ != NULL );
-        return dawg_->end();
-      }
-
-      Iterator find_edge(char letter) const {
-        assert( dawg_ != NULL );
-        return dawg_->find_edge( letter, *this );
-      }
-
-      /// Comparison
-      inline bool operator==(const Iterator& other) const {
-        return data_ == other.data_;
-      }
-      inline bool operator!=(const Iterator& other) const {
-        return data_ != other.data_;
-      }
-
-    private:
-      const DAWG*   dawg_;
-      Index         index_;
-      Edge*         data_;
-
-  };
-}
-
-#endif /* not _DAWG_HH */
+#ifndef _DAWG_HH
+#define _DAWG_HH 1
+
+#include <istream> // streams
+#include <ostream>
+#include <sstream>
+#include <vector>
+#include <assert.h>
+
+// Integer types 
+#ifndef _MSC_VER
+# include <stdint.h>
+#else /* not _MSC_VER */
+  typedef unsigned __int32 uint32_t;  // MSVC does not have stdint.h
+  typedef unsigned __int64 uint64_t;
+#endif /* not _MSC_VER */
+
+namespace DAWG {
+  typedef uint32_t Index;
+  typedef bool     Status;
+  const bool SUCCESS = true;
+  const bool FAILURE = false;
+
+  /// Encapsulate an error message stream.
+  class Error {
+    public:
+      inline std::ostream& operator()() {
+        stream_.str("");
+        return stream_;
+      }
+      inline std::string str() const { return stream_.str(); }
+    private:
+      std::ostringstream    stream_;
+  };
+
+  /// The edge of a DAWG node.
+  /// Bits 0 -7 : character
+  /// Bit  8    : end-of-word
+  /// Bit  9    : end-of-node
+  /// Bits 10-31: index of first child edge
+  class Edge {
+    // These are implementation details which should really be hidden, but for
+    // efficiency we want Edge's methods to be inline. Since inline methods have
+    // to be in the header, these have to be here too.
+    static const uint32_t MASK_LETTER       = 0x000000FF; ///< Bits 0 - 7 = character
+    static const uint32_t MASK_END_OF_WORD  = 0x00000100; ///< Bit      8 = end-of-word
+    static const uint32_t MASK_END_OF_NODE  = 0x00000200; ///< Bit      9 = end-of-node
+    static const uint32_t MASK_CHILD        = 0xFFFFFC00; ///< Bits 10-31 = index of first child edge
+    static const uint32_t SHIFT_CHILD       = 10;
+
+    public:
+      /// Default constructor
+      Edge() { data_ = 0; }
+
+      /// Initialized constructor
+      Edge(char _letter, bool _end_of_word = false, bool _end_of_node = false, Index _child = 0) {
+        data_ = 0;
+        letter(_letter);
+        end_of_word(_end_of_word);
+        end_of_node(_end_of_node);
+        child(_child);
+      }
+
+      /// Destructor
+      ~Edge() {};
+
+      inline Edge& operator=(const Edge& other) {
+        data_ = other.data_;
+        return *this;
+      }
+
+      /// Comparison
+      inline bool operator==(const Edge& other) const {
+        return data_ == other.data_;
+      }
+      inline bool operator!=(const Edge& other) const {
+        return data_ != other.data_;
+      }
+
+      /// The letter of this edge.
+      inline char   letter()          const { return (char)(data_ & MASK_LETTER); }
+      /// Whether or not a word ends at this edge.
+      inline bool   end_of_word()     const { return data_ & MASK_END_OF_WORD; }
+      /// Whether or not this is the last edge in a node.
+      inline bool   end_of_node()     const { return data_ & MASK_END_OF_NODE; }
+      /// Index of the first child edge of the node this points to.
+      inline Index  child()           const { return (data_ & MASK_CHILD) >> SHIFT_CHILD; }
+
+      /// Set the letter.
+      inline void   letter(char c)          { data_ = (data_ & ~MASK_LETTER) | (unsigned char)c; }
+      /// Set the end-of-word flag.
+      inline void   end_of_word(bool v)     { if (v) data_ |= MASK_END_OF_WORD; else data_ &= ~MASK_END_OF_WORD; }
+      /// Set the end-of-node flag.
+      inline void   end_of_node(bool v)     { if (v) data_ |= MASK_END_OF_NODE; else data_ &= ~MASK_END_OF_NODE; }
+      /// Set the child index.
+      inline void   child(Index n)          { data_ = (data_ & ~MASK_CHILD) | (n << SHIFT_CHILD); }
+
+      inline uint32_t data()               const { return data_; }
+      inline void print(std::ostream& out) const { out << "(" << letter() << " -> " << child() << " eow:" << end_of_word() << " eon:" << end_of_node() << ")"; }
+
+    private:
+      uint32_t data_;
+  };
+
+  /// Maps each letter to the letter it matches as, so that several letters
+  /// in a DAWG can match one letter in a query. Letters are single bytes, so
+  /// this suits ASCII and Latin-1 dictionaries but not UTF-8 ones.
+  class FoldTable {
+    public:
+      /// Table which folds every letter to itself.
+      FoldTable();
+
+      /// Make one letter fold to another.
+      inline void set(
+          char          from,   ///< Letter to fold
+          char          to      ///< Letter it matches as
+      ) {
+        table_[(unsigned char)from] = to;
+      }
+
+      /// The letter a letter folds to.
+      inline char operator()( char c ) const { return table_[(unsigned char)c]; }
+
+      /// Whether two letters fold to the same letter.
+      inline bool match( char a, char b ) const { return (*this)(a) == (*this)(b); }
+
+      /// Folds ASCII upper case letters to lower case.
+      static FoldTable ascii_case();
+
+      /// Folds Latin-1 upper case letters to lower case, and accented letters
+      /// to the plain ASCII letter underneath.
+      static FoldTable latin1_accents();
+
+    private:
+      char  table_[256];
+  };
+
+  /// Compare two words in the order a DAWG keeps them, which is the order
+  /// Creator requires: letter by letter as chars, a prefix before its
+  /// extensions.
+  /// @return   negative, zero or positive as a sorts before, with or after b
+  int compare_words(
+      const std::string& a,     ///< First word
+      const std::string& b      ///< Second word
+  );
+
+  /// Statistics about how the nodes of a DAWG are laid out in memory.
+  struct LayoutStats {
+    Index   num_nodes;      ///< Number of reachable nodes
+    Index   split_nodes;    ///< Nodes that fit in a cache line but cross one
+    Index   padding;        ///< Edges that are not part of any node
+    Index   line_jumps;     ///< Edges whose child starts in another cache line
+    Index   page_jumps;     ///< Edges whose child starts in another page
+  };
+
+  /// A Directed Acyclic Word Graph.
+  class DAWG {
+    public:
+      /// Default constructor
+      DAWG() : num_edges_(0), edges_(NULL), memory_(NULL), mapped_(0) {};
+
+      /// Destructor
+      ~DAWG();
+
+      /// Clear DAWG.
+      void clear();
+
+      /// Load DAWG data from a stream.
+      Status load(
+          std::istream& input   ///< Stream containing DAWG data.
+      );
+
+      /// Load DAWG from binary data. The data will be copied.
+      Status load(
+          Index         num_edges,  ///< Number of edges in the data
+          const Edge*   edges       ///< The actual edge data
+      );
+
+      /// Map a saved DAWG file into memory instead of reading it. Pages are
+      /// only read in as they are touched, and the system can drop them again
+      /// when memory runs short. Where files can't be mapped it is loaded, as
+      /// are files saved before the header was padded out to a page.
+      Status map(
+          const std::string& path   ///< File written by save()
+      );
+
+      /// Use edges that belong to someone else instead of a copy of them.
+      /// They must stay put for as long as this DAWG uses them, and the edge
+      /// after the last one must be a root edge whose child is the first
+      /// edge of the root node.
+      void share(
+          const Edge*   edges,      ///< Edge data, from the null edge on
+          Index         num_edges   ///< Number of edges, not counting the root edge
+      );
+
+      /// Save DAWG data to a stream.
+      Status save(
+          std::ostream& output  ///< Steam to write DAWG data to.
+      );
+
+      /// Find an edge in a node with the specified letter.
+      /// @return   an iterator pointing to the edge if found, or end() if not
+      class Iterator find_edge(
+          char letter,                      ///< The letter to look for
+          const class Iterator& start       ///< Where to start looking
+      ) const;
+
+      /// See if a word is in the DAWG.
+      bool contains_word(
+          const std::string& word   ///< Word to look for
+      ) const;
+
+      /// See if the DAWG has a word which matches one letter for letter,
+      /// letters matching when they fold to the same letter. Where a letter
+      /// matches several edges in a node each is followed in turn, so there is
+      /// no need to fold the query or keep a folded copy of the dictionary.
+      bool contains_word(
+          const std::string&    word,   ///< Word to look for
+          const FoldTable&      fold    ///< How to match letters
+      ) const;
+
+      /// See if each of several words is in the DAWG. On CPUs with AVX-512
+      /// the words are looked up 16 at a time, one per vector lane.
+      void contains_words(
+          const std::string*  words,    ///< Words to look for
+          size_t              count,    ///< Number of words
+          bool*               results   ///< Receives whether each word was found
+      ) const;
+
+      /// Rearrange nodes so that no node which fits in a cache line crosses
+      /// one. Nodes are bin-packed into lines largest first, best fit, which
+      /// keeps the padding needed to a minimum.
+      Status align_nodes();
+
+      /// Rearrange nodes so that each page, and each cache line within it,
+      /// holds a connected subgraph several levels deep. A walk then moves to
+      /// a new page only every few letters rather than at every level.
+      Status cluster_nodes();
+
+      /// Measure the current node layout.
+      void layout_stats(
+          LayoutStats*  stats   ///< Receives the statistics
+      ) const;
+
+      /// Hash of the edge data. Building the same words with Creator always
+      /// gives the same fingerprint.
+      uint64_t fingerprint() const;
+
+      /// Number of edges in the DAWG, not counting the root edge.
+      inline Index num_edges() const { return num_edges_; }
+
+      /// Get a pointer to an individual edge.
+      inline Edge* edge(
+          Index index           ///< index of the edge to retrieve
+      ) const {
+        return &edges_[index];
+      }
+
+      class Iterator root()  const; ///< Iterator pointing before the first edge
+      class Iterator begin() const; ///< Iterator pointing to the first edge
+      class Iterator end()   const; ///< Iterator pointing to the null edge
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      Index                 num_edges_;     ///< Number of edges in the dawg
+      Edge*                 edges_;         ///< Edges, aligned within memory_
+      char*                 memory_;        ///< Memory allocated for edges
+      size_t                mapped_;        ///< Size of memory_ if mapped from a file, else 0
+      Error                 error_;
+
+      void          allocate( Index num_edges );
+      Index         find_folded( Index i, char letter, const FoldTable& fold ) const;
+      Index         node_size( Index start ) const;
+      void          collect_nodes( std::vector<Index>* starts ) const;
+      Status        relayout( const std::vector<Index>& new_start, Index num_edges );
+  };
+
+  /// Why a Creator call failed, or why it skipped a word.
+  enum ErrorCode {
+    ERROR_NONE = 0,         ///< Nothing has gone wrong
+    ERROR_EMPTY_WORD,       ///< Word has no letters
+    ERROR_WORD_TOO_LONG,    ///< Word is too long to add
+    ERROR_OUT_OF_ORDER,     ///< Word sorts before the word added before it
+    ERROR_DUPLICATE,        ///< Word is the same as the one before; never an error
+    ERROR_DAWG_FULL,        ///< No room for more edges
+    ERROR_HASH_FULL,        ///< No room in the node hash table
+    ERROR_CHECKPOINT,       ///< Couldn't write or read a checkpoint
+    NUM_ERROR_CODES
+  };
+
+  /// A class to create a DAWG.
+  class Creator {
+    public:
+      /// Default constructor
+      Creator();
+
+      /// Destructor
+      ~Creator();
+
+      /// Initialize internal structures for creating a DAWG.
+      Status start();
+
+      /// Skip words that can't be added instead of failing. Skipped words are
+      /// counted by reason, and report() sums them up. Off by default.
+      inline void set_lenient(
+          bool lenient      ///< Whether to skip bad words
+      ) {
+        lenient_ = lenient;
+      }
+
+      /// Add a word to the DAWG. Words must be fed in alphabetic order. A word
+      /// the same as the one before it is skipped, in either mode.
+      Status add_word(
+          std::string word  ///< The word to add.
+      );
+
+      /// Create final DAWG and clean up internal structures.
+      /// @return   a new DAWG on success, NULL on failure
+      DAWG* finish();
+
+      /// Save everything needed to carry on adding words later. The file is
+      /// written under a temporary name and renamed over path, so a build
+      /// stopped partway through never leaves a damaged checkpoint.
+      Status checkpoint(
+          const std::string& path   ///< File to save to
+      );
+
+      /// Carry on from a checkpoint, instead of calling start(). Feed the
+      /// words after the first num_words() from the same input.
+      Status resume(
+          const std::string& path   ///< File written by checkpoint()
+      );
+
+      /// Number of words added so far.
+      inline size_t num_words() const { return num_words_; }
+
+      /// The last word added, or an empty string if there isn't one.
+      std::string last_word() const;
+
+      /// Number of words skipped for a reason since start(). Still available
+      /// after finish().
+      inline size_t num_skipped(
+          ErrorCode code        ///< Reason they were skipped
+      ) const {
+        return skipped_[code];
+      }
+
+      /// Summary of the build so far, or of the last one after finish(): how
+      /// many words went in, and how many were skipped and why.
+      std::string report() const;
+
+      /// What went wrong last.
+      inline ErrorCode error_code() const { return error_code_; }
+
+      /// Last error message. Formatted only when asked for, from what was
+      /// kept about the failure.
+      const std::string error() const;
+
+    private:
+      Index         num_edges_;     ///< Current number of edges
+      Edge*         edges_;         ///< Edge data
+      Index*        hash_table_;    ///< Hash table to speed finding of edges
+      Edge*         edge_stack_;
+      Index*        num_edges_stack_;
+      Index         stack_pos_;
+      size_t        num_words_;     ///< Words added so far
+      bool          lenient_;       ///< Whether to skip bad words
+      size_t        skipped_[NUM_ERROR_CODES];  ///< Words skipped for each reason
+      ErrorCode     error_code_;
+      std::string   error_word_;    ///< Word that caused the last error
+      Index         error_pos_;     ///< Letter of error_word_ where it went wrong
+      char          error_letter_;  ///< Letter the previous word had there
+      Error         error_;         ///< Message for errors that aren't about a word
+
+      /// Note a problem with a word
+      /// @return   SUCCESS if the word is to be skipped, else FAILURE
+      Status        bad_word( ErrorCode code, const std::string& word, Index pos = 0, char letter = 0 );
+      /// Note a problem with the build
+      /// @return   FAILURE
+      Status        fail( ErrorCode code );
+
+      /// Clear data
+      void          clear();
+      Edge*         get_edge( Index stack_pos, Index edge );
+      Edge*         get_cur_edge( Index stack_pos );
+      Status        finish_node( Index stack_pos );
+      Status        find_hash_index( Edge* edges, Index num_edges, Index* out_hash_index );
+      Index         compute_hash( Edge* edges, Index num_edges );
+  };
+
+  /// An iterator to walk through a DAWG.
+  class Iterator {
+    public:
+      /// Empty constructor
+      Iterator() : dawg_(NULL), index_(0), data_(NULL) {}
+
+      /// Basic constructor
+      Iterator(
+          const DAWG*   dawg,       ///< Parent DAWG
+          Index         index       ///< Index of the node to point to
+      ) : dawg_(dawg), index_(index), data_(dawg_->edge(index_)) {}
+
+      /// Copy constructor
+      Iterator(
+          const Iterator& other       ///< Iterator to copy.
+       ) : dawg_(other.dawg_), index_(other.index_) , data_(other.data_) {}
+
+      ~Iterator() {};
+
+      /// Dereference
+      inline Edge& operator*() {
+        assert( data_ != NULL );
+        return *data_;
+      }
+      const inline Edge& operator*() const {
+        assert( data_ != NULL );
+        return *data_;
+      }
+      inline Edge* operator->() const {
+        assert( data_ != NULL );
+        return data_;
+      }
+
+      /// Prefix increment. For convenience, incrementing past the end of a node
+      /// goes to the NULL edge.
+      inline Iterator& operator++() {
+        if ( data_->end_of_node() ) {
+          index_ = 0;
+          data_  = dawg_->edge(0);
+        } else {
+          ++index_;
+          ++data_;
+        }
+        assert( data_ = dawg_->edge(index_) );
+        return *this;
+      }
+
+      /// Prefix decrement. 
+      inline Iterator& operator--() {
+        --index_;
+        --data_;
+        assert(data_ == dawg_->edge(index_));
+        assert(data_ >= dawg_->edge(0));
+        return *this;
+      }
+
+      Iterator  child() {
+        assert( dawg_ != NULL );
+        assert( data_ != NULL );
+        return Iterator( dawg_, data_->child() );
+      }
+      Iterator  end()   {
+        assert( dawg_ != NULL );
+        return dawg_->end();
+      }
+
+      /// Index of the edge this points to.
+      inline Index index() const { return index_; }
+
+      Iterator find_edge(char letter) const {
+        assert( dawg_ != NULL );
+        return dawg_->find_edge( letter, *this );
+      }
+
+      /// Comparison
+      inline bool operator==(const Iterator& other) const {
+        return data_ == other.data_;
+      }
+      inline bool operator!=(const Iterator& other) const {
+        return data_ != other.data_;
+      }
+
+    private:
+      const DAWG*   dawg_;
+      Index         index_;
+      Edge*         data_;
+
+  };
+}
+
+#endif /* not _DAWG_HH */
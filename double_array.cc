@@ -0,0 +1,390 @@
+#include "double_array.hh"
+#include "parallel.hh"
+#include <algorithm>
+#include <vector>
+
+namespace DAWG {
+
+  const Index    NUM_LETTERS        = 256;          /// Number of distinct letters.
+  const Index    MAX_BASE           = 0x7FFFFFFF;   /// Largest base that fits in a unit value.
+  const Index    PLACE_STRIPE       = 256;          /// Units in each stripe of the array.
+  const Index    PLACE_LANES        = 16;           /// Stripes in turn belong to this many lanes.
+  const Index    PLACER_BLOCK_SIZE  = PLACE_STRIPE * PLACE_LANES; /// Number of units to grow the placer by.
+  const uint8_t  MAX_PLACE_FAILURES = 16;           /// Rejections before a free unit stops being a candidate.
+  const size_t   PLACE_BATCH        = 4096;         /// Nodes whose bases are looked for at once.
+  const Index    PLACE_ROOM         = 8;            /// Free units kept past the end for each node of a batch.
+  const Index    NO_UNIT            = 0xFFFFFFFF;   /// Ends a free list.
+
+  // Letters of the node starting at an edge
+  static void node_letters( const DAWG& dawg, Index node, std::vector<Index>* letters ) {
+    letters->clear();
+    for ( Index i = node; ; ++i ) {
+      letters->push_back( (unsigned char)dawg.edge(i)->letter() );
+      if ( dawg.edge(i)->end_of_node() )
+        break;
+    }
+  }
+
+  //----------------------------------------------------------------------------//
+  // Base placement                                                             //
+  //----------------------------------------------------------------------------//
+
+  /// Finds bases for nodes while building a double array.
+  ///
+  /// The array is cut into stripes, dealt out in turn to PLACE_LANES lanes.
+  /// Each lane keeps its free units in a doubly linked list, tried first-fit
+  /// as the slot for a node's first letter, so nodes placed in different
+  /// lanes rarely want the same units. A unit that keeps being rejected sits
+  /// in a crowded region, so after MAX_PLACE_FAILURES it is dropped from the
+  /// list; it stays free and can still take later letters of some node. This
+  /// keeps the scan short once the front of the array is densely packed.
+  ///
+  /// To place many nodes at once, threads find() bases for them in different
+  /// lanes, each keeping track of what it has already handed out, and then
+  /// claim() takes them one at a time, in order. A node whose base another
+  /// lane's node got first is placed again.
+  class BasePlacer {
+    public:
+      /// Units and bases one lane has handed out but not yet claimed.
+      class Claims {
+        public:
+          static const uint8_t UNIT = 1;    ///< The unit is handed out
+          static const uint8_t BASE = 2;    ///< The unit is handed out as a base
+
+          /// Whether a unit is marked.
+          inline bool has( Index unit, uint8_t mark ) const {
+            return unit < marks_.size() && (marks_[unit] & mark) != 0;
+          }
+
+          /// Mark a unit.
+          void add( Index unit, uint8_t mark ) {
+            if ( unit >= marks_.size() )
+              marks_.resize( unit + PLACER_BLOCK_SIZE, 0 );
+            if ( marks_[unit] == 0 )
+              marked_.push_back( unit );
+            marks_[unit] |= mark;
+          }
+
+          /// Forget every mark.
+          void clear() {
+            for ( size_t i = 0; i < marked_.size(); ++i )
+              marks_[marked_[i]] = 0;
+            marked_.clear();
+          }
+
+        private:
+          std::vector<uint8_t>  marks_;     ///< Marks of each unit
+          std::vector<Index>    marked_;    ///< Units with marks
+      };
+
+      BasePlacer() : top_(0) {
+        for ( Index lane = 0; lane < PLACE_LANES; ++lane )
+          head_[lane] = tail_[lane] = NO_UNIT;
+        grow();
+      }
+
+      /// Find the first base in a lane that fits a node, as place() would,
+      /// and hold it for the lane: mark it in the lane's claims, and take its
+      /// units in the lane off the lane's list. Only the lane's own list
+      /// changes, so threads may find in different lanes at once, as long as
+      /// nothing else changes the placer meanwhile.
+      Index find( const std::vector<Index>& letters, Index lane, Claims* claims ) {
+        Index base = first_fit( letters, lane, *claims );
+        claims->add( base, Claims::BASE );
+        for ( size_t i = 0; i < letters.size(); ++i ) {
+          Index unit = base + letters[i];
+          claims->add( unit, Claims::UNIT );
+          if ( unit < used_.size() && unit / PLACE_STRIPE % PLACE_LANES == lane && failures_[unit] < MAX_PLACE_FAILURES )
+            unlink(unit);
+        }
+        return base;
+      }
+
+      /// Reserve a base found by find(), if it is still free.
+      /// @return   false if another node has taken some of it
+      bool claim( Index base, const std::vector<Index>& letters ) {
+        if ( !fits( base, letters ) )
+          return false;
+        reserve( base, letters );
+        return true;
+      }
+
+      /// Make sure there are at least some free units past the last one taken,
+      /// so find() seldom has to look past the end.
+      void make_room( Index units ) {
+        while ( used_.size() < top_ + units )
+          grow();
+      }
+
+      /// Find and reserve a base in a lane for a node with the given letters.
+      Index place( const std::vector<Index>& letters, Index lane ) {
+        Index unit = head_[lane];
+        for (;;) {
+          if ( unit == NO_UNIT ) {
+            // Ran out of candidates, continue into fresh units
+            unit = grow() + lane * PLACE_STRIPE;
+          }
+          if ( unit > letters[0] ) {
+            Index base = unit - letters[0];
+            if ( fits(base, letters) ) {
+              reserve(base, letters);
+              return base;
+            }
+          }
+          Index next = next_[unit];
+          if ( ++failures_[unit] >= MAX_PLACE_FAILURES )
+            unlink(unit);
+          unit = next;
+        }
+      }
+
+    private:
+      std::vector<uint8_t>  used_;          ///< Whether a unit is taken
+      std::vector<uint8_t>  base_used_;     ///< Whether a base is taken
+      std::vector<uint8_t>  failures_;      ///< Times a unit was rejected
+      std::vector<Index>    next_;          ///< Free list links
+      std::vector<Index>    prev_;
+      Index                 head_[PLACE_LANES];
+      Index                 tail_[PLACE_LANES];
+      Index                 top_;           ///< One past the last unit taken
+
+      /// The first base in a lane that fits a node and isn't claimed.
+      Index first_fit( const std::vector<Index>& letters, Index lane, const Claims& claims ) {
+        Index unit = head_[lane];
+        while ( unit != NO_UNIT ) {
+          if ( unit > letters[0] && fits( unit - letters[0], letters, claims ) )
+            return unit - letters[0];
+          Index next = next_[unit];
+          if ( ++failures_[unit] >= MAX_PLACE_FAILURES )
+            unlink(unit);
+          unit = next;
+        }
+        // Everything past the end is free but for the claims
+        for ( unit = used_.size() + lane * PLACE_STRIPE; ; unit += PLACER_BLOCK_SIZE ) {
+          for ( Index u = unit; u < unit + PLACE_STRIPE; ++u ) {
+            if ( u > letters[0] && fits( u - letters[0], letters, claims ) )
+              return u - letters[0];
+          }
+        }
+      }
+
+      /// Whether all slots for a node at base are free, and not claimed.
+      bool fits( Index base, const std::vector<Index>& letters, const Claims& claims ) const {
+        if ( (base < base_used_.size() && base_used_[base]) || claims.has( base, Claims::BASE ) )
+          return false;
+        for ( size_t i = 0; i < letters.size(); ++i ) {
+          Index unit = base + letters[i];
+          if ( (unit < used_.size() && used_[unit]) || claims.has( unit, Claims::UNIT ) )
+            return false;
+        }
+        return true;
+      }
+
+      /// Whether all slots for a node at base are free.
+      bool fits( Index base, const std::vector<Index>& letters ) {
+        while ( base >= used_.size() )
+          grow();
+        if ( base_used_[base] )
+          return false;
+        for ( size_t i = 0; i < letters.size(); ++i ) {
+          while ( base + letters[i] >= used_.size() )
+            grow();
+          if ( used_[base + letters[i]] )
+            return false;
+        }
+        return true;
+      }
+
+      /// Mark the slots for a node at base as taken.
+      void reserve( Index base, const std::vector<Index>& letters ) {
+        base_used_[base] = 1;
+        for ( size_t i = 0; i < letters.size(); ++i ) {
+          Index unit = base + letters[i];
+          used_[unit] = 1;
+          if ( unit >= top_ )
+            top_ = unit + 1;
+          if ( failures_[unit] < MAX_PLACE_FAILURES )
+            unlink(unit);
+        }
+      }
+
+      /// Remove a unit from its lane's free list.
+      void unlink( Index unit ) {
+        Index lane = unit / PLACE_STRIPE % PLACE_LANES;
+        if ( prev_[unit] != NO_UNIT ) next_[prev_[unit]] = next_[unit];
+        else                       head_[lane] = next_[unit];
+        if ( next_[unit] != NO_UNIT ) prev_[next_[unit]] = prev_[unit];
+        else                       tail_[lane] = prev_[unit];
+        failures_[unit] = MAX_PLACE_FAILURES;
+      }
+
+      /// Add a block of free units, a stripe for each lane.
+      /// @return   the first new unit
+      Index grow() {
+        Index first = used_.size();
+        used_.resize(first + PLACER_BLOCK_SIZE, 0);
+        base_used_.resize(first + PLACER_BLOCK_SIZE, 0);
+        failures_.resize(first + PLACER_BLOCK_SIZE, 0);
+        next_.resize(first + PLACER_BLOCK_SIZE, NO_UNIT);
+        prev_.resize(first + PLACER_BLOCK_SIZE, NO_UNIT);
+        for ( Index unit = first; unit < used_.size(); ++unit ) {
+          Index lane = unit / PLACE_STRIPE % PLACE_LANES;
+          prev_[unit] = tail_[lane];
+          if ( tail_[lane] != NO_UNIT ) next_[tail_[lane]] = unit;
+          else                       head_[lane] = unit;
+          tail_[lane] = unit;
+        }
+        return first;
+      }
+  };
+
+  /// What the threads finding bases for a batch of nodes share.
+  struct PlaceJob {
+    const DAWG*                 dawg;
+    BasePlacer*                 placer;
+    const Index*                nodes;      ///< First edge of each node in the batch
+    size_t                      count;      ///< Nodes in the batch
+    std::vector<Index>          bases;      ///< Base found for each
+    BasePlacer::Claims          claims[PLACE_LANES];
+  };
+
+  // Find bases for the nodes of a batch that go in one lane, none overlapping
+  // another in the lane. Node n of the batch goes in lane n % PLACE_LANES.
+  static void find_bases( size_t lane, void* arg ) {
+    PlaceJob*               job     = (PlaceJob*)arg;
+    BasePlacer::Claims&     claims  = job->claims[lane];
+    std::vector<Index>      letters;
+
+    claims.clear();
+    for ( size_t n = lane; n < job->count; n += PLACE_LANES ) {
+      node_letters( *job->dawg, job->nodes[n], &letters );
+      job->bases[n] = job->placer->find( letters, lane, &claims );
+    }
+  }
+
+  //----------------------------------------------------------------------------//
+  // DoubleArray                                                                //
+  //----------------------------------------------------------------------------//
+
+  const uint32_t DoubleArray::NO_BASE;
+
+  // Destructor
+  DoubleArray::~DoubleArray() {
+    clear();
+  }
+
+  // Clear data
+  void DoubleArray::clear() {
+    if ( units_ != NULL )
+      delete [] units_;
+    units_      = NULL;
+    num_units_  = 0;
+    root_       = 0;
+  }
+
+  // Convert a DAWG into a double array
+  Status DoubleArray::build( const DAWG& dawg, unsigned threads ) {
+    clear();
+
+    if ( dawg.num_edges() == 0 ) {
+      error_() << "DAWG is empty";
+      return FAILURE;
+    }
+
+    // Visit nodes breadth-first from the root so that a node and its children
+    // are placed close together. A node is identified by its first edge.
+    std::vector<Index>  base_of( dawg.num_edges() + 1, NO_BASE );
+    std::vector<Index>  order;
+    std::vector<Index>  letters;
+    BasePlacer          placer;
+    Index               max_base = 0;
+
+    order.push_back( dawg.begin().index() );
+    base_of[order[0]] = 0;
+    for ( size_t n = 0; n < order.size(); ++n ) {
+      for ( Index i = order[n]; ; ++i ) {
+        const Edge* edge = dawg.edge(i);
+        // Queue children we haven't seen yet
+        if ( edge->child() != 0 && base_of[edge->child()] == NO_BASE ) {
+          base_of[edge->child()] = 0;
+          order.push_back( edge->child() );
+        }
+        if ( edge->end_of_node() )
+          break;
+      }
+    }
+
+    // Place them a batch at a time: find bases on all threads, then claim
+    // them in order, placing again any node whose base was taken meanwhile
+    PlaceJob job;
+    job.dawg    = &dawg;
+    job.placer  = &placer;
+    for ( size_t first = 0; first < order.size(); first += PLACE_BATCH ) {
+      job.nodes = &order[first];
+      job.count = std::min( PLACE_BATCH, order.size() - first );
+      job.bases.resize( job.count );
+      placer.make_room( PLACE_BATCH * PLACE_ROOM );
+      parallel_for( PLACE_LANES, threads, find_bases, &job );
+
+      for ( size_t n = 0; n < job.count; ++n ) {
+        Index base = job.bases[n];
+        node_letters( dawg, job.nodes[n], &letters );
+        if ( !placer.claim( base, letters ) )
+          base = placer.place( letters, n % PLACE_LANES );
+        if ( base > MAX_BASE - NUM_LETTERS ) {
+          error_() << "Double array is full";
+          return FAILURE;
+        }
+        base_of[job.nodes[n]] = base;
+        if ( base > max_base )
+          max_base = base;
+      }
+    }
+
+    // Allocate units. Every base gets a full row of letters after it so lookups
+    // never need a bounds check, including from the leaf base 0.
+    num_units_  = max_base + NUM_LETTERS;
+    units_      = new Unit[num_units_];
+    for ( Index i = 0; i < num_units_; ++i ) {
+      units_[i].check = NO_BASE;
+      units_[i].value = 0;
+    }
+
+    // Fill in transitions
+    for ( size_t n = 0; n < order.size(); ++n ) {
+      Index base = base_of[order[n]];
+      for ( Index i = order[n]; ; ++i ) {
+        const Edge* edge  = dawg.edge(i);
+        Unit&       unit  = units_[base + (unsigned char)edge->letter()];
+        Index       child = edge->child() != 0 ? base_of[edge->child()] : 0;
+        unit.check = base;
+        unit.value = (child << 1) | (edge->end_of_word() ? 1 : 0);
+        if ( edge->end_of_node() )
+          break;
+      }
+    }
+
+    root_ = base_of[order[0]];
+
+    // success
+    return SUCCESS;
+  }
+
+  bool DoubleArray::contains_word( const std::string& word ) const {
+    std::string::const_iterator si;
+    Index                       base = root_;
+    bool                        eow  = false;
+
+    assert( units_ != NULL );
+    for ( si = word.begin(); si != word.end(); ++si ) {
+      const Unit& unit = units_[base + (unsigned char)*si];
+      if ( unit.check != base )
+        return false;
+      eow  = unit.value & 1;
+      base = unit.value >> 1;
+    }
+
+    return eow;
+  }
+
+}
@@ -0,0 +1,61 @@
+#ifndef _DOUBLE_ARRAY_HH
+#define _DOUBLE_ARRAY_HH 1
+
+#include "dawg.hh"
+
+namespace DAWG {
+
+  /// A double-array (base/check) encoding of a DAWG.
+  ///
+  /// Every DAWG node is given a base offset. The edge for letter c of a node
+  /// with base b lives in unit b+c, which records the owning base (check) and
+  /// the base of the child node. Units point at bases rather than being states
+  /// themselves, so suffix nodes shared in the DAWG stay shared here, and a
+  /// transition is a single array lookup instead of a scan through the node.
+  class DoubleArray {
+    public:
+      /// Default constructor
+      DoubleArray() : num_units_(0), units_(NULL), root_(0) {};
+
+      /// Destructor
+      ~DoubleArray();
+
+      /// Clear data.
+      void clear();
+
+      /// Convert a DAWG into a double array. Bases are looked for on several
+      /// threads and then claimed in order, so the array comes out the same
+      /// however many threads there are.
+      Status build(
+          const DAWG&   dawg,           ///< The DAWG to convert
+          unsigned      threads = 0     ///< Threads to place bases with, 0 for one per CPU
+      );
+
+      /// See if a word is in the double array.
+      bool contains_word(
+          const std::string& word   ///< Word to look for
+      ) const;
+
+      /// Number of units in the array.
+      inline Index num_units() const { return num_units_; }
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      /// A slot in the double array.
+      struct Unit {
+        uint32_t  check;    ///< Base of the node owning this slot, or NO_BASE
+        uint32_t  value;    ///< Base of the child node << 1 | end-of-word
+      };
+
+      static const uint32_t NO_BASE = 0xFFFFFFFF;
+
+      Index                 num_units_;     ///< Number of units
+      Unit*                 units_;         ///< Units
+      Index                 root_;          ///< Base of the root node
+      Error                 error_;
+  };
+}
+
+#endif /* not _DOUBLE_ARRAY_HH */
@@ -0,0 +1,157 @@
+#include "grid.hh"
+#include "parallel.hh"
+#include <algorithm>
+
+namespace DAWG {
+
+  /// A grid being searched, with the words found from each starting tile.
+  struct GridJob {
+    const DAWG*                             dawg;
+    const std::vector<std::string>*         tiles;
+    std::vector< std::vector<Index> >       neighbours;     ///< Tiles next to each tile
+    unsigned                                min_length;
+    const CancelToken*                      cancel;         ///< Stops the search once cancelled, or NULL
+    std::vector< std::vector<std::string> > found;          ///< Words found from each tile
+  };
+
+  /// One path through the grid.
+  class GridPath {
+    public:
+      GridPath( const GridJob& job, std::vector<std::string>* found );
+
+      void  walk( Index node, Index tile );
+
+    private:
+      const DAWG&                               dawg_;
+      const std::vector<std::string>&           tiles_;
+      const std::vector< std::vector<Index> >&  neighbours_;
+      unsigned                                  min_length_;
+      const CancelToken*                        cancel_;
+      std::vector<uint64_t>                     used_;      ///< Bitmask of the tiles on the path
+      std::string                               word_;
+      std::vector<std::string>*                 found_;
+  };
+
+  //----------------------------------------------------------------------------//
+  // GridPath                                                                   //
+  //----------------------------------------------------------------------------//
+
+  GridPath::GridPath( const GridJob& job, std::vector<std::string>* found )
+    : dawg_(*job.dawg), tiles_(*job.tiles), neighbours_(job.neighbours),
+      min_length_(job.min_length), cancel_(job.cancel), used_((tiles_.size() + 63) / 64), found_(found) {
+  }
+
+  // Step onto a tile from a node, following its letters down the DAWG, then
+  // on to each neighbour not yet on the path
+  void GridPath::walk( Index node, Index tile ) {
+    const std::string&  letters = tiles_[tile];
+    const Edge*         edge    = NULL;
+
+    if ( cancel_ != NULL && cancel_->cancelled() )
+      return;
+    for ( size_t l = 0; l < letters.length(); ++l ) {
+      if ( node == 0 )
+        return;
+      for ( Index i = node; ; ++i ) {
+        edge = dawg_.edge( i );
+        if ( edge->letter() == letters[l] )
+          break;
+        if ( edge->end_of_node() )
+          return;
+      }
+      node = edge->child();
+    }
+
+    size_t length = word_.length();
+    word_ += letters;
+    if ( edge->end_of_word() && word_.length() >= min_length_ )
+      found_->push_back( word_ );
+
+    if ( node != 0 ) {
+      used_[tile / 64] |= (uint64_t)1 << (tile % 64);
+      const std::vector<Index>& next = neighbours_[tile];
+      for ( size_t n = 0; n < next.size(); ++n ) {
+        if ( !(used_[next[n] / 64] & ((uint64_t)1 << (next[n] % 64))) )
+          walk( node, next[n] );
+      }
+      used_[tile / 64] &= ~((uint64_t)1 << (tile % 64));
+    }
+    word_.resize( length );
+  }
+
+  //----------------------------------------------------------------------------//
+  // GridSearch                                                                 //
+  //----------------------------------------------------------------------------//
+
+  static bool before( const std::string& a, const std::string& b ) {
+    return compare_words( a, b ) < 0;
+  }
+
+  // Walk all the paths from one tile
+  static void search_tile( size_t tile, void* p ) {
+    GridJob*    job     = (GridJob*)p;
+    GridPath    path( *job, &job->found[tile] );
+    path.walk( job->dawg->begin().index(), tile );
+  }
+
+  GridSearch::GridSearch( const DAWG& dawg ) : dawg_(dawg) {
+  }
+
+  Status GridSearch::solve( const std::string& grid, unsigned width, std::vector<std::string>* words,
+                            unsigned min_length, unsigned threads, const CancelToken* cancel ) {
+    std::vector<std::string> tiles( grid.length() );
+    for ( size_t i = 0; i < grid.length(); ++i )
+      tiles[i] = grid[i];
+    return solve( tiles, width, words, min_length, threads, cancel );
+  }
+
+  // Search from each tile, then merge what was found
+  Status GridSearch::solve( const std::vector<std::string>& tiles, unsigned width, std::vector<std::string>* words,
+                            unsigned min_length, unsigned threads, const CancelToken* cancel ) {
+    words->clear();
+    if ( width == 0 || tiles.size() % width != 0 ) {
+      error_() << "Grid of " << tiles.size() << " tiles is not made of rows of " << width;
+      return FAILURE;
+    }
+    for ( size_t i = 0; i < tiles.size(); ++i ) {
+      if ( tiles[i].empty() ) {
+        error_() << "Tile " << i << " is empty";
+        return FAILURE;
+      }
+    }
+    if ( dawg_.num_edges() == 0 )
+      return SUCCESS;
+
+    GridJob job;
+    Index   height  = tiles.size() / width;
+    job.dawg        = &dawg_;
+    job.tiles       = &tiles;
+    job.min_length  = min_length;
+    job.cancel      = cancel;
+    job.neighbours.resize( tiles.size() );
+    job.found.resize( tiles.size() );
+    for ( Index row = 0; row < height; ++row ) {
+      for ( Index column = 0; column < width; ++column ) {
+        for ( Index r = row > 0 ? row - 1 : 0; r <= row + 1 && r < height; ++r ) {
+          for ( Index c = column > 0 ? column - 1 : 0; c <= column + 1 && c < width; ++c ) {
+            if ( r != row || c != column )
+              job.neighbours[row * width + column].push_back( r * width + c );
+          }
+        }
+      }
+    }
+
+    parallel_for( tiles.size(), threads, search_tile, &job );
+
+    for ( size_t i = 0; i < job.found.size(); ++i )
+      words->insert( words->end(), job.found[i].begin(), job.found[i].end() );
+    std::sort( words->begin(), words->end(), before );
+    words->erase( std::unique( words->begin(), words->end() ), words->end() );
+    if ( cancel != NULL && cancel->cancelled() ) {
+      error_() << "Search cancelled";
+      return FAILURE;
+    }
+    return SUCCESS;
+  }
+
+}
@@ -0,0 +1,56 @@
+#ifndef _GRID_HH
+#define _GRID_HH 1
+
+#include "dawg.hh"
+#include "query.hh"
+#include <string>
+#include <vector>
+
+namespace DAWG {
+
+  /// Finds every word of a DAWG that can be traced on a grid of tiles, as in
+  /// Boggle: each step goes to one of the eight neighbouring tiles, and no
+  /// tile is used twice in a word. Tiles may hold more than one letter, like
+  /// Boggle's "qu".
+  ///
+  /// The search walks the grid and the DAWG together, so a path stops as
+  /// soon as no word starts with its letters. Tiles already on the path are
+  /// kept as a bitmask. Each starting tile can be searched on a thread of
+  /// its own; words found more than once are reported once.
+  class GridSearch {
+    public:
+      GridSearch(
+          const DAWG&   dawg        ///< Dictionary; must outlive the search
+      );
+
+      /// Find the words on a grid of tiles of one letter each.
+      Status solve(
+          const std::string&        grid,               ///< Tiles, row by row
+          unsigned                  width,              ///< Tiles in a row
+          std::vector<std::string>* words,              ///< Receives the words, in DAWG order
+          unsigned                  min_length = 1,     ///< Shortest word to report
+          unsigned                  threads = 1,        ///< Threads to use, 0 for one per CPU
+          const CancelToken*        cancel = NULL       ///< Stop once this is cancelled, NULL for never
+      );
+
+      /// Find the words on a grid of tiles. A search that is cancelled fails,
+      /// leaving the words it found before it stopped.
+      Status solve(
+          const std::vector<std::string>&   tiles,      ///< Tiles, row by row
+          unsigned                  width,              ///< Tiles in a row
+          std::vector<std::string>* words,              ///< Receives the words, in DAWG order
+          unsigned                  min_length = 1,     ///< Shortest word to report
+          unsigned                  threads = 1,        ///< Threads to use, 0 for one per CPU
+          const CancelToken*        cancel = NULL       ///< Stop once this is cancelled, NULL for never
+      );
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      const DAWG&   dawg_;
+      Error         error_;
+  };
+}
+
+#endif /* not _GRID_HH */
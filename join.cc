@@ -0,0 +1,250 @@
+#include "join.hh"
+
+namespace DAWG {
+
+  const size_t BATCH_PAIRS = 1024;      /// Pairs a thread gathers before handing them over.
+
+  /// A path of the second walk: its last edge, 0 for the empty path, its
+  /// length, and its distance from the first word so far. Lists of them are
+  /// in DAWG order, a path before the paths below it, and keep a path over
+  /// the distance only if a path below it is within it.
+  struct SelfJoin::Entry {
+    Index       edge;
+    uint16_t    depth;
+    uint16_t    distance;
+
+    Entry( Index e, size_t d, unsigned dist ) : edge(e), depth((uint16_t)d), distance((uint16_t)dist) {}
+  };
+
+  /// A pair waiting to be handed over.
+  struct SelfJoin::Found {
+    std::string first;
+    std::string second;
+    unsigned    distance;
+  };
+
+  /// One thread's walk of the first words.
+  class SelfJoin::Walker {
+    public:
+      Walker( SelfJoin* join );
+
+      /// Join the words below one of the root edges.
+      void walk( Index root );
+
+    private:
+      SelfJoin*                           join_;
+      const DAWG&                         dawg_;
+      unsigned                            max_distance_;
+      std::vector< std::vector<Entry> >   lists_;     ///< Close paths for each length of the first word
+      std::string                         first_;
+      std::string                         second_;
+      bool                                is_word_;   ///< first_ is a word
+      bool                                close_;     ///< Some path is within the distance of first_
+      bool                                stopped_;   ///< Sink asked to stop
+      std::vector<Found>                  found_;
+
+      void  seed( Index node, size_t depth );
+      void  visit( Index index );
+      void  extend( const std::vector<Entry>& old, std::vector<Entry>* out, Index node,
+                    size_t depth, unsigned old_parent, unsigned new_parent, bool prefix, size_t* cursor );
+      void  extend_edge( const std::vector<Entry>& old, std::vector<Entry>* out, Index index,
+                         size_t depth, unsigned old_parent, unsigned new_parent, bool prefix, size_t* cursor );
+      void  skip( const std::vector<Entry>& old, size_t depth, size_t* cursor );
+  };
+
+  //----------------------------------------------------------------------------//
+  // SelfJoin::Walker                                                           //
+  //----------------------------------------------------------------------------//
+
+  // The empty first word is as far from each path as it is long
+  SelfJoin::Walker::Walker( SelfJoin* join )
+    : join_(join), dawg_(join->dawg_), max_distance_(join->max_distance_), lists_(1), is_word_(false), close_(false), stopped_(false) {
+    lists_[0].push_back( Entry( 0, 0, 0 ) );
+    if ( max_distance_ > 0 )
+      seed( dawg_.begin().index(), 0 );
+  }
+
+  // Every path no longer than the distance
+  void SelfJoin::Walker::seed( Index node, size_t depth ) {
+    for ( Index i = node; ; ++i ) {
+      const Edge* edge = dawg_.edge( i );
+      lists_[0].push_back( Entry( i, depth + 1, depth + 1 ) );
+      if ( depth + 1 < max_distance_ && edge->child() != 0 )
+        seed( edge->child(), depth + 1 );
+      if ( edge->end_of_node() )
+        break;
+    }
+  }
+
+  void SelfJoin::Walker::walk( Index root ) {
+    visit( root );
+    if ( !stopped_ )
+      join_->flush( &found_ );
+  }
+
+  // Add an edge's letter to the first word, and go on below it while any
+  // path is still close
+  void SelfJoin::Walker::visit( Index index ) {
+    const Edge* edge    = dawg_.edge( index );
+    size_t      depth   = first_.length();
+    size_t      cursor  = 1;
+    unsigned    empty   = depth + 1 <= max_distance_ ? depth + 1 : max_distance_ + 1;
+
+    // A cancelled join stops like one whose sink asked it to
+    if ( join_->cancel_ != NULL && join_->cancel_->cancelled() ) {
+      stopped_ = true;
+      return;
+    }
+
+    first_.push_back( edge->letter() );
+    is_word_ = edge->end_of_word();
+    close_   = empty <= max_distance_;
+    if ( lists_.size() < depth + 2 )
+      lists_.resize( depth + 2 );
+
+    std::vector<Entry>& out = lists_[depth + 1];
+    out.clear();
+    out.push_back( Entry( 0, 0, empty ) );
+    extend( lists_[depth], &out, dawg_.begin().index(), 0, lists_[depth][0].distance, empty, true, &cursor );
+
+    if ( close_ && edge->child() != 0 ) {
+      for ( Index i = edge->child(); !stopped_; ++i ) {
+        visit( i );
+        if ( dawg_.edge( i )->end_of_node() )
+          break;
+      }
+    }
+    first_.resize( depth );
+  }
+
+  // Make the new list for the paths below one, walking the old list along
+  // with them. Unless the path itself is close, in the old list or in the
+  // new, only paths in the old list can come close.
+  void SelfJoin::Walker::extend( const std::vector<Entry>& old, std::vector<Entry>* out, Index node,
+                                 size_t depth, unsigned old_parent, unsigned new_parent, bool prefix, size_t* cursor ) {
+    if ( old_parent > max_distance_ && new_parent >= max_distance_ ) {
+      while ( *cursor < old.size() && old[*cursor].depth == depth + 1 )
+        extend_edge( old, out, old[*cursor].edge, depth, old_parent, new_parent, prefix, cursor );
+    } else {
+      for ( Index i = node; ; ++i ) {
+        extend_edge( old, out, i, depth, old_parent, new_parent, prefix, cursor );
+        if ( dawg_.edge( i )->end_of_node() )
+          break;
+      }
+    }
+  }
+
+  // Add the path through one edge to the new list, and the paths below it.
+  // prefix says whether the path so far is a prefix of the first word;
+  // below one that isn't, everything sorts after the first word.
+  void SelfJoin::Walker::extend_edge( const std::vector<Entry>& old, std::vector<Entry>* out, Index index,
+                                      size_t depth, unsigned old_parent, unsigned new_parent, bool prefix, size_t* cursor ) {
+    const Edge* edge    = dawg_.edge( index );
+    bool        within  = depth < first_.length();
+    unsigned    was     = max_distance_ + 1;
+    bool        below   = false;
+
+    if ( *cursor < old.size() && old[*cursor].depth == depth + 1 && old[*cursor].edge == index ) {
+      was   = old[(*cursor)++].distance;
+      below = *cursor < old.size() && old[*cursor].depth > depth + 1;
+    }
+
+    // Words below here sort before the first word, and find it themselves
+    if ( prefix && within && edge->letter() < first_[depth] ) {
+      skip( old, depth, cursor );
+      return;
+    }
+
+    bool        same        = prefix && within && edge->letter() == first_[depth];
+    unsigned    distance    = old_parent + (edge->letter() != first_[first_.length() - 1]);
+    if ( was + 1 < distance )
+      distance = was + 1;
+    if ( new_parent + 1 < distance )
+      distance = new_parent + 1;
+    if ( distance > max_distance_ )
+      distance = max_distance_ + 1;
+
+    size_t mark = out->size();
+    out->push_back( Entry( index, depth + 1, distance ) );
+    second_.push_back( edge->letter() );
+
+    if ( distance <= max_distance_ ) {
+      close_ = true;
+      if ( is_word_ && edge->end_of_word() && !same ) {
+        found_.resize( found_.size() + 1 );
+        found_.back().first     = first_;
+        found_.back().second    = second_;
+        found_.back().distance  = distance;
+        if ( found_.size() >= BATCH_PAIRS )
+          stopped_ = !join_->flush( &found_ );
+      }
+    }
+
+    if ( edge->child() != 0 && (distance < max_distance_ || was <= max_distance_ || below) )
+      extend( old, out, edge->child(), depth + 1, was, distance, same, cursor );
+    else
+      skip( old, depth, cursor );
+
+    second_.resize( depth );
+    if ( distance > max_distance_ && out->size() == mark + 1 )
+      out->pop_back();
+  }
+
+  // Pass over the old list's paths below a path
+  void SelfJoin::Walker::skip( const std::vector<Entry>& old, size_t depth, size_t* cursor ) {
+    while ( *cursor < old.size() && old[*cursor].depth > depth + 1 )
+      ++(*cursor);
+  }
+
+  //----------------------------------------------------------------------------//
+  // SelfJoin                                                                   //
+  //----------------------------------------------------------------------------//
+
+  SelfJoin::SelfJoin( const DAWG& dawg, unsigned max_distance )
+    : dawg_(dawg), max_distance_(max_distance), sink_(NULL), cancel_(NULL), stopped_(false), num_pairs_(0) {
+  }
+
+  // Walk each root edge's words on whichever thread is free
+  size_t SelfJoin::run( PairSink* sink, unsigned threads, const CancelToken* cancel ) {
+    sink_       = sink;
+    cancel_     = cancel;
+    stopped_    = false;
+    num_pairs_  = 0;
+    if ( dawg_.num_edges() == 0 )
+      return 0;
+
+    Index root = dawg_.begin().index();
+    Index count = 0;
+    while ( !dawg_.edge( root + count++ )->end_of_node() )
+      ;
+    parallel_for( count, threads, join_letter, this );
+    return num_pairs_;
+  }
+
+  void SelfJoin::join_letter( size_t letter, void* p ) {
+    SelfJoin* join = (SelfJoin*)p;
+    join->lock_.lock();
+    bool stopped = join->stopped_;
+    join->lock_.unlock();
+    if ( stopped || (join->cancel_ != NULL && join->cancel_->cancelled()) )
+      return;
+    Walker walker( join );
+    walker.walk( join->dawg_.begin().index() + letter );
+  }
+
+  // Hand a batch of pairs to the sink
+  bool SelfJoin::flush( std::vector<Found>* found ) {
+    lock_.lock();
+    for ( size_t i = 0; i < found->size() && !stopped_; ++i ) {
+      Found& pair = (*found)[i];
+      ++num_pairs_;
+      if ( !sink_->found( pair.first, pair.second, pair.distance ) )
+        stopped_ = true;
+    }
+    bool stopped = stopped_;
+    lock_.unlock();
+    found->clear();
+    return !stopped;
+  }
+
+}
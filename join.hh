@@ -0,0 +1,76 @@
+#ifndef _JOIN_HH
+#define _JOIN_HH 1
+
+#include "dawg.hh"
+#include "parallel.hh"
+#include "query.hh"
+#include <string>
+#include <vector>
+
+namespace DAWG {
+
+  /// Receives the pairs a SelfJoin finds.
+  class PairSink {
+    public:
+      virtual ~PairSink() {}
+
+      /// Take a pair of words. Calls come from several threads, but never
+      /// two at once.
+      /// @return   whether to go on
+      virtual bool found(
+          const std::string&    first,      ///< Word that comes first in DAWG order
+          const std::string&    second,     ///< The other word
+          unsigned              distance    ///< Edit distance between them
+      ) = 0;
+  };
+
+  /// Finds every pair of words of a DAWG within an edit distance of each
+  /// other, by walking the DAWG against itself.
+  ///
+  /// Walking down the first word, the join keeps a list of the paths of the
+  /// second walk that are within the distance of the first word so far, in
+  /// DAWG order, with their distances. Each letter of the first word makes a
+  /// new list from the old, walking the two together: a path's distance
+  /// comes from its own and its parent's in the old list and its parent's in
+  /// the new one, as in a row of the usual table. Where the new list is
+  /// empty nothing longer can be close, and the walk goes back up.
+  ///
+  /// Each pair is found once, from its first word: second paths that sort
+  /// before the first word aren't walked. The first letters of the first
+  /// words are shared out among threads, and each thread hands its pairs to
+  /// the sink a batch at a time, in order.
+  class SelfJoin {
+    public:
+      SelfJoin(
+          const DAWG&   dawg,           ///< Dictionary to join
+          unsigned      max_distance    ///< Largest edit distance between a pair
+      );
+
+      /// Find the pairs. Cancelling stops the join soon after, as if the
+      /// sink had asked to stop.
+      /// @return   number of pairs handed to the sink
+      size_t run(
+          PairSink*             sink,           ///< Receives the pairs
+          unsigned              threads = 0,    ///< Threads to use, 0 for one per CPU
+          const CancelToken*    cancel = NULL   ///< Stop once this is cancelled, NULL for never
+      );
+
+    private:
+      struct Entry;
+      struct Found;
+      class Walker;
+
+      const DAWG&           dawg_;
+      unsigned              max_distance_;
+      PairSink*             sink_;
+      const CancelToken*    cancel_;
+      Mutex                 lock_;          ///< Held while calling the sink
+      bool                  stopped_;       ///< Sink asked to stop
+      size_t                num_pairs_;
+
+      bool                  flush( std::vector<Found>* found );
+      static void           join_letter( size_t letter, void* join );
+  };
+}
+
+#endif /* not _JOIN_HH */
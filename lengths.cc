@@ -0,0 +1,39 @@
+#include "lengths.hh"
+
+namespace DAWG {
+
+  //----------------------------------------------------------------------------//
+  // LengthMasks                                                                //
+  //----------------------------------------------------------------------------//
+
+  // Measure from the root edge down
+  void LengthMasks::build( const DAWG& dawg ) {
+    dawg_ = &dawg;
+    masks_.assign( dawg.num_edges() + 1, 0 );
+    if ( dawg.num_edges() != 0 )
+      masks_[dawg.num_edges()] = node( dawg.begin().index() );
+  }
+
+  // Lengths of the words below a node, counting its own letter: each edge's
+  // lengths, one longer. Every edge leads to a word, so a node whose first
+  // edge's mask is still empty hasn't been measured yet. Children of
+  // Creator's graphs come before their parents, but rearranged ones needn't,
+  // so this recurses; it goes no deeper than the longest word.
+  LengthMask LengthMasks::node( Index node ) {
+    if ( node == 0 )
+      return 0;
+
+    bool        done    = masks_[node] != 0;
+    LengthMask  total   = 0;
+    for ( Index i = node; ; ++i ) {
+      const Edge* edge = dawg_->edge( i );
+      if ( !done )
+        masks_[i] = edge->end_of_word() | this->node( edge->child() );
+      total |= masks_[i];
+      if ( edge->end_of_node() )
+        break;
+    }
+    return total << 1;
+  }
+
+}
@@ -0,0 +1,69 @@
+#ifndef _LENGTHS_HH
+#define _LENGTHS_HH 1
+
+#include "dawg.hh"
+#include <vector>
+
+namespace DAWG {
+
+  /// A set of word lengths, one bit each. Words are shorter than 32 letters,
+  /// so every length has a bit.
+  typedef uint32_t LengthMask;
+
+  /// The lengths of the words below every edge of a DAWG, so a walk after
+  /// words of certain lengths can pass over an edge with none below it
+  /// without looking. Bit n of an edge's mask is set if a word ends n
+  /// letters after the edge: bit 0 if the edge ends one itself. The root
+  /// edge's mask holds the length of every word.
+  class LengthMasks {
+    public:
+      /// Default constructor
+      LengthMasks() : dawg_(NULL) {}
+
+      /// Find the lengths below every edge of a DAWG, in one pass. The DAWG
+      /// must outlive the masks.
+      void build(
+          const DAWG&   dawg        ///< DAWG to measure
+      );
+
+      /// Lengths of the words that end at or below an edge, counting from it.
+      inline LengthMask edge(
+          Index         index       ///< Index of the edge
+      ) const {
+        return masks_[index];
+      }
+
+      /// Lengths of all the words.
+      inline LengthMask words() const { return masks_.empty() ? 0 : masks_.back(); }
+
+      /// See if a mask has a length.
+      static inline bool has(
+          LengthMask    mask,       ///< Lengths
+          size_t        length      ///< Length to look for
+      ) {
+        return length < 32 && ((mask >> length) & 1) != 0;
+      }
+
+      /// The lengths from min to max.
+      static inline LengthMask range(
+          size_t        min,        ///< Shortest length
+          size_t        max         ///< Longest length
+      ) {
+        if ( min > max || min >= 32 )
+          return 0;
+        LengthMask upto = max >= 31 ? ~(LengthMask)0 : ((LengthMask)1 << (max + 1)) - 1;
+        return upto & ~(((LengthMask)1 << min) - 1);
+      }
+
+      /// Bytes used, not counting the DAWG.
+      inline size_t memory() const { return masks_.size() * sizeof(LengthMask); }
+
+    private:
+      const DAWG*               dawg_;
+      std::vector<LengthMask>   masks_;     ///< For each edge, then the root edge
+
+      LengthMask    node( Index node );
+  };
+}
+
+#endif /* not _LENGTHS_HH */
@@ -0,0 +1,90 @@
+#include "numbering.hh"
+
+namespace DAWG {
+
+  const Index NOT_COUNTED = 0xFFFFFFFF;     /// Marks a node whose words haven't been counted.
+
+  //----------------------------------------------------------------------------//
+  // WordNumbering                                                              //
+  //----------------------------------------------------------------------------//
+
+  // Count the words below every reachable node
+  void WordNumbering::build( const DAWG& dawg ) {
+    dawg_ = &dawg;
+    counts_.assign( dawg.num_edges() + 1, NOT_COUNTED );
+    counts_[0] = 0;
+    num_words_ = dawg.num_edges() != 0 ? count( dawg.begin().index() ) : 0;
+  }
+
+  // Words below a node. Children of Creator's graphs come before their
+  // parents, but rearranged ones needn't, so this recurses; it goes no deeper
+  // than the longest word.
+  Index WordNumbering::count( Index node ) {
+    if ( counts_[node] != NOT_COUNTED )
+      return counts_[node];
+
+    Index total = 0;
+    for ( Index i = node; ; ++i ) {
+      const Edge* edge = dawg_->edge( i );
+      total += edge->end_of_word() + count( edge->child() );
+      if ( edge->end_of_node() )
+        break;
+    }
+    counts_[node] = total;
+    return total;
+  }
+
+  // Walk down the word, adding up the words on edges passed over
+  bool WordNumbering::rank( const std::string& word, Index* number ) const {
+    Index node  = dawg_ != NULL && dawg_->num_edges() != 0 ? dawg_->begin().index() : 0;
+    Index n     = 0;
+
+    for ( size_t pos = 0; pos < word.length(); ++pos ) {
+      const Edge* edge = NULL;
+      for ( Index i = node; ; ++i ) {
+        if ( i == 0 )
+          return false;
+        edge = dawg_->edge( i );
+        if ( edge->letter() == word[pos] )
+          break;
+        n += edge->end_of_word() + counts_[edge->child()];
+        if ( edge->end_of_node() )
+          return false;
+      }
+      if ( pos + 1 == word.length() ) {
+        *number = n;
+        return edge->end_of_word();
+      }
+      n   += edge->end_of_word();
+      node = edge->child();
+    }
+    return false;
+  }
+
+  // Walk down, passing over every edge with all its words before the number
+  bool WordNumbering::unrank( Index number, std::string* word ) const {
+    if ( number >= num_words_ )
+      return false;
+
+    Index node = dawg_->begin().index();
+    word->clear();
+    for ( ; ; ) {
+      for ( Index i = node; ; ++i ) {
+        const Edge* edge    = dawg_->edge( i );
+        Index       words   = edge->end_of_word() + counts_[edge->child()];
+        if ( number < words ) {
+          word->push_back( edge->letter() );
+          if ( edge->end_of_word() ) {
+            if ( number == 0 )
+              return true;
+            --number;
+          }
+          node = edge->child();
+          break;
+        }
+        number -= words;
+      }
+    }
+  }
+
+}
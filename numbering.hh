@@ -0,0 +1,53 @@
+#ifndef _NUMBERING_HH
+#define _NUMBERING_HH 1
+
+#include "dawg.hh"
+#include <string>
+#include <vector>
+
+namespace DAWG {
+
+  /// Numbers the words of a DAWG from 0 in DAWG order, and turns numbers back
+  /// into words, by counting the words below every node. A word's number is
+  /// the words before it: each edge passed over on the way down adds its own
+  /// word, if it ends one, and the words below it.
+  class WordNumbering {
+    public:
+      /// Default constructor
+      WordNumbering() : dawg_(NULL), num_words_(0) {}
+
+      /// Count the words of a DAWG. The DAWG must outlive the numbering.
+      void build(
+          const DAWG&   dawg        ///< DAWG to number
+      );
+
+      /// Number of words in the DAWG.
+      inline Index num_words() const { return num_words_; }
+
+      /// Find a word's number.
+      /// @return   whether the word is in the DAWG
+      bool rank(
+          const std::string&    word,       ///< Word to look for
+          Index*                number      ///< Receives its number
+      ) const;
+
+      /// Find the word with a number.
+      /// @return   whether there is such a word
+      bool unrank(
+          Index                 number,     ///< Number of the word
+          std::string*          word        ///< Receives the word
+      ) const;
+
+      /// Bytes used, not counting the DAWG.
+      inline size_t memory() const { return counts_.size() * sizeof(Index); }
+
+    private:
+      const DAWG*           dawg_;
+      std::vector<Index>    counts_;    ///< Words below each node's first edge
+      Index                 num_words_;
+
+      Index     count( Index node );
+  };
+}
+
+#endif /* not _NUMBERING_HH */
@@ -0,0 +1,66 @@
+#include "parallel.hh"
+#include <vector>
+
+#ifdef __unix__
+# include <unistd.h>
+#endif /* __unix__ */
+
+namespace DAWG {
+
+  //----------------------------------------------------------------------------//
+  // parallel_for                                                               //
+  //----------------------------------------------------------------------------//
+
+  /// Work shared by the threads of a parallel_for().
+  struct ParallelJob {
+    size_t      count;
+    size_t      next;       ///< Next item to hand out
+    void        (*run)( size_t, void* );
+    void*       arg;
+    Mutex       lock;
+  };
+
+  // Take items until there are none left
+  static void* parallel_worker( void* p ) {
+    ParallelJob* job = (ParallelJob*)p;
+    for ( ; ; ) {
+      job->lock.lock();
+      size_t i = job->next++;
+      job->lock.unlock();
+      if ( i >= job->count )
+        return NULL;
+      job->run( i, job->arg );
+    }
+  }
+
+  // Start the workers, and work alongside them
+  void parallel_for( size_t count, unsigned threads, void (*run)( size_t, void* ), void* arg ) {
+    ParallelJob job;
+    job.count   = count;
+    job.next    = 0;
+    job.run     = run;
+    job.arg     = arg;
+
+#ifdef __unix__
+    if ( threads == 0 ) {
+      long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+      threads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    if ( threads > count )
+      threads = count;
+
+    std::vector<pthread_t> workers;
+    for ( unsigned t = 1; t < threads; ++t ) {
+      pthread_t worker;
+      if ( pthread_create( &worker, NULL, parallel_worker, &job ) == 0 )
+        workers.push_back( worker );
+    }
+    parallel_worker( &job );
+    for ( size_t t = 0; t < workers.size(); ++t )
+      pthread_join( workers[t], NULL );
+#else /* not __unix__ */
+    parallel_worker( &job );
+#endif /* not __unix__ */
+  }
+
+}
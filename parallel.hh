@@ -0,0 +1,40 @@
+#ifndef _PARALLEL_HH
+#define _PARALLEL_HH 1
+
+#include <stddef.h>
+
+#ifdef __unix__
+# include <pthread.h>
+#endif /* __unix__ */
+
+namespace DAWG {
+
+  /// Call run(i, arg) for every i below count, on up to threads threads, 0
+  /// for one per CPU. Items are handed out one at a time, so uneven ones
+  /// balance out. Where there are no threads it all runs on this one.
+  void parallel_for(
+      size_t        count,                      ///< Number of items
+      unsigned      threads,                    ///< Most threads to use, 0 for one per CPU
+      void          (*run)( size_t, void* ),    ///< Does one item
+      void*         arg                         ///< Passed to run
+  );
+
+  /// A mutex, which does nothing where there are no threads.
+  class Mutex {
+    public:
+#ifdef __unix__
+      Mutex()                   { pthread_mutex_init( &mutex_, NULL ); }
+      ~Mutex()                  { pthread_mutex_destroy( &mutex_ ); }
+      inline void lock()        { pthread_mutex_lock( &mutex_ ); }
+      inline void unlock()      { pthread_mutex_unlock( &mutex_ ); }
+
+    private:
+      pthread_mutex_t   mutex_;
+#else /* not __unix__ */
+      inline void lock()        {}
+      inline void unlock()      {}
+#endif /* not __unix__ */
+  };
+}
+
+#endif /* not _PARALLEL_HH */
@@ -0,0 +1,259 @@
+#include "patch.hh"
+#include "query.hh"
+
+namespace DAWG {
+
+  const uint32_t PATCH_MAGIC    = 0xC6ACC2D1;               /// Identifies patches we write.
+  const uint64_t HASH_MULTIPLY  = 0x9E3779B97F4A7C15ULL;    /// Odd constant for mixing subtree hashes.
+
+  /// Walks two DAWGs together, collecting the words only one of them has.
+  class Differ {
+    public:
+      Differ( const DAWG& from, const DAWG& to,
+              std::vector<std::string>* removed, std::vector<std::string>* added )
+        : from_(from), to_(to), from_hashes_(from.num_edges() + 1, 0),
+          to_hashes_(to.num_edges() + 1, 0), removed_(removed), added_(added) {}
+
+      /// Compare the nodes below two edges with the same path.
+      void diff( Index from_node, Index to_node );
+
+    private:
+      const DAWG&               from_;
+      const DAWG&               to_;
+      std::vector<uint64_t>     from_hashes_;   ///< Subtree hash of each node, 0 until known
+      std::vector<uint64_t>     to_hashes_;
+      std::vector<std::string>* removed_;
+      std::vector<std::string>* added_;
+      std::string               word_;          ///< Path to the nodes being compared
+
+      uint64_t  hash( const DAWG& dawg, std::vector<uint64_t>* hashes, Index node );
+      void      collect( const DAWG& dawg, Index node, std::vector<std::string>* out );
+  };
+
+  // Hash of the words below a node. Creator builds minimal graphs, so two
+  // nodes have the same words below them exactly when their subgraphs have
+  // the same shape, whatever their indices.
+  uint64_t Differ::hash( const DAWG& dawg, std::vector<uint64_t>* hashes, Index node ) {
+    if ( node == 0 )
+      return 1;
+    if ( (*hashes)[node] != 0 )
+      return (*hashes)[node];
+
+    uint64_t h = 0;
+    for ( Index i = node; ; ++i ) {
+      const Edge& edge = *dawg.edge( i );
+      h = (h + ((edge.data() & 0x1FF) | 0x200)) * HASH_MULTIPLY;
+      h = (h ^ hash( dawg, hashes, edge.child() )) * HASH_MULTIPLY;
+      if ( edge.end_of_node() )
+        break;
+    }
+    h |= 1; // never 0, which means unknown
+    (*hashes)[node] = h;
+    return h;
+  }
+
+  // Every word below a node
+  void Differ::collect( const DAWG& dawg, Index node, std::vector<std::string>* out ) {
+    if ( node == 0 )
+      return;
+    for ( Index i = node; ; ++i ) {
+      const Edge& edge = *dawg.edge( i );
+      word_.push_back( edge.letter() );
+      if ( edge.end_of_word() )
+        out->push_back( word_ );
+      collect( dawg, edge.child(), out );
+      word_.erase( word_.length() - 1 );
+      if ( edge.end_of_node() )
+        break;
+    }
+  }
+
+  // Merge the edges of the two nodes by letter. Words are found in order
+  // because each edge's word comes before the words below it.
+  void Differ::diff( Index from_node, Index to_node ) {
+    Index f = from_node, t = to_node;
+    while ( f != 0 || t != 0 ) {
+      const Edge* from_edge = f != 0 ? from_.edge( f ) : NULL;
+      const Edge* to_edge   = t != 0 ? to_.edge( t ) : NULL;
+      bool        in_from   = from_edge != NULL && (to_edge == NULL || from_edge->letter() <= to_edge->letter());
+      bool        in_to     = to_edge != NULL && (from_edge == NULL || to_edge->letter() <= from_edge->letter());
+
+      word_.push_back( in_from ? from_edge->letter() : to_edge->letter() );
+      if ( in_from && in_to ) {
+        if ( from_edge->end_of_word() && !to_edge->end_of_word() )
+          removed_->push_back( word_ );
+        else if ( to_edge->end_of_word() && !from_edge->end_of_word() )
+          added_->push_back( word_ );
+        if ( hash( from_, &from_hashes_, from_edge->child() ) != hash( to_, &to_hashes_, to_edge->child() ) )
+          diff( from_edge->child(), to_edge->child() );
+      } else if ( in_from ) {
+        if ( from_edge->end_of_word() )
+          removed_->push_back( word_ );
+        collect( from_, from_edge->child(), removed_ );
+      } else {
+        if ( to_edge->end_of_word() )
+          added_->push_back( word_ );
+        collect( to_, to_edge->child(), added_ );
+      }
+      word_.erase( word_.length() - 1 );
+
+      if ( in_from )
+        f = from_edge->end_of_node() ? 0 : f + 1;
+      if ( in_to )
+        t = to_edge->end_of_node() ? 0 : t + 1;
+    }
+  }
+
+  // Write words, each as the length it shares with the one before, the
+  // length of the rest, and the rest
+  static void put_words( std::ostream& output, const std::vector<std::string>& words ) {
+    uint32_t count = words.size();
+    output.write( (const char*)&count, sizeof(count) );
+    for ( size_t i = 0; i < words.size(); ++i ) {
+      size_t shared = 0;
+      if ( i > 0 ) {
+        while ( shared < words[i].length() && shared < words[i - 1].length()
+                && shared < 0xFF && words[i][shared] == words[i - 1][shared] )
+          ++shared;
+      }
+      char lengths[2] = { (char)shared, (char)(words[i].length() - shared) };
+      output.write( lengths, 2 );
+      output.write( words[i].data() + shared, words[i].length() - shared );
+    }
+  }
+
+  // Read words written by put_words()
+  static bool get_words( std::istream& input, std::vector<std::string>* words ) {
+    uint32_t count = 0;
+    input.read( (char*)&count, sizeof(count) );
+    if ( input.gcount() != sizeof(count) )
+      return false;
+
+    words->clear();
+    for ( uint32_t i = 0; i < count; ++i ) {
+      unsigned char lengths[2];
+      char          rest[0xFF];
+      input.read( (char*)lengths, 2 );
+      if ( input.gcount() != 2 || (i == 0 ? lengths[0] != 0 : lengths[0] > words->back().length()) )
+        return false;
+      input.read( rest, lengths[1] );
+      if ( input.gcount() != lengths[1] )
+        return false;
+      words->push_back( i == 0 ? std::string() : words->back().substr( 0, lengths[0] ) );
+      words->back().append( rest, lengths[1] );
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------//
+  // Patch                                                                      //
+  //----------------------------------------------------------------------------//
+
+  // Clear the patch
+  void Patch::clear() {
+    added_.clear();
+    removed_.clear();
+    from_ = to_ = 0;
+  }
+
+  // Find the differences between two DAWGs
+  Status Patch::diff( const DAWG& from, const DAWG& to ) {
+    clear();
+    Differ differ( from, to, &removed_, &added_ );
+    differ.diff( from.begin().index(), to.begin().index() );
+    from_ = from.fingerprint();
+    to_   = to.fingerprint();
+    return SUCCESS;
+  }
+
+  // Build the new version: the old words without the removed ones, with the
+  // added ones merged in
+  DAWG* Patch::apply( const DAWG& from ) {
+    if ( from.fingerprint() != from_ ) {
+      error_() << "Patch is for a different dictionary";
+      return NULL;
+    }
+
+    WordIterator    words( from );
+    Creator         creator;
+    size_t          a = 0, r = 0;
+    bool            more = words.next_word();
+
+    creator.start();
+    while ( more || a < added_.size() ) {
+      const std::string* word;
+      if ( more && (a == added_.size() || compare_words( words.word(), added_[a] ) < 0) ) {
+        word = &words.word();
+        if ( r < removed_.size() && *word == removed_[r] ) {
+          ++r;
+          more = words.next_word();
+          continue;
+        }
+      } else {
+        word = &added_[a++];
+        if ( more && *word == words.word() ) {
+          error_() << "Patch adds \"" << *word << "\", which is already there";
+          return NULL;
+        }
+      }
+
+      if ( creator.add_word( *word ) != SUCCESS ) {
+        error_() << creator.error();
+        return NULL;
+      }
+      if ( word == &words.word() )
+        more = words.next_word();
+    }
+    if ( r != removed_.size() ) {
+      error_() << "Patch removes \"" << removed_[r] << "\", which isn't there";
+      return NULL;
+    }
+
+    DAWG* to = creator.finish();
+    if ( to == NULL ) {
+      error_() << creator.error();
+      return NULL;
+    }
+    if ( to->fingerprint() != to_ ) {
+      error_() << "Patched dictionary doesn't match the one the patch was made from";
+      delete to;
+      return NULL;
+    }
+    return to;
+  }
+
+  // Load a patch from a stream
+  Status Patch::load( std::istream& input ) {
+    uint32_t magic = 0;
+
+    clear();
+    input.read( (char*)&magic, sizeof(magic) );
+    if ( input.gcount() != sizeof(magic) || magic != PATCH_MAGIC ) {
+      error_() << "Not a patch";
+      return FAILURE;
+    }
+    input.read( (char*)&from_, sizeof(from_) );
+    input.read( (char*)&to_, sizeof(to_) );
+    if ( !input.good() || !get_words( input, &removed_ ) || !get_words( input, &added_ ) ) {
+      error_() << "Patch is truncated or corrupt";
+      clear();
+      return FAILURE;
+    }
+    return SUCCESS;
+  }
+
+  // Save the patch to a stream
+  Status Patch::save( std::ostream& output ) {
+    output.write( (const char*)&PATCH_MAGIC, sizeof(PATCH_MAGIC) );
+    output.write( (const char*)&from_, sizeof(from_) );
+    output.write( (const char*)&to_, sizeof(to_) );
+    put_words( output, removed_ );
+    put_words( output, added_ );
+    if ( output.fail() ) {
+      error_() << "Couldn't write patch";
+      return FAILURE;
+    }
+    return SUCCESS;
+  }
+
+}
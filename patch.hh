@@ -0,0 +1,66 @@
+#ifndef _PATCH_HH
+#define _PATCH_HH 1
+
+#include "dawg.hh"
+#include <string>
+#include <vector>
+
+namespace DAWG {
+
+  /// The words to remove from one DAWG and add to it to get another.
+  ///
+  /// diff() walks both DAWGs together and skips every pair of nodes with the
+  /// same subtree hash, so the work done is in proportion to what changed
+  /// rather than to the size of the dictionary. A saved patch holds both word
+  /// lists prefix-compressed, plus fingerprints of both DAWGs, so apply()
+  /// refuses the wrong base and checks that it built exactly the target.
+  class Patch {
+    public:
+      /// Default constructor
+      Patch() : from_(0), to_(0) {}
+
+      /// Clear the patch.
+      void clear();
+
+      /// Find the differences between two DAWGs.
+      Status diff(
+          const DAWG&   from,   ///< Old version
+          const DAWG&   to      ///< New version
+      );
+
+      /// Build the new version from the old one. The result is the same,
+      /// byte for byte, as building the new version's words with Creator.
+      /// @return   a new DAWG on success, NULL on failure
+      DAWG* apply(
+          const DAWG&   from    ///< Old version
+      );
+
+      /// Load a patch from a stream.
+      Status load(
+          std::istream& input   ///< Stream containing a saved patch
+      );
+
+      /// Save the patch to a stream.
+      Status save(
+          std::ostream& output  ///< Stream to write to
+      );
+
+      /// Words in the new version but not the old, in order.
+      inline const std::vector<std::string>& added() const { return added_; }
+
+      /// Words in the old version but not the new, in order.
+      inline const std::vector<std::string>& removed() const { return removed_; }
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      std::vector<std::string>  added_;
+      std::vector<std::string>  removed_;
+      uint64_t                  from_;      ///< Fingerprint of the old version
+      uint64_t                  to_;        ///< Fingerprint of the new version
+      Error                     error_;
+  };
+}
+
+#endif /* not _PATCH_HH */
@@ -0,0 +1,170 @@
+#include "protocol.hh"
+
+namespace DAWG {
+  namespace Protocol {
+
+    const size_t MAX_WORDS = 0xFFFF;    /// Most words a response can hold.
+
+    static inline void put_u8( std::string* out, uint8_t v ) {
+      out->push_back( (char)v );
+    }
+    static inline void put_u16( std::string* out, uint16_t v ) {
+      put_u8( out, v & 0xFF );
+      put_u8( out, v >> 8 );
+    }
+    static inline void put_u32( std::string* out, uint32_t v ) {
+      put_u16( out, v & 0xFFFF );
+      put_u16( out, v >> 16 );
+    }
+    static inline uint16_t get_u16( const char* p ) {
+      return (uint16_t)((uint8_t)p[0] | ((uint8_t)p[1] << 8));
+    }
+    static inline uint32_t get_u32( const char* p ) {
+      return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+    }
+
+    // Append a request frame
+    void encode( const Request& request, std::string* out ) {
+      put_u32( out, REQUEST_HEADER - 4 + request.key.length() );
+      put_u32( out, request.id );
+      put_u8(  out, request.op );
+      put_u8(  out, request.dict );
+      put_u8(  out, request.distance );
+      put_u8(  out, 0 );
+      put_u16( out, request.limit );
+      out->append( request.key );
+    }
+
+    // Append a response frame
+    void encode( const Response& response, std::string* out ) {
+      size_t start = out->length();
+      put_u32( out, 0 ); // filled in below
+      put_u32( out, response.id );
+      put_u8(  out, response.status );
+      put_u8(  out, 0 );
+      put_u16( out, response.words.size() );
+      for ( size_t i = 0; i < response.words.size(); ++i ) {
+        put_u8( out, response.words[i].length() );
+        out->append( response.words[i] );
+      }
+
+      std::string size;
+      put_u32( &size, out->length() - start - 4 );
+      out->replace( start, 4, size );
+    }
+
+    // Size of the frame at the start of a buffer
+    size_t frame_size( const char* data, size_t size ) {
+      if ( size < 4 )
+        return 0;
+      return 4 + get_u32( data );
+    }
+
+    // Decode a request frame
+    Status decode( const char* data, size_t size, Request* out ) {
+      if ( size < REQUEST_HEADER || size != frame_size( data, size ) )
+        return FAILURE;
+      out->id       = get_u32( data + 4 );
+      out->op       = data[8];
+      out->dict     = data[9];
+      out->distance = data[10];
+      out->limit    = get_u16( data + 12 );
+      out->key.assign( data + REQUEST_HEADER, size - REQUEST_HEADER );
+      return SUCCESS;
+    }
+
+    // Decode a response frame
+    Status decode( const char* data, size_t size, Response* out ) {
+      if ( size < RESPONSE_HEADER || size != frame_size( data, size ) )
+        return FAILURE;
+      out->id     = get_u32( data + 4 );
+      out->status = data[8];
+
+      uint16_t    count = get_u16( data + 10 );
+      const char* p     = data + RESPONSE_HEADER;
+      const char* end   = data + size;
+      out->words.resize( count );
+      for ( uint16_t i = 0; i < count; ++i ) {
+        if ( p >= end || p + 1 + (uint8_t)*p > end )
+          return FAILURE;
+        out->words[i].assign( p + 1, (uint8_t)*p );
+        p += 1 + (uint8_t)*p;
+      }
+      return SUCCESS;
+    }
+
+    // Make the key for an OP_RANGE request
+    std::string range_key( const std::string& first, const std::string& last ) {
+      std::string key;
+      put_u8( &key, first.length() );
+      return key + first + last;
+    }
+
+    // Make the cache key for a request: the version, then the request
+    // without its id
+    std::string cache_key( const Request& request, uint64_t version ) {
+      std::string key;
+      put_u32( &key, (uint32_t)version );
+      put_u32( &key, (uint32_t)(version >> 32) );
+      put_u8(  &key, request.op );
+      put_u8(  &key, request.dict );
+      put_u8(  &key, request.distance );
+      put_u16( &key, request.limit );
+      return key + request.key;
+    }
+
+    // Make the query that answers a request
+    Query* make_query( const DAWG& dawg, const Request& request ) {
+      size_t limit = request.limit != 0 ? request.limit : MAX_WORDS;
+      if ( request.op == OP_RANGE ) {
+        size_t length = request.key.empty() ? 0 : (uint8_t)request.key[0];
+        if ( request.key.empty() || 1 + length > request.key.length() )
+          return NULL;
+        return new RangeQuery( dawg, request.key.substr( 1, length ),
+                               request.key.substr( 1 + length ), limit );
+      }
+      switch ( request.op ) {
+        case OP_EXACT:  return new ExactQuery( dawg, request.key );
+        case OP_PREFIX: return new PrefixQuery( dawg, request.key, limit );
+        case OP_TOP:    return new ShortestQuery( dawg, request.key, limit );
+        case OP_FUZZY:  return new FuzzyQuery( dawg, request.key, request.distance, limit );
+        case OP_FUZZY_PREFIX:
+          return new FuzzyPrefixQuery( dawg, request.key, request.distance, limit );
+        default:        return NULL;
+      }
+    }
+
+    // Fill in a response from a finished query
+    void make_response( const Request& request, const Query* query, Response* out ) {
+      out->id     = request.id;
+      out->status = STATUS_OK;
+      out->words.clear();
+
+      switch ( query != NULL ? request.op : 0 ) {
+        case OP_EXACT:
+          if ( query->truncated() )
+            out->status = STATUS_TRUNCATED;
+          else if ( !static_cast<const ExactQuery*>(query)->found() )
+            out->status = STATUS_NOT_FOUND;
+          break;
+        case OP_PREFIX:
+        case OP_FUZZY:
+        case OP_FUZZY_PREFIX:
+        case OP_RANGE:
+          out->words = static_cast<const WalkQuery*>(query)->results();
+          if ( query->truncated() )
+            out->status = STATUS_TRUNCATED;
+          break;
+        case OP_TOP:
+          out->words = static_cast<const ShortestQuery*>(query)->results();
+          if ( query->truncated() )
+            out->status = STATUS_TRUNCATED;
+          break;
+        default:
+          out->status = STATUS_BAD_REQUEST;
+          break;
+      }
+    }
+
+  }
+}
@@ -0,0 +1,121 @@
+#ifndef _PROTOCOL_HH
+#define _PROTOCOL_HH 1
+
+#include "dawg.hh"
+#include "query.hh"
+#include <string>
+#include <vector>
+
+namespace DAWG {
+
+  /// Binary protocol for serving DAWG queries.
+  ///
+  /// Every message is a frame that starts with its own size, so a client can
+  /// write many requests without waiting and read the responses back in the
+  /// same order. All integers are little-endian.
+  ///
+  /// Request:  u32 size | u32 id | u8 op | u8 dict | u8 distance | u8 0 | u16 limit | key
+  /// Response: u32 size | u32 id | u8 status | u8 0 | u16 count | count x (u8 length | word)
+  ///
+  /// size counts the bytes after the size field itself.
+  namespace Protocol {
+    const uint8_t  OP_EXACT           = 1;    ///< Is key a word?
+    const uint8_t  OP_PREFIX          = 2;    ///< First limit words starting with key
+    const uint8_t  OP_TOP             = 3;    ///< Shortest limit words starting with key
+    const uint8_t  OP_FUZZY           = 4;    ///< First limit words within distance of key
+    const uint8_t  OP_RANGE           = 5;    ///< First limit words in the range in key, see range_key()
+    const uint8_t  OP_FUZZY_PREFIX    = 6;    ///< Closest limit words starting within distance of key
+
+    const uint8_t  STATUS_OK          = 0;    ///< Found; words follow for list queries
+    const uint8_t  STATUS_NOT_FOUND   = 1;    ///< Exact query didn't match
+    const uint8_t  STATUS_BAD_REQUEST = 2;    ///< Unknown op or dictionary
+    const uint8_t  STATUS_TRUNCATED   = 3;    ///< Out of budget; the words found so far follow
+
+    const uint32_t REQUEST_HEADER     = 14;   ///< Size of a request before the key
+    const uint32_t RESPONSE_HEADER    = 12;   ///< Size of a response before the words
+    const uint32_t MAX_REQUEST        = 4096; ///< Largest request frame accepted
+
+    /// A decoded request.
+    struct Request {
+      uint32_t      id;         ///< Echoed back in the response
+      uint8_t       op;         ///< One of the OP_ constants
+      uint8_t       dict;       ///< Index of the dictionary to query
+      uint8_t       distance;   ///< Edit distance for OP_FUZZY and OP_FUZZY_PREFIX
+      uint16_t      limit;      ///< Most words to return, 0 for no limit
+      std::string   key;        ///< Word or prefix
+    };
+
+    /// A decoded response.
+    struct Response {
+      uint32_t                  id;
+      uint8_t                   status;
+      std::vector<std::string>  words;
+    };
+
+    /// Append a request frame to a buffer.
+    void encode(
+        const Request&  request,    ///< Request to encode
+        std::string*    out         ///< Buffer to append to
+    );
+
+    /// Append a response frame to a buffer.
+    void encode(
+        const Response& response,   ///< Response to encode
+        std::string*    out         ///< Buffer to append to
+    );
+
+    /// Size of the frame at the start of a buffer.
+    /// @return   the frame's size including its size field, or 0 if not all of
+    ///           the size field has arrived yet
+    size_t frame_size(
+        const char*     data,       ///< Start of the buffer
+        size_t          size        ///< Bytes in the buffer
+    );
+
+    /// Decode a complete request frame.
+    Status decode(
+        const char*     data,       ///< Start of the frame
+        size_t          size,       ///< Size of the frame, from frame_size()
+        Request*        out         ///< Receives the request
+    );
+
+    /// Decode a complete response frame.
+    Status decode(
+        const char*     data,       ///< Start of the frame
+        size_t          size,       ///< Size of the frame, from frame_size()
+        Response*       out         ///< Receives the response
+    );
+
+    /// Make the key for an OP_RANGE request: the length of the first word,
+    /// the first word, then the word after the range, which may be empty for
+    /// no end.
+    std::string range_key(
+        const std::string& first,   ///< First word of the range
+        const std::string& last     ///< Word after the range
+    );
+
+    /// Make the key to cache the response to a request under: everything in
+    /// the request that decides the answer, and the version of the
+    /// dictionary, such as its fingerprint.
+    std::string cache_key(
+        const Request&  request,    ///< Request to answer
+        uint64_t        version     ///< Version of the dictionary it is for
+    );
+
+    /// Make the query that answers a request.
+    /// @return   a new query, or NULL if the request is not valid for the DAWG
+    Query* make_query(
+        const DAWG&     dawg,       ///< Dictionary the request is for
+        const Request&  request     ///< Request to answer
+    );
+
+    /// Fill in a response from a query made by make_query() that has finished.
+    void make_response(
+        const Request&  request,    ///< Request being answered
+        const Query*    query,      ///< Its query, or NULL if it had none
+        Response*       out         ///< Receives the response
+    );
+  }
+}
+
+#endif /* not _PROTOCOL_HH */
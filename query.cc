@@ -0,0 +1,714 @@
+#include "query.hh"
+#include <string.h>
+#include <time.h>
+
+namespace DAWG {
+
+  const uint8_t  CURSOR_FORMAT  = 1;                        /// First byte of every cursor token.
+  const uint8_t  NOT_STARTED    = 0xFF;                     /// Depth of a cursor made before the walk started.
+  const uint64_t FNV_OFFSET     = 0xCBF29CE484222325ULL;    /// FNV-1a starting value.
+  const uint64_t FNV_PRIME      = 0x100000001B3ULL;         /// FNV-1a multiplier.
+
+  /// Letters of the URL-safe base64 alphabet.
+  static const char BASE64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+  // FNV-1a over some bytes, carrying on from a hash
+  static uint64_t hash_bytes( uint64_t hash, const std::string& bytes ) {
+    for ( size_t i = 0; i < bytes.length(); ++i )
+      hash = (hash ^ (unsigned char)bytes[i]) * FNV_PRIME;
+    return hash;
+  }
+
+  // Base64 without padding, safe to put in a URL
+  static std::string encode_base64( const std::string& bytes ) {
+    std::string text;
+    uint32_t    bits  = 0;
+    unsigned    count = 0;
+    for ( size_t i = 0; i < bytes.length(); ++i ) {
+      bits   = (bits << 8) | (unsigned char)bytes[i];
+      count += 8;
+      for ( ; count >= 6; count -= 6 )
+        text.push_back( BASE64[(bits >> (count - 6)) & 0x3F] );
+    }
+    if ( count > 0 )
+      text.push_back( BASE64[(bits << (6 - count)) & 0x3F] );
+    return text;
+  }
+
+  // Undo encode_base64()
+  static Status decode_base64( const std::string& text, std::string* bytes ) {
+    uint32_t    bits  = 0;
+    unsigned    count = 0;
+    bytes->clear();
+    for ( size_t i = 0; i < text.length(); ++i ) {
+      const char* letter = (const char*)memchr( BASE64, text[i], 64 );
+      if ( letter == NULL )
+        return FAILURE;
+      bits   = (bits << 6) | (uint32_t)(letter - BASE64);
+      count += 6;
+      if ( count >= 8 ) {
+        count -= 8;
+        bytes->push_back( (char)((bits >> count) & 0xFF) );
+      }
+    }
+    // Only the encoding encode_base64() would have made, with no stray bits
+    return count < 6 && (bits & ((1u << count) - 1)) == 0 ? SUCCESS : FAILURE;
+  }
+
+  //----------------------------------------------------------------------------//
+  // Budget                                                                     //
+  //----------------------------------------------------------------------------//
+
+  double Budget::now() {
+#ifdef __unix__
+    timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else /* not __unix__ */
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif /* not __unix__ */
+  }
+
+  // Out of steps, cancelled or past the deadline
+  bool Budget::spent( size_t steps ) const {
+    return (max_steps != 0 && steps >= max_steps)
+           || (cancel != NULL && cancel->cancelled())
+           || (deadline != 0 && now() >= deadline);
+  }
+
+  size_t Budget::next_check( size_t steps ) const {
+    size_t at = steps + (check_interval != 0 ? check_interval : 1);
+    return max_steps != 0 && at > max_steps ? max_steps : at;
+  }
+
+  //----------------------------------------------------------------------------//
+  // Query                                                                      //
+  //----------------------------------------------------------------------------//
+
+  // See whether the budget is spent, and if not when to look again
+  bool Query::check_budget() {
+    if ( budget_.spent( steps_ ) ) {
+      truncated_ = true;
+      return false;
+    }
+    check_at_ = budget_.next_check( steps_ );
+    return true;
+  }
+
+  //----------------------------------------------------------------------------//
+  // WalkQuery                                                                  //
+  //----------------------------------------------------------------------------//
+
+  // Start walking at the first edge of a node
+  void WalkQuery::start( Index node ) {
+    if ( node == 0 )
+      return;
+    stack_.push_back( node );
+    prefetch( node );
+  }
+
+  // Visit the edge on top of the stack, then move to the next one
+  bool WalkQuery::walk() {
+    if ( stack_.empty() || stop_ )
+      return false;
+
+    const Edge& edge = *dawg_.edge( stack_.back() );
+    word_.resize( stack_.size() );
+    word_[stack_.size() - 1] = edge.letter();
+
+    bool descend = visit( edge );
+    if ( stop_ ) {
+      stack_.clear();
+      return false;
+    }
+
+    // Walk into the child, or on to the next edge, backing up out of
+    // finished nodes
+    if ( descend && edge.child() != 0 ) {
+      stack_.push_back( edge.child() );
+      prefetch( edge.child() );
+    } else {
+      while ( !stack_.empty() ) {
+        if ( !dawg_.edge( stack_.back() )->end_of_node() ) {
+          ++stack_.back();
+          break;
+        }
+        stack_.pop_back();
+      }
+    }
+
+    // Once the results are full, stop with the stack where the next result
+    // would be looked for, so a cursor can pick up from there
+    if ( max_results_ != 0 && results_.size() >= max_results_ ) {
+      stop_ = true;
+      return false;
+    }
+    return !stack_.empty();
+  }
+
+  // Record a result
+  void WalkQuery::add_result( const std::string& word ) {
+    results_.push_back( word );
+  }
+
+  // Format, version, depth, an offset for each depth, then a check over all
+  // of it and the key
+  std::string WalkQuery::save_cursor( bool started, Index node, uint64_t version, const std::string& key ) const {
+    std::string bytes;
+    bytes.push_back( (char)CURSOR_FORMAT );
+    for ( unsigned i = 0; i < 8; ++i )
+      bytes.push_back( (char)((version >> (8 * i)) & 0xFF) );
+    if ( !started ) {
+      bytes.push_back( (char)NOT_STARTED );
+    } else {
+      bytes.push_back( (char)stack_.size() );
+      for ( size_t d = 0; d < stack_.size(); ++d ) {
+        bytes.push_back( (char)(stack_[d] - node) );
+        node = dawg_.edge( stack_[d] )->child();
+      }
+    }
+
+    uint32_t check = (uint32_t)hash_bytes( hash_bytes( FNV_OFFSET, bytes ), key );
+    for ( unsigned i = 0; i < 4; ++i )
+      bytes.push_back( (char)((check >> (8 * i)) & 0xFF) );
+    return encode_base64( bytes );
+  }
+
+  // Check the token, then follow its offsets down from the node, making sure
+  // each stays inside its node
+  Status WalkQuery::load_cursor( Index node, uint64_t version, const std::string& key, const std::string& cursor,
+                                 bool* started ) {
+    std::string bytes;
+    if ( decode_base64( cursor, &bytes ) != SUCCESS || bytes.length() < 14 || (uint8_t)bytes[0] != CURSOR_FORMAT )
+      return FAILURE;
+
+    uint64_t saved = 0;
+    for ( unsigned i = 0; i < 8; ++i )
+      saved |= (uint64_t)(unsigned char)bytes[1 + i] << (8 * i);
+    size_t depth = (unsigned char)bytes[9];
+    if ( saved != version || bytes.length() != 14 + (depth == NOT_STARTED ? 0 : depth) )
+      return FAILURE;
+
+    uint32_t check = 0;
+    for ( unsigned i = 0; i < 4; ++i )
+      check |= (uint32_t)(unsigned char)bytes[bytes.length() - 4 + i] << (8 * i);
+    bytes.resize( bytes.length() - 4 );
+    if ( check != (uint32_t)hash_bytes( hash_bytes( FNV_OFFSET, bytes ), key ) )
+      return FAILURE;
+
+    *started = depth != NOT_STARTED;
+    if ( !*started )
+      return SUCCESS;
+
+    std::vector<Index>  stack;
+    std::string         word;
+    for ( size_t d = 0; d < depth; ++d ) {
+      if ( node == 0 )
+        return FAILURE;
+      for ( size_t offset = (unsigned char)bytes[10 + d]; offset > 0; --offset, ++node ) {
+        if ( dawg_.edge( node )->end_of_node() )
+          return FAILURE;
+      }
+      stack.push_back( node );
+      word.push_back( dawg_.edge( node )->letter() );
+      node = dawg_.edge( node )->child();
+    }
+
+    stack_.swap( stack );
+    word_.swap( word );
+    stop_ = false;
+    if ( !stack_.empty() )
+      prefetch( stack_.back() );
+    return SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------//
+  // WordIterator                                                               //
+  //----------------------------------------------------------------------------//
+
+  WordIterator::WordIterator( const DAWG& dawg )
+    : WalkQuery(dawg, 0), found_(false) {
+    start( dawg.begin().index() );
+  }
+
+  bool WordIterator::step() {
+    return walk();
+  }
+
+  // Walk until an edge ends a word. word_ is left alone until the next step.
+  // The walk is done once the last word is found, so that word still counts.
+  bool WordIterator::next_word() {
+    found_ = false;
+    while ( !found_ ) {
+      if ( !next() )
+        return found_;
+    }
+    return true;
+  }
+
+  bool WordIterator::visit( const Edge& edge ) {
+    found_ = edge.end_of_word();
+    return true;
+  }
+
+  std::string WordIterator::cursor( uint64_t version ) const {
+    return save_cursor( true, dawg_.begin().index(), version, std::string() );
+  }
+
+  Status WordIterator::resume( const std::string& cursor, uint64_t version ) {
+    bool started;
+    return load_cursor( dawg_.begin().index(), version, std::string(), cursor, &started );
+  }
+
+  //----------------------------------------------------------------------------//
+  // RangeQuery                                                                 //
+  //----------------------------------------------------------------------------//
+
+  RangeQuery::RangeQuery( const DAWG& dawg, const std::string& first, const std::string& last, size_t max_results )
+    : WalkQuery(dawg, max_results), first_(first), last_(last) {
+    start( dawg.begin().index() );
+  }
+
+  bool RangeQuery::step() {
+    return walk();
+  }
+
+  // Words are visited in order, so skip whole subtrees before the range and
+  // stop at the first word past it.
+  bool RangeQuery::visit( const Edge& edge ) {
+    if ( !last_.empty() && compare_words( word_, last_ ) >= 0 ) {
+      stop_ = true;
+      return false;
+    }
+    if ( compare_words( word_, first_ ) < 0 )
+      return first_.compare( 0, word_.length(), word_ ) == 0;
+    if ( edge.end_of_word() )
+      add_result( word_ );
+    return true;
+  }
+
+  //----------------------------------------------------------------------------//
+  // ExactQuery                                                                 //
+  //----------------------------------------------------------------------------//
+
+  ExactQuery::ExactQuery( const DAWG& dawg, const std::string& word )
+    : Query(dawg), word_(word), pos_(0), edge_(dawg.begin().index()), found_(false) {
+    prefetch( edge_ );
+  }
+
+  // Look for the next letter in one node
+  bool ExactQuery::step() {
+    if ( pos_ >= word_.length() || edge_ == 0 )
+      return false;
+
+    Iterator i = dawg_.find_edge( word_[pos_], Iterator( &dawg_, edge_ ) );
+    if ( i == dawg_.end() ) {
+      edge_ = 0;
+      return false;
+    }
+    if ( ++pos_ == word_.length() ) {
+      found_ = i->end_of_word();
+      return false;
+    }
+
+    edge_ = i->child();
+    if ( edge_ == 0 )
+      return false;
+    prefetch( edge_ );
+    return true;
+  }
+
+  //----------------------------------------------------------------------------//
+  // PrefixQuery                                                                //
+  //----------------------------------------------------------------------------//
+
+  PrefixQuery::PrefixQuery( const DAWG& dawg, const std::string& prefix, size_t max_results )
+    : WalkQuery(dawg, max_results), prefix_(prefix), pos_(0), edge_(dawg.begin().index()) {
+    if ( prefix_.empty() )
+      start( edge_ );
+    else
+      prefetch( edge_ );
+  }
+
+  // Follow the prefix one node at a time, then walk everything below it
+  bool PrefixQuery::step() {
+    if ( pos_ >= prefix_.length() )
+      return walk();
+
+    Iterator i = dawg_.find_edge( prefix_[pos_], Iterator( &dawg_, edge_ ) );
+    if ( i == dawg_.end() ) {
+      pos_  = prefix_.length();
+      edge_ = 0;
+      return false;
+    }
+    if ( ++pos_ == prefix_.length() ) {
+      if ( i->end_of_word() )
+        add_result( prefix_ );
+      edge_ = i->child();
+      start( edge_ );
+      if ( max_results_ != 0 && results_.size() >= max_results_ ) {
+        stop_ = true;
+        return false;
+      }
+      return !stack_.empty();
+    }
+
+    edge_ = i->child();
+    if ( edge_ == 0 ) {
+      pos_ = prefix_.length();
+      return false;
+    }
+    prefetch( edge_ );
+    return true;
+  }
+
+  bool PrefixQuery::visit( const Edge& edge ) {
+    if ( edge.end_of_word() )
+      add_result( prefix_ + word_ );
+    return true;
+  }
+
+  // Once the prefix is followed, edge_ is the node the walk started at
+  std::string PrefixQuery::cursor( uint64_t version ) const {
+    return save_cursor( pos_ >= prefix_.length(), edge_, version, prefix_ );
+  }
+
+  // Follow the prefix first, as step() would
+  Status PrefixQuery::resume( const std::string& cursor, uint64_t version ) {
+    Index node = dawg_.begin().index();
+    for ( size_t p = 0; p < prefix_.length() && node != 0; ++p ) {
+      Iterator i = dawg_.find_edge( prefix_[p], Iterator( &dawg_, node ) );
+      node = i != dawg_.end() ? i->child() : 0;
+    }
+
+    bool started;
+    if ( load_cursor( node, version, prefix_, cursor, &started ) != SUCCESS )
+      return FAILURE;
+    if ( started ) {
+      pos_  = prefix_.length();
+      edge_ = node;
+    }
+    return SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------//
+  // PatternQuery                                                               //
+  //----------------------------------------------------------------------------//
+
+  PatternQuery::PatternQuery( const DAWG& dawg, const std::string& pattern, char wildcard, size_t max_results,
+                              const LengthMasks* lengths )
+    : WalkQuery(dawg, max_results), pattern_(pattern), wildcard_(wildcard), lengths_(lengths) {
+    if ( !pattern_.empty() )
+      start( dawg.begin().index() );
+  }
+
+  bool PatternQuery::step() {
+    return walk();
+  }
+
+  bool PatternQuery::visit( const Edge& edge ) {
+    size_t depth = word_.length();
+    char   c     = pattern_[depth - 1];
+
+    if ( c != wildcard_ && c != edge.letter() )
+      return false;
+    if ( lengths_ != NULL && !LengthMasks::has( lengths_->edge( stack_.back() ), pattern_.length() - depth ) )
+      return false;
+    if ( depth == pattern_.length() ) {
+      if ( edge.end_of_word() )
+        add_result( word_ );
+      return false;
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------//
+  // FoldedQuery                                                                //
+  //----------------------------------------------------------------------------//
+
+  FoldedQuery::FoldedQuery( const DAWG& dawg, const std::string& word, const FoldTable& fold, size_t max_results )
+    : WalkQuery(dawg, max_results), target_(word), fold_(fold) {
+    if ( !target_.empty() )
+      start( dawg.begin().index() );
+  }
+
+  bool FoldedQuery::step() {
+    return walk();
+  }
+
+  bool FoldedQuery::visit( const Edge& edge ) {
+    size_t depth = word_.length();
+
+    if ( !fold_.match( edge.letter(), target_[depth - 1] ) )
+      return false;
+    if ( depth == target_.length() ) {
+      if ( edge.end_of_word() )
+        add_result( word_ );
+      return false;
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------//
+  // FuzzyQuery                                                                 //
+  //----------------------------------------------------------------------------//
+
+  FuzzyQuery::FuzzyQuery( const DAWG& dawg, const std::string& word, unsigned max_distance, size_t max_results,
+                          const LengthMasks* lengths )
+    : WalkQuery(dawg, max_results), target_(word), max_distance_(max_distance), lengths_(lengths) {
+    // Distances from the empty string
+    for ( unsigned j = 0; j <= target_.length(); ++j )
+      rows_.push_back( j );
+    start( dawg.begin().index() );
+  }
+
+  bool FuzzyQuery::step() {
+    return walk();
+  }
+
+  // Extend the edit distance table by one letter and prune once every entry in
+  // the new row is over the limit. A word n letters longer than this is at
+  // least row[j] + |width - 1 - j - n| away, so with length masks the row
+  // also says which lengths below are worth walking to.
+  bool FuzzyQuery::visit( const Edge& edge ) {
+    size_t      width   = target_.length() + 1;
+    size_t      depth   = word_.length();
+    unsigned    best;
+
+    rows_.resize( (depth + 1) * width );
+    const unsigned* prev = &rows_[(depth - 1) * width];
+    unsigned*       row  = &rows_[depth * width];
+
+    row[0] = best = depth;
+    for ( size_t j = 1; j < width; ++j ) {
+      unsigned cost = prev[j - 1] + (target_[j - 1] == edge.letter() ? 0 : 1);
+      if ( prev[j] + 1 < cost )     cost = prev[j] + 1;
+      if ( row[j - 1] + 1 < cost )  cost = row[j - 1] + 1;
+      row[j] = cost;
+      if ( cost < best )
+        best = cost;
+    }
+
+    if ( edge.end_of_word() && row[width - 1] <= max_distance_ )
+      add_result( word_ );
+    if ( best > max_distance_ || lengths_ == NULL )
+      return best <= max_distance_;
+
+    LengthMask reach = 0;
+    for ( size_t j = 0; j < width; ++j ) {
+      if ( row[j] <= max_distance_ ) {
+        size_t rest  = width - 1 - j;
+        size_t slack = max_distance_ - row[j];
+        reach |= LengthMasks::range( rest > slack ? rest - slack : 0, rest + slack );
+      }
+    }
+    return (reach & lengths_->edge( stack_.back() ) & ~(LengthMask)1) != 0;
+  }
+
+  //----------------------------------------------------------------------------//
+  // LengthQuery                                                                //
+  //----------------------------------------------------------------------------//
+
+  LengthQuery::LengthQuery( const DAWG& dawg, const LengthMasks& lengths, size_t min_length, size_t max_length,
+                            size_t max_results )
+    : WalkQuery(dawg, max_results), lengths_(lengths), wanted_(LengthMasks::range( min_length, max_length )) {
+    if ( lengths.words() & wanted_ )
+      start( dawg.begin().index() );
+  }
+
+  bool LengthQuery::step() {
+    return walk();
+  }
+
+  // Shift the lengths wanted down to count from this edge
+  bool LengthQuery::visit( const Edge& edge ) {
+    if ( edge.end_of_word() && LengthMasks::has( wanted_, word_.length() ) )
+      add_result( word_ );
+    return ((wanted_ >> word_.length()) & lengths_.edge( stack_.back() ) & ~(LengthMask)1) != 0;
+  }
+
+  //----------------------------------------------------------------------------//
+  // FuzzyPrefixQuery                                                           //
+  //----------------------------------------------------------------------------//
+
+  FuzzyPrefixQuery::FuzzyPrefixQuery( const DAWG& dawg, const std::string& prefix, unsigned max_distance, size_t max_results )
+    : WalkQuery(dawg, max_results), target_(prefix), max_distance_(max_distance), distance_(0), listing_(0) {
+    // Distances from the empty string, which is itself a prefix
+    for ( unsigned j = 0; j <= target_.length(); ++j )
+      rows_.push_back( j );
+    closest_.push_back( target_.length() );
+    start( dawg.begin().index() );
+  }
+
+  // Walk once for each distance, until the results are full
+  bool FuzzyPrefixQuery::step() {
+    if ( walk() )
+      return true;
+    if ( distance_ < max_distance_ && (max_results_ == 0 || results_.size() < max_results_) ) {
+      ++distance_;
+      listing_ = 0;
+      start( dawg_.begin().index() );
+      return !stack_.empty();
+    }
+    return false;
+  }
+
+  // A word is found at the distance of its closest prefix. Words closer than
+  // this walk's distance were found by an earlier walk, and a subtree nothing
+  // in which can get closer is all at this distance.
+  bool FuzzyPrefixQuery::visit( const Edge& edge ) {
+    size_t      width   = target_.length() + 1;
+    size_t      depth   = word_.length();
+    unsigned    best;
+
+    if ( listing_ != 0 ) {
+      if ( depth > listing_ ) {
+        if ( edge.end_of_word() )
+          add_result( word_ );
+        return true;
+      }
+      listing_ = 0;
+    }
+
+    rows_.resize( (depth + 1) * width );
+    const unsigned* prev = &rows_[(depth - 1) * width];
+    unsigned*       row  = &rows_[depth * width];
+
+    row[0] = best = depth;
+    for ( size_t j = 1; j < width; ++j ) {
+      unsigned cost = prev[j - 1] + (target_[j - 1] == edge.letter() ? 0 : 1);
+      if ( prev[j] + 1 < cost )     cost = prev[j] + 1;
+      if ( row[j - 1] + 1 < cost )  cost = row[j - 1] + 1;
+      row[j] = cost;
+      if ( cost < best )
+        best = cost;
+    }
+
+    closest_.resize( depth + 1 );
+    closest_[depth] = closest_[depth - 1] < row[width - 1] ? closest_[depth - 1] : row[width - 1];
+    if ( closest_[depth] < distance_ )
+      return false;
+    if ( edge.end_of_word() && closest_[depth] == distance_ )
+      add_result( word_ );
+    if ( closest_[depth] == distance_ && best >= distance_ ) {
+      listing_ = depth;
+      return true;
+    }
+    return best <= distance_;
+  }
+
+  //----------------------------------------------------------------------------//
+  // ShortestQuery                                                              //
+  //----------------------------------------------------------------------------//
+
+  ShortestQuery::ShortestQuery( const DAWG& dawg, const std::string& prefix, size_t max_results )
+    : Query(dawg), prefix_(prefix), pos_(0), edge_(dawg.begin().index()), cursor_(0), max_results_(max_results) {
+    if ( prefix_.empty() ) {
+      level_.push_back( edge_ );
+      words_.push_back( prefix_ );
+    }
+    prefetch( edge_ );
+  }
+
+  // Follow the prefix one node at a time, then expand one node below it per
+  // step, a whole length at a time.
+  bool ShortestQuery::step() {
+    if ( pos_ < prefix_.length() ) {
+      Iterator i = dawg_.find_edge( prefix_[pos_], Iterator( &dawg_, edge_ ) );
+      if ( i == dawg_.end() ) {
+        pos_ = prefix_.length();
+        return false;
+      }
+      edge_ = i->child();
+      if ( ++pos_ == prefix_.length() ) {
+        if ( i->end_of_word() && !add_result( prefix_ ) )
+          return false;
+        if ( edge_ != 0 ) {
+          level_.push_back( edge_ );
+          words_.push_back( prefix_ );
+        }
+        return !level_.empty();
+      }
+      if ( edge_ == 0 ) {
+        pos_ = prefix_.length();
+        return false;
+      }
+      prefetch( edge_ );
+      return true;
+    }
+
+    // Move on to the next length
+    if ( cursor_ == level_.size() ) {
+      level_.swap( next_level_ );
+      words_.swap( next_words_ );
+      next_level_.clear();
+      next_words_.clear();
+      cursor_ = 0;
+      if ( level_.empty() )
+        return false;
+    }
+
+    Index               node = level_[cursor_];
+    const std::string&  word = words_[cursor_];
+    ++cursor_;
+    for ( Index i = node; ; ++i ) {
+      const Edge* edge = dawg_.edge(i);
+      if ( edge->end_of_word() && !add_result( word + edge->letter() ) )
+        return false;
+      if ( edge->child() != 0 ) {
+        next_level_.push_back( edge->child() );
+        next_words_.push_back( word + edge->letter() );
+      }
+      if ( edge->end_of_node() )
+        break;
+    }
+
+    if ( cursor_ < level_.size() )
+      prefetch( level_[cursor_] );
+    else if ( !next_level_.empty() )
+      prefetch( next_level_[0] );
+    return cursor_ < level_.size() || !next_level_.empty();
+  }
+
+  // Record a result
+  // @return  false once there are enough
+  bool ShortestQuery::add_result( const std::string& word ) {
+    results_.push_back( word );
+    if ( max_results_ != 0 && results_.size() >= max_results_ ) {
+      level_.clear();
+      next_level_.clear();
+      cursor_ = 0;
+      return false;
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------//
+  // Scheduler                                                                  //
+  //----------------------------------------------------------------------------//
+
+  // Step each query in flight in turn, replacing finished ones with new ones
+  void Scheduler::run() {
+    std::vector<Query*> slots;
+    size_t              next = 0;
+
+    while ( next < pending_.size() && slots.size() < width_ )
+      slots.push_back( pending_[next++] );
+
+    while ( !slots.empty() ) {
+      for ( size_t i = 0; i < slots.size(); ) {
+        if ( slots[i]->next() ) {
+          ++i;
+        } else if ( next < pending_.size() ) {
+          slots[i++] = pending_[next++];
+        } else {
+          slots[i] = slots.back();
+          slots.pop_back();
+        }
+      }
+    }
+
+    pending_.clear();
+  }
+
+}
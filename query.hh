@@ -0,0 +1,483 @@
+#ifndef _QUERY_HH
+#define _QUERY_HH 1
+
+#include "dawg.hh"
+#include "lengths.hh"
+#include <string>
+#include <vector>
+
+namespace DAWG {
+
+  /// A flag any thread can set to stop the queries whose budgets hold it.
+  class CancelToken {
+    public:
+      /// Default constructor
+      CancelToken() : cancelled_(0) {}
+
+      /// Stop the queries watching this.
+      inline void cancel() {
+#ifdef __GNUC__
+        __atomic_store_n( &cancelled_, 1, __ATOMIC_RELAXED );
+#else /* not __GNUC__ */
+        cancelled_ = 1;
+#endif /* not __GNUC__ */
+      }
+
+      /// Whether cancel() has been called.
+      inline bool cancelled() const {
+#ifdef __GNUC__
+        return __atomic_load_n( &cancelled_, __ATOMIC_RELAXED ) != 0;
+#else /* not __GNUC__ */
+        return cancelled_ != 0;
+#endif /* not __GNUC__ */
+      }
+
+    private:
+      volatile int  cancelled_;
+  };
+
+  /// Limits on the work of a query. A query that runs out stops where it is,
+  /// keeping the results it has, and says it was truncated. Steps are counted
+  /// exactly; the clock and the cancel token are only looked at every
+  /// check_interval steps, so a step costs no more than it did.
+  struct Budget {
+    size_t              max_steps;          ///< Most steps to take, 0 for no limit
+    double              deadline;           ///< now() to stop at, 0 for none
+    const CancelToken*  cancel;             ///< Stop once this is cancelled, NULL for none
+    size_t              check_interval;     ///< Steps between looks at the clock and the token
+
+    Budget() : max_steps(0), deadline(0), cancel(NULL), check_interval(256) {}
+
+    /// Stop a number of seconds from now.
+    inline void set_timeout( double seconds ) { deadline = now() + seconds; }
+
+    /// Whether work that has taken some steps must stop.
+    bool spent(
+        size_t  steps       ///< Steps taken so far
+    ) const;
+
+    /// When to call spent() again after it has said to go on: after
+    /// check_interval more steps, or sooner if the steps run out first.
+    size_t next_check(
+        size_t  steps       ///< Steps taken so far
+    ) const;
+
+    /// Seconds on a clock that only goes forwards.
+    static double now();
+  };
+
+  /// A traversal of a DAWG that can be suspended after every edge it visits.
+  ///
+  /// Each call to step() does a small, bounded amount of work and then issues
+  /// a prefetch for the edge it will look at next. Run on its own, a query just
+  /// steps until it's done. Run through a Scheduler alongside other queries,
+  /// the prefetch has time to complete while the others take their turns, so
+  /// the memory latency of one walk is hidden behind the work of the rest.
+  class Query {
+    public:
+      /// Basic constructor
+      Query(
+          const DAWG&   dawg        ///< DAWG to search
+      ) : dawg_(dawg), steps_(0), check_at_((size_t)-1), truncated_(false) {}
+
+      /// Destructor
+      virtual ~Query() {}
+
+      /// Visit the next edge.
+      /// @return   true if there is more to do, false when the query is done
+      virtual bool step() = 0;
+
+      /// Limit the work the query may do, from here on.
+      inline void set_budget( const Budget& budget ) {
+        budget_     = budget;
+        check_at_   = steps_;
+      }
+
+      /// Visit the next edge if the budget allows.
+      /// @return   true if there is more to do, false when the query is done
+      ///           or out of budget
+      inline bool next() {
+        if ( steps_ == check_at_ && !check_budget() )
+          return false;
+        ++steps_;
+        return step();
+      }
+
+      /// Run the query to completion, or until its budget runs out.
+      inline void run() { while ( next() ) {} }
+
+      /// Whether the query ran out of budget, so its results may be missing
+      /// some.
+      inline bool truncated() const { return truncated_; }
+
+      /// Steps taken through next().
+      inline size_t steps() const { return steps_; }
+
+    protected:
+      const DAWG&           dawg_;
+
+      /// Ask for an edge to be brought into cache.
+      inline void prefetch( Index index ) const {
+#ifdef __GNUC__
+        __builtin_prefetch( dawg_.edge(index) );
+#endif /* __GNUC__ */
+      }
+
+    private:
+      Budget                budget_;
+      size_t                steps_;
+      size_t                check_at_;      ///< Step to look at the budget at next
+      bool                  truncated_;
+
+      bool          check_budget();
+  };
+
+  /// Base for queries that walk the words below a node depth-first, in order.
+  class WalkQuery : public Query {
+    public:
+      /// Basic constructor
+      WalkQuery(
+          const DAWG&   dawg,       ///< DAWG to search
+          size_t        max_results ///< Stop after this many results, 0 for no limit
+      ) : Query(dawg), max_results_(max_results), stop_(false) {}
+
+      /// Words found so far, in order.
+      inline const std::vector<std::string>& results() const { return results_; }
+
+    protected:
+      /// Start walking at the first edge of a node.
+      void          start( Index node );
+
+      /// Visit the edge on top of the stack, then move to the next one.
+      /// @return   true while there are edges left to visit
+      bool          walk();
+
+      /// Decide what to do with an edge. word_ holds the letters leading to and
+      /// including it.
+      /// @return   true to walk into the edge's child
+      virtual bool  visit( const Edge& edge ) = 0;
+
+      /// Record a result.
+      void          add_result( const std::string& word );
+
+      /// Make a cursor token for where the walk below a node stands: the
+      /// dictionary's version, the offset of the stack's edge within each node
+      /// on the way down, and a check over those and a key naming the query.
+      std::string   save_cursor(
+          bool                  started,    ///< Whether the walk has started; if not, resuming starts over
+          Index                 node,       ///< Node the walk started at
+          uint64_t              version,    ///< Version of the dictionary
+          const std::string&    key         ///< What else the position depends on
+      ) const;
+
+      /// Put the walk back where a cursor token from save_cursor() left it,
+      /// checking each offset against the DAWG on the way down.
+      /// @return   FAILURE if the token is not for this query and version, or
+      ///           leads off the DAWG
+      Status        load_cursor(
+          Index                 node,       ///< Node the walk starts at
+          uint64_t              version,    ///< Version of the dictionary
+          const std::string&    key,        ///< As given to save_cursor()
+          const std::string&    cursor,     ///< Token to resume from
+          bool*                 started     ///< Set to whether the walk had started
+      );
+
+      std::vector<Index>        stack_;         ///< Current edge at each depth
+      std::string               word_;          ///< Letters along the stack
+      std::vector<std::string>  results_;
+      size_t                    max_results_;
+      bool                      stop_;          ///< Set by visit() to end the walk
+  };
+
+  /// Visits every word in the DAWG one at a time, in order, without keeping
+  /// them.
+  class WordIterator : public WalkQuery {
+    public:
+      WordIterator(
+          const DAWG&           dawg                ///< DAWG to walk
+      );
+
+      bool step();
+
+      /// Move to the next word, a step at a time through next(), so the
+      /// budget is kept to.
+      /// @return   false once there are no more words, or when the budget
+      ///           runs out and truncated() is set
+      bool next_word();
+
+      /// The current word.
+      inline const std::string& word() const { return word_; }
+
+      /// Token for the position after the current word, to carry between
+      /// requests instead of the iterator.
+      std::string cursor(
+          uint64_t      version     ///< Version of the dictionary, such as its fingerprint
+      ) const;
+
+      /// Continue from a token made by cursor(), in time proportional to the
+      /// length of the word it was made at.
+      /// @return   FAILURE if the token is damaged or for another version
+      Status resume(
+          const std::string&    cursor,     ///< Token to continue from
+          uint64_t              version     ///< Version of the dictionary
+      );
+
+    protected:
+      bool visit( const Edge& edge );
+
+    private:
+      bool          found_;     ///< Whether the last edge visited ended a word
+  };
+
+  /// Find the words in a range.
+  class RangeQuery : public WalkQuery {
+    public:
+      RangeQuery(
+          const DAWG&           dawg,               ///< DAWG to search
+          const std::string&    first,              ///< First word of the range
+          const std::string&    last,               ///< Word after the range, empty for no end
+          size_t                max_results = 0     ///< Stop after this many, 0 for no limit
+      );
+
+      bool step();
+
+    protected:
+      bool visit( const Edge& edge );
+
+    private:
+      std::string   first_;
+      std::string   last_;
+  };
+
+  /// See if a word is in the DAWG.
+  class ExactQuery : public Query {
+    public:
+      ExactQuery(
+          const DAWG&           dawg,       ///< DAWG to search
+          const std::string&    word        ///< Word to look for
+      );
+
+      bool step();
+
+      /// Whether the word was found. Only meaningful once the query is done.
+      inline bool found() const { return found_; }
+
+    private:
+      std::string   word_;
+      size_t        pos_;       ///< Letter being looked for
+      Index         edge_;      ///< Edge being compared
+      bool          found_;
+  };
+
+  /// Find the words that start with a prefix.
+  class PrefixQuery : public WalkQuery {
+    public:
+      PrefixQuery(
+          const DAWG&           dawg,               ///< DAWG to search
+          const std::string&    prefix,             ///< Prefix to complete
+          size_t                max_results = 0     ///< Stop after this many, 0 for no limit
+      );
+
+      bool step();
+
+      /// Token for where the query stopped, so another query for the same
+      /// prefix can return the next page. Make it once the query has stopped,
+      /// whether at max_results or out of budget.
+      std::string cursor(
+          uint64_t      version     ///< Version of the dictionary, such as its fingerprint
+      ) const;
+
+      /// Continue from a token made by cursor() for the same prefix, in time
+      /// proportional to the length of the prefix and the word it stopped at.
+      /// Call before stepping.
+      /// @return   FAILURE if the token is damaged or for another prefix or
+      ///           version
+      Status resume(
+          const std::string&    cursor,     ///< Token to continue from
+          uint64_t              version     ///< Version of the dictionary
+      );
+
+    protected:
+      bool visit( const Edge& edge );
+
+    private:
+      std::string   prefix_;
+      size_t        pos_;       ///< Letter of the prefix being looked for
+      Index         edge_;      ///< Edge being compared, then the node the walk starts at
+  };
+
+  /// Find the words that match a pattern, where a wildcard matches any letter.
+  /// Given the DAWG's length masks, edges with no word of the pattern's
+  /// length below are passed over.
+  class PatternQuery : public WalkQuery {
+    public:
+      PatternQuery(
+          const DAWG&           dawg,               ///< DAWG to search
+          const std::string&    pattern,            ///< Pattern to match
+          char                  wildcard = '?',     ///< Letter that matches any letter
+          size_t                max_results = 0,    ///< Stop after this many, 0 for no limit
+          const LengthMasks*    lengths = NULL      ///< The DAWG's length masks, if built
+      );
+
+      bool step();
+
+    protected:
+      bool visit( const Edge& edge );
+
+    private:
+      std::string           pattern_;
+      char                  wildcard_;
+      const LengthMasks*    lengths_;
+  };
+
+  /// Find the words that match a word letter for letter, letters matching
+  /// when they fold to the same letter. Gives every spelling the DAWG has,
+  /// so with FoldTable::latin1_accents() "cafe" finds "Cafe" and any accented
+  /// forms too.
+  class FoldedQuery : public WalkQuery {
+    public:
+      FoldedQuery(
+          const DAWG&           dawg,               ///< DAWG to search
+          const std::string&    word,               ///< Word to look for
+          const FoldTable&      fold,               ///< How to match letters
+          size_t                max_results = 0     ///< Stop after this many, 0 for no limit
+      );
+
+      bool step();
+
+    protected:
+      bool visit( const Edge& edge );
+
+    private:
+      std::string   target_;
+      FoldTable     fold_;
+  };
+
+  /// Find the words within an edit distance of a word. Given the DAWG's
+  /// length masks, edges are passed over when no word below is a length that
+  /// could be close enough.
+  class FuzzyQuery : public WalkQuery {
+    public:
+      FuzzyQuery(
+          const DAWG&           dawg,               ///< DAWG to search
+          const std::string&    word,               ///< Word to look for
+          unsigned              max_distance,       ///< Largest edit distance allowed
+          size_t                max_results = 0,    ///< Stop after this many, 0 for no limit
+          const LengthMasks*    lengths = NULL      ///< The DAWG's length masks, if built
+      );
+
+      bool step();
+
+    protected:
+      bool visit( const Edge& edge );
+
+    private:
+      std::string               target_;
+      unsigned                  max_distance_;
+      std::vector<unsigned>     rows_;      ///< Edit distance row for each depth
+      const LengthMasks*        lengths_;
+  };
+
+  /// Find the words whose lengths are in a range, in order, walking only
+  /// edges with such words below.
+  class LengthQuery : public WalkQuery {
+    public:
+      LengthQuery(
+          const DAWG&           dawg,               ///< DAWG to search
+          const LengthMasks&    lengths,            ///< The DAWG's length masks
+          size_t                min_length,         ///< Shortest word wanted
+          size_t                max_length,         ///< Longest word wanted
+          size_t                max_results = 0     ///< Stop after this many, 0 for no limit
+      );
+
+      bool step();
+
+    protected:
+      bool visit( const Edge& edge );
+
+    private:
+      const LengthMasks&    lengths_;
+      LengthMask            wanted_;    ///< Lengths wanted
+  };
+
+  /// Find the words that start with something within an edit distance of a
+  /// prefix, for completion that tolerates typos: "recie" finds "receive"
+  /// and "recipe". Words come closest first, and in order among words as
+  /// close, so stopping at max_results keeps the best. Each distance is a
+  /// walk of its own; below a prefix which is as close as anything under it
+  /// can get, words are listed without working out any more distances.
+  class FuzzyPrefixQuery : public WalkQuery {
+    public:
+      FuzzyPrefixQuery(
+          const DAWG&           dawg,               ///< DAWG to search
+          const std::string&    prefix,             ///< Prefix to complete
+          unsigned              max_distance,       ///< Largest edit distance allowed
+          size_t                max_results         ///< Stop after this many, 0 for no limit
+      );
+
+      bool step();
+
+    protected:
+      bool visit( const Edge& edge );
+
+    private:
+      std::string               target_;
+      unsigned                  max_distance_;
+      unsigned                  distance_;      ///< Distance this walk finds words at
+      std::vector<unsigned>     rows_;          ///< Edit distance row for each depth
+      std::vector<unsigned>     closest_;       ///< Distance of the closest prefix so far, for each depth
+      size_t                    listing_;       ///< Depth below which words are just listed, 0 if none
+  };
+
+  /// Find the shortest words that start with a prefix: shortest first, and in
+  /// order among words of the same length.
+  class ShortestQuery : public Query {
+    public:
+      ShortestQuery(
+          const DAWG&           dawg,               ///< DAWG to search
+          const std::string&    prefix,             ///< Prefix to complete
+          size_t                max_results         ///< Number of words wanted, 0 for all
+      );
+
+      bool step();
+
+      /// Words found so far, shortest first.
+      inline const std::vector<std::string>& results() const { return results_; }
+
+    private:
+      std::string               prefix_;
+      size_t                    pos_;           ///< Letter of the prefix being looked for
+      Index                     edge_;          ///< Edge being compared
+      std::vector<Index>        level_;         ///< Nodes at the current length
+      std::vector<std::string>  words_;         ///< Letters leading to each of them
+      std::vector<Index>        next_level_;    ///< Nodes at the next length
+      std::vector<std::string>  next_words_;
+      size_t                    cursor_;        ///< Next node in level_
+      std::vector<std::string>  results_;
+      size_t                    max_results_;
+
+      bool          add_result( const std::string& word );
+  };
+
+  /// Runs many queries at once, interleaving their steps. Each query keeps to
+  /// its own budget.
+  class Scheduler {
+    public:
+      /// Basic constructor
+      Scheduler(
+          size_t    width = 16      ///< Number of queries to keep in flight
+      ) : width_(width) {}
+
+      /// Add a query to be run. The scheduler does not take ownership.
+      inline void add( Query* query ) { pending_.push_back( query ); }
+
+      /// Run every query that was added to completion.
+      void run();
+
+    private:
+      size_t                width_;
+      std::vector<Query*>   pending_;
+  };
+}
+
+#endif /* not _QUERY_HH */
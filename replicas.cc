@@ -0,0 +1,165 @@
+#include "replicas.hh"
+#include <fstream>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+# include <sched.h>
+# include <unistd.h>
+# include <sys/syscall.h>
+#endif /* __linux__ */
+
+namespace DAWG {
+
+#ifdef __linux__
+  const int           POLICY_DEFAULT  = 0;        /// Memory policy: allocate on the local node (MPOL_DEFAULT).
+  const int           POLICY_BIND     = 2;        /// Memory policy: allocate only on given nodes (MPOL_BIND).
+  const unsigned      POLICY_MOVE     = 2;        /// mbind flag: move pages already placed elsewhere (MPOL_MF_MOVE).
+  const unsigned long MAX_NODES       = 1024;     /// Number of nodes a node mask can describe.
+  const char* const   NODE_PATH       = "/sys/devices/system/node/";
+  const unsigned long BITS_PER_MASK   = 8 * sizeof(unsigned long);
+
+  // Read a kernel list such as "0-3,8,10-11" from a file.
+  static bool read_list( const std::string& path, std::vector<Index>* out ) {
+    std::ifstream   input( path.c_str() );
+    std::string     line;
+
+    out->clear();
+    if ( !std::getline( input, line ) )
+      return false;
+
+    const char* p = line.c_str();
+    while ( *p >= '0' && *p <= '9' ) {
+      char* end;
+      Index first = strtoul( p, &end, 10 );
+      Index last  = first;
+      if ( *end == '-' )
+        last = strtoul( end + 1, &end, 10 );
+      for ( Index i = first; i <= last; ++i )
+        out->push_back( i );
+      p = (*end == ',') ? end + 1 : end;
+    }
+    return true;
+  }
+#endif /* __linux__ */
+
+  //----------------------------------------------------------------------------//
+  // Replicas                                                                   //
+  //----------------------------------------------------------------------------//
+
+  // Destructor
+  Replicas::~Replicas() {
+    clear();
+  }
+
+  // Clear all copies
+  void Replicas::clear() {
+    for ( size_t i = 0; i < replicas_.size(); ++i )
+      delete replicas_[i];
+    replicas_.clear();
+    nodes_.clear();
+    cpus_.clear();
+    cpu_replica_.clear();
+  }
+
+  // Load one copy per node from a stream
+  Status Replicas::load( std::istream& input ) {
+    DAWG dawg;
+    if ( dawg.load( input ) != SUCCESS ) {
+      error_() << dawg.error();
+      return FAILURE;
+    }
+    return load( dawg );
+  }
+
+  // Make one copy per node of a loaded DAWG
+  // Make one copy per node of a loaded DAWG. Without a node list from the
+  // kernel there is nothing to bind to, and the one copy goes anywhere.
+  Status Replicas::load( const DAWG& dawg ) {
+    bool numa = false;
+
+    clear();
+
+#ifdef __linux__
+    // Only nodes with memory of their own can hold a copy
+    numa = read_list( std::string(NODE_PATH) + "has_memory", &nodes_ )
+           || read_list( std::string(NODE_PATH) + "online", &nodes_ );
+    numa = numa && !nodes_.empty();
+#endif /* __linux__ */
+    if ( nodes_.empty() )
+      nodes_.push_back( 0 );
+
+    for ( size_t i = 0; i < nodes_.size(); ++i ) {
+      DAWG* copy = new DAWG;
+      replicas_.push_back( copy );
+      cpus_.push_back( std::vector<Index>() );
+
+      if ( !numa ) {
+        if ( copy->load( dawg.num_edges(), dawg.edge(0) ) != SUCCESS ) {
+          error_() << copy->error();
+          clear();
+          return FAILURE;
+        }
+        continue;
+      }
+
+#ifdef __linux__
+      std::vector<unsigned long> mask( MAX_NODES / BITS_PER_MASK, 0 );
+      mask[nodes_[i] / BITS_PER_MASK] |= 1UL << (nodes_[i] % BITS_PER_MASK);
+
+      // Pages first touched while copying come from the node...
+      if ( syscall( SYS_set_mempolicy, POLICY_BIND, &mask[0], MAX_NODES ) != 0 ) {
+        error_() << "Couldn't bind memory to node " << nodes_[i] << ": " << strerror(errno);
+        clear();
+        return FAILURE;
+      }
+      Status status = copy->load( dawg.num_edges(), dawg.edge(0) );
+      syscall( SYS_set_mempolicy, POLICY_DEFAULT, NULL, 0 );
+      if ( status != SUCCESS ) {
+        error_() << copy->error();
+        clear();
+        return FAILURE;
+      }
+
+      // ...and any the allocator reused from elsewhere are moved there. The
+      // range is widened to whole pages, which may move a neighbour's bytes
+      // on the first and last pages along with the edges.
+      size_t page  = sysconf( _SC_PAGESIZE );
+      size_t start = (size_t)copy->edge(0) & ~(page - 1);
+      size_t end   = ((size_t)copy->edge(copy->num_edges() + 1) + page - 1) & ~(page - 1);
+      if ( syscall( SYS_mbind, start, end - start, POLICY_BIND, &mask[0], MAX_NODES, POLICY_MOVE ) != 0 ) {
+        error_() << "Couldn't move copy to node " << nodes_[i] << ": " << strerror(errno);
+        clear();
+        return FAILURE;
+      }
+
+      // Send this node's CPUs to this copy
+      std::ostringstream path;
+      path << NODE_PATH << "node" << nodes_[i] << "/cpulist";
+      read_list( path.str(), &cpus_[i] );
+      for ( size_t c = 0; c < cpus_[i].size(); ++c ) {
+        if ( cpus_[i][c] >= cpu_replica_.size() )
+          cpu_replica_.resize( cpus_[i][c] + 1, 0 );
+        cpu_replica_[cpus_[i][c]] = i;
+      }
+#endif /* __linux__ */
+    }
+
+    // success
+    return SUCCESS;
+  }
+
+  // The copy on the node the calling thread is running on. CPUs on nodes
+  // without memory use the first copy.
+  const DAWG& Replicas::local() const {
+    assert( !replicas_.empty() );
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if ( cpu >= 0 && (Index)cpu < cpu_replica_.size() )
+      return *replicas_[cpu_replica_[cpu]];
+#endif /* __linux__ */
+    return *replicas_[0];
+  }
+
+}
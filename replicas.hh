@@ -0,0 +1,76 @@
+#ifndef _REPLICAS_HH
+#define _REPLICAS_HH 1
+
+#include "dawg.hh"
+#include <vector>
+
+namespace DAWG {
+
+  /// One copy of a DAWG per NUMA node.
+  ///
+  /// Each copy's edges are bound to the memory of its node, and local() hands
+  /// a thread the copy on the node it is running on, so lookups never have to
+  /// cross the interconnect. On systems without NUMA support there is a single
+  /// copy which every thread shares.
+  class Replicas {
+    public:
+      /// Default constructor
+      Replicas() {};
+
+      /// Destructor
+      ~Replicas();
+
+      /// Clear all copies.
+      void clear();
+
+      /// Load one copy per node from a stream.
+      Status load(
+          std::istream& input   ///< Stream containing DAWG data.
+      );
+
+      /// Make one copy per node of a loaded DAWG.
+      Status load(
+          const DAWG&   dawg    ///< DAWG to copy
+      );
+
+      /// The copy on the node the calling thread is running on.
+      const DAWG& local() const;
+
+      /// Number of copies.
+      inline Index num_replicas() const { return replicas_.size(); }
+
+      /// Get an individual copy.
+      inline const DAWG& replica(
+          Index index           ///< index of the copy to retrieve
+      ) const {
+        return *replicas_[index];
+      }
+
+      /// NUMA node a copy is bound to.
+      inline Index node(
+          Index index           ///< index of the copy
+      ) const {
+        return nodes_[index];
+      }
+
+      /// CPUs for which a copy is the local one, empty for a node without
+      /// CPUs or where there is no NUMA support.
+      inline const std::vector<Index>& cpus(
+          Index index           ///< index of the copy
+      ) const {
+        return cpus_[index];
+      }
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      std::vector<DAWG*>    replicas_;      ///< One copy per node with memory
+      std::vector<Index>    nodes_;         ///< Node of each copy
+      std::vector<std::vector<Index> > cpus_; ///< CPUs of each copy's node
+      std::vector<Index>    cpu_replica_;   ///< Copy to use for each CPU
+      Error                 error_;
+  };
+}
+
+#endif /* not _REPLICAS_HH */
@@ -0,0 +1,473 @@
+#include "router.hh"
+#include <algorithm>
+#include <climits>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace DAWG {
+
+  const uint32_t    ROUTES_MAGIC    = 0xC6ACC2A7;   /// Identifies routing tables we write.
+  const size_t      PAGE_WORDS      = 0xFFFF;       /// Most words a shard returns per request.
+  const size_t      READ_SIZE       = 65536;        /// Bytes read from a socket at a time.
+
+  // The word after every word starting with a prefix, or empty if there is
+  // none.
+  static std::string prefix_end( const std::string& prefix ) {
+    std::string end = prefix;
+    while ( !end.empty() && end[end.length() - 1] == CHAR_MAX )
+      end.erase( end.length() - 1 );
+    if ( !end.empty() )
+      ++end[end.length() - 1];
+    return end;
+  }
+
+  // The first possible word after a word. Letters compare as chars, so the
+  // least letter to add is CHAR_MIN, not zero.
+  static std::string word_after( const std::string& word ) {
+    return word + (char)CHAR_MIN;
+  }
+
+  // Order for shortest(): by length, then as in the DAWG
+  static bool shorter( const std::string& a, const std::string& b ) {
+    if ( a.length() != b.length() )
+      return a.length() < b.length();
+    return compare_words( a, b ) < 0;
+  }
+
+  //----------------------------------------------------------------------------//
+  // RoutingTable                                                               //
+  //----------------------------------------------------------------------------//
+
+  // Add the next shard
+  Status RoutingTable::add( const std::string& first, const std::string& previous ) {
+    if ( keys_.empty() ) {
+      keys_.push_back( "" );
+      return SUCCESS;
+    }
+    if ( compare_words( previous, first ) >= 0 ) {
+      error_() << "Shard starting with \"" << first << "\" is not after \""
+               << previous << "\"";
+      return FAILURE;
+    }
+
+    // Shortest prefix of first that is still after previous
+    size_t common = 0;
+    while ( common < previous.length() && common < first.length()
+            && previous[common] == first[common] )
+      ++common;
+    keys_.push_back( first.substr( 0, common + 1 ) );
+    return SUCCESS;
+  }
+
+  // Load a table from a stream
+  Status RoutingTable::load( std::istream& input ) {
+    uint32_t    magic       = 0;
+    Index       num_shards  = 0;
+
+    clear();
+    input.read( (char*)&magic, sizeof(magic) );
+    if ( input.gcount() != sizeof(magic) || magic != ROUTES_MAGIC ) {
+      error_() << "Not a routing table";
+      return FAILURE;
+    }
+    input.read( (char*)&num_shards, sizeof(num_shards) );
+    if ( input.gcount() != sizeof(num_shards) || num_shards == 0 ) {
+      error_() << "Couldn't read number of shards";
+      return FAILURE;
+    }
+
+    for ( Index i = 0; i < num_shards; ++i ) {
+      unsigned char length = 0;
+      char          key[UCHAR_MAX];
+      input.read( (char*)&length, 1 );
+      if ( input.gcount() == 1 )
+        input.read( key, length );
+      if ( input.gcount() != length || input.bad() ) {
+        error_() << "Couldn't read key for shard " << i;
+        clear();
+        return FAILURE;
+      }
+      keys_.push_back( std::string( key, length ) );
+    }
+    if ( !keys_[0].empty() ) {
+      error_() << "First shard has a key";
+      clear();
+      return FAILURE;
+    }
+
+    // success
+    return SUCCESS;
+  }
+
+  // Save the table to a stream
+  Status RoutingTable::save( std::ostream& output ) {
+    Index num_shards = keys_.size();
+    output.write( (const char*)&ROUTES_MAGIC, sizeof(ROUTES_MAGIC) );
+    output.write( (const char*)&num_shards, sizeof(num_shards) );
+    for ( size_t i = 0; i < keys_.size(); ++i ) {
+      char length = keys_[i].length();
+      output.write( &length, 1 );
+      output.write( keys_[i].data(), keys_[i].length() );
+    }
+    if ( output.fail() ) {
+      error_() << "Couldn't write routing table";
+      return FAILURE;
+    }
+    return SUCCESS;
+  }
+
+  // The shard that would hold a word: the last one whose key isn't after it
+  Index RoutingTable::route( const std::string& word ) const {
+    Index low = 0, high = keys_.size();
+    while ( high - low > 1 ) {
+      Index mid = (low + high) / 2;
+      if ( compare_words( keys_[mid], word ) <= 0 )
+        low = mid;
+      else
+        high = mid;
+    }
+    return low;
+  }
+
+  // The shards that could hold words in a range
+  void RoutingTable::route_range( const std::string& first, const std::string& last,
+                                  Index* begin, Index* end ) const {
+    *begin = route( first );
+    *end   = keys_.size();
+    if ( !last.empty() ) {
+      // A shard starting exactly at last holds nothing in the range
+      Index shard = route( last );
+      *end = (shard > *begin && keys_[shard] == last) ? shard : shard + 1;
+    }
+  }
+
+  //----------------------------------------------------------------------------//
+  // LocalShard                                                                 //
+  //----------------------------------------------------------------------------//
+
+  // Answer a request straight away
+  Status LocalShard::send( const Protocol::Request& request ) {
+    Query* query = Protocol::make_query( dawg_, request );
+    if ( query != NULL )
+      query->run();
+    responses_.push_back( Protocol::Response() );
+    Protocol::make_response( request, query, &responses_.back() );
+    delete query;
+    return SUCCESS;
+  }
+
+  // Hand back the oldest answer
+  Status LocalShard::receive( Protocol::Response* response ) {
+    if ( responses_.empty() ) {
+      error_() << "No request to receive a response for";
+      return FAILURE;
+    }
+    *response = responses_.front();
+    responses_.pop_front();
+    return SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------//
+  // RemoteShard                                                                //
+  //----------------------------------------------------------------------------//
+
+  // Destructor
+  RemoteShard::~RemoteShard() {
+    if ( fd_ >= 0 )
+      close( fd_ );
+  }
+
+  // Connect to a server listening on a Unix socket
+  Status RemoteShard::connect_unix( const std::string& path ) {
+    sockaddr_un addr;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strncpy( addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1 );
+
+    fd_ = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd_ < 0 || connect( fd_, (sockaddr*)&addr, sizeof(addr) ) < 0 ) {
+      error_() << "Couldn't connect to " << path << ": " << strerror(errno);
+      return FAILURE;
+    }
+    return SUCCESS;
+  }
+
+  // Connect to a server listening on a TCP port
+  Status RemoteShard::connect_tcp( const std::string& host, int port ) {
+    sockaddr_in addr;
+    int         one = 1;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons( port );
+    if ( inet_pton( AF_INET, host.c_str(), &addr.sin_addr ) != 1 ) {
+      error_() << "Bad address " << host;
+      return FAILURE;
+    }
+
+    fd_ = socket( AF_INET, SOCK_STREAM, 0 );
+    if ( fd_ < 0 || connect( fd_, (sockaddr*)&addr, sizeof(addr) ) < 0 ) {
+      error_() << "Couldn't connect to " << host << ":" << port << ": " << strerror(errno);
+      return FAILURE;
+    }
+    setsockopt( fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+    return SUCCESS;
+  }
+
+  // Write a request to the server
+  Status RemoteShard::send( const Protocol::Request& request ) {
+    Protocol::Request   ours = request;
+    std::string         out;
+
+    ours.dict = dict_;
+    Protocol::encode( ours, &out );
+    for ( size_t sent = 0; sent < out.length(); ) {
+      ssize_t n = write( fd_, out.data() + sent, out.length() - sent );
+      if ( n < 0 && errno == EINTR )
+        continue;
+      if ( n < 0 ) {
+        error_() << "Couldn't send request: " << strerror(errno);
+        return FAILURE;
+      }
+      sent += n;
+    }
+    return SUCCESS;
+  }
+
+  // Read responses until the oldest one is complete
+  Status RemoteShard::receive( Protocol::Response* response ) {
+    std::vector<char> buffer( READ_SIZE );
+    for (;;) {
+      size_t size = Protocol::frame_size( in_.data(), in_.length() );
+      if ( size != 0 && size <= in_.length() ) {
+        Status status = Protocol::decode( in_.data(), size, response );
+        in_.erase( 0, size );
+        if ( status != SUCCESS )
+          error_() << "Bad response from server";
+        return status;
+      }
+
+      ssize_t n = read( fd_, &buffer[0], buffer.size() );
+      if ( n < 0 && errno == EINTR )
+        continue;
+      if ( n <= 0 ) {
+        error_() << "Couldn't read response: "
+                 << (n == 0 ? "server closed the connection" : strerror(errno));
+        return FAILURE;
+      }
+      in_.append( &buffer[0], n );
+    }
+  }
+
+  //----------------------------------------------------------------------------//
+  // Router                                                                     //
+  //----------------------------------------------------------------------------//
+
+  // Destructor
+  Router::~Router() {
+    clear();
+  }
+
+  // Clear the routing table and all shards
+  void Router::clear() {
+    for ( size_t i = 0; i < shards_.size(); ++i )
+      delete shards_[i];
+    shards_.clear();
+    routes_.clear();
+  }
+
+  // Load a routing table from a stream
+  Status Router::load_routes( std::istream& input ) {
+    if ( routes_.load( input ) != SUCCESS ) {
+      error_() << routes_.error();
+      return FAILURE;
+    }
+    return SUCCESS;
+  }
+
+  // Add the next shard
+  void Router::add_shard( Shard* shard ) {
+    shards_.push_back( shard );
+  }
+
+  // Send a request to a run of shards, then collect all the answers. A shard
+  // that couldn't make sense of the request fails the lot.
+  Status Router::fan_out( Protocol::Request request, Index first, Index last,
+                          std::vector<Protocol::Response>* responses ) {
+    Index  sent   = first;
+    Status status = SUCCESS;
+
+    if ( last > shards_.size() || routes_.num_shards() != shards_.size() ) {
+      error_() << "Have " << shards_.size() << " shards for a routing table of "
+               << routes_.num_shards();
+      return FAILURE;
+    }
+
+    responses->resize( last - first );
+    for ( ; sent < last; ++sent ) {
+      request.id = sent;
+      if ( shards_[sent]->send( request ) != SUCCESS ) {
+        error_() << "Shard " << sent << ": " << shards_[sent]->error();
+        status = FAILURE;
+        break;
+      }
+    }
+    // Collect everything that was sent, even after a failure, so no answers
+    // are left waiting to be mistaken for the next request's.
+    for ( Index i = first; i < sent; ++i ) {
+      if ( shards_[i]->receive( &(*responses)[i - first] ) != SUCCESS ) {
+        if ( status == SUCCESS )
+          error_() << "Shard " << i << ": " << shards_[i]->error();
+        status = FAILURE;
+      } else if ( (*responses)[i - first].status == Protocol::STATUS_BAD_REQUEST && status == SUCCESS ) {
+        error_() << "Shard " << i << ": bad request";
+        status = FAILURE;
+      }
+    }
+    return status;
+  }
+
+  // Walk the shards of a range in order, paging through each until limit
+  // words are found or the range is done. A shard that runs out of budget
+  // is asked again from just after the last word it found; if it found none
+  // it can't get any further, so stop there with what's in order so far.
+  Status Router::merge( const std::string& first, const std::string& last,
+                        size_t limit, std::vector<std::string>* results ) {
+    std::vector<Protocol::Response> responses, more;
+    Protocol::Request               request;
+    Index                           begin, end;
+
+    results->clear();
+    truncated_ = false;
+    routes_.route_range( first, last, &begin, &end );
+    request.op        = Protocol::OP_RANGE;
+    request.dict      = 0;
+    request.distance  = 0;
+    request.limit     = (limit != 0 && limit < PAGE_WORDS) ? limit : 0;
+    request.key       = Protocol::range_key( first, last );
+    if ( fan_out( request, begin, end, &responses ) != SUCCESS )
+      return FAILURE;
+
+    size_t page = request.limit != 0 ? request.limit : PAGE_WORDS;
+    for ( Index i = begin; i < end; ++i ) {
+      Protocol::Response* response = &responses[i - begin];
+      for (;;) {
+        for ( size_t w = 0; w < response->words.size(); ++w ) {
+          results->push_back( response->words[w] );
+          if ( limit != 0 && results->size() == limit )
+            return SUCCESS;
+        }
+        bool cut = response->status == Protocol::STATUS_TRUNCATED;
+        if ( cut && response->words.empty() ) {
+          truncated_ = true;
+          return SUCCESS;
+        }
+        if ( !cut && response->words.size() < page )
+          break;
+
+        // A full or cut short page: carry on from just after its last word
+        request.key = Protocol::range_key( word_after( response->words.back() ), last );
+        if ( fan_out( request, i, i + 1, &more ) != SUCCESS )
+          return FAILURE;
+        *response = more[0];
+      }
+    }
+    return SUCCESS;
+  }
+
+  // See if a word is in the dictionary
+  Status Router::contains_word( const std::string& word, bool* found ) {
+    std::vector<Protocol::Response> responses;
+    Protocol::Request               request;
+    Index                           shard = routes_.route( word );
+
+    request.op        = Protocol::OP_EXACT;
+    request.dict      = 0;
+    request.distance  = 0;
+    request.limit     = 0;
+    request.key       = word;
+    truncated_ = false;
+    if ( fan_out( request, shard, shard + 1, &responses ) != SUCCESS )
+      return FAILURE;
+    *found      = responses[0].status == Protocol::STATUS_OK;
+    truncated_  = responses[0].status == Protocol::STATUS_TRUNCATED;
+    return SUCCESS;
+  }
+
+  // Find the first words that start with a prefix
+  Status Router::complete( const std::string& prefix, size_t limit,
+                           std::vector<std::string>* results ) {
+    return merge( prefix, prefix_end( prefix ), limit, results );
+  }
+
+  // Find the first words from one word up to another
+  Status Router::range( const std::string& first, const std::string& last,
+                        size_t limit, std::vector<std::string>* results ) {
+    return merge( first, last, limit, results );
+  }
+
+  // Find the shortest words starting with a prefix. Each shard's shortest
+  // words include all of the overall shortest that it holds, unless it ran
+  // out of budget, which can't be picked up from.
+  Status Router::shortest( const std::string& prefix, size_t limit,
+                           std::vector<std::string>* results ) {
+    std::vector<Protocol::Response> responses;
+    Protocol::Request               request;
+    Index                           begin, end;
+
+    results->clear();
+    truncated_ = false;
+    routes_.route_range( prefix, prefix_end( prefix ), &begin, &end );
+    request.op        = Protocol::OP_TOP;
+    request.dict      = 0;
+    request.distance  = 0;
+    request.limit     = (limit != 0 && limit < PAGE_WORDS) ? limit : PAGE_WORDS;
+    request.key       = prefix;
+    if ( fan_out( request, begin, end, &responses ) != SUCCESS )
+      return FAILURE;
+
+    for ( size_t i = 0; i < responses.size(); ++i ) {
+      results->insert( results->end(), responses[i].words.begin(), responses[i].words.end() );
+      truncated_ |= responses[i].status == Protocol::STATUS_TRUNCATED;
+    }
+    std::sort( results->begin(), results->end(), shorter );
+    if ( results->size() > request.limit )
+      results->resize( request.limit );
+    return SUCCESS;
+  }
+
+  // Find the first words within an edit distance of a word. Any shard can
+  // hold a match, so all of them are asked. A fuzzy request has no key to
+  // pick up from, so a shard that runs out of budget just marks the results.
+  Status Router::fuzzy( const std::string& word, uint8_t distance, size_t limit,
+                        std::vector<std::string>* results ) {
+    std::vector<Protocol::Response> responses;
+    Protocol::Request               request;
+
+    results->clear();
+    truncated_ = false;
+    request.op        = Protocol::OP_FUZZY;
+    request.dict      = 0;
+    request.distance  = distance;
+    request.limit     = (limit != 0 && limit < PAGE_WORDS) ? limit : 0;
+    request.key       = word;
+    if ( fan_out( request, 0, shards_.size(), &responses ) != SUCCESS )
+      return FAILURE;
+
+    for ( size_t i = 0; i < responses.size(); ++i ) {
+      for ( size_t w = 0; w < responses[i].words.size(); ++w ) {
+        if ( limit != 0 && results->size() == limit )
+          return SUCCESS;
+        results->push_back( responses[i].words[w] );
+      }
+      truncated_ |= responses[i].status == Protocol::STATUS_TRUNCATED;
+    }
+    return SUCCESS;
+  }
+
+}
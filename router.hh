@@ -0,0 +1,230 @@
+#ifndef _ROUTER_HH
+#define _ROUTER_HH 1
+
+#include "dawg.hh"
+#include "protocol.hh"
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace DAWG {
+
+  /// Which shard of a dictionary split into prefix ranges holds which words.
+  ///
+  /// Shard i holds the words from key(i) up to, but not including, key(i + 1).
+  /// The first key is always empty. Each key is the shortest prefix of its
+  /// shard's first word that sorts after the last word of the shard before,
+  /// so routing only ever looks at a word's leading bytes.
+  class RoutingTable {
+    public:
+      /// Default constructor
+      RoutingTable() {}
+
+      /// Clear all shards.
+      inline void clear() { keys_.clear(); }
+
+      /// Add the next shard.
+      Status add(
+          const std::string& first,     ///< First word of the new shard
+          const std::string& previous   ///< Last word of the shard before, ignored for the first shard
+      );
+
+      /// Load a table from a stream.
+      Status load(
+          std::istream& input   ///< Stream containing a saved table
+      );
+
+      /// Save the table to a stream.
+      Status save(
+          std::ostream& output  ///< Stream to write to
+      );
+
+      /// Number of shards.
+      inline Index num_shards() const { return keys_.size(); }
+
+      /// First key of a shard.
+      inline const std::string& key(
+          Index shard           ///< Index of the shard
+      ) const {
+        return keys_[shard];
+      }
+
+      /// The shard that would hold a word.
+      Index route(
+          const std::string& word   ///< Word to look for
+      ) const;
+
+      /// The shards that could hold words in a range.
+      void route_range(
+          const std::string& first,     ///< First word of the range
+          const std::string& last,      ///< Word after the range, empty for no end
+          Index*             begin,     ///< Receives the first shard
+          Index*             end        ///< Receives the shard after the last one
+      ) const;
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      std::vector<std::string>  keys_;  ///< First key of each shard
+      Error                     error_;
+  };
+
+  /// One shard of a dictionary that a Router can send requests to.
+  ///
+  /// Requests are sent and their responses received separately, so a router
+  /// can have every shard working on a query at once.
+  class Shard {
+    public:
+      virtual ~Shard() {}
+
+      /// Start answering a request.
+      virtual Status send(
+          const Protocol::Request& request  ///< Request to answer
+      ) = 0;
+
+      /// Get the response to the oldest request sent.
+      virtual Status receive(
+          Protocol::Response* response      ///< Receives the response
+      ) = 0;
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    protected:
+      Error error_;
+  };
+
+  /// A shard loaded into this process.
+  class LocalShard : public Shard {
+    public:
+      LocalShard(
+          const DAWG& dawg      ///< The shard; must outlive this object
+      ) : dawg_(dawg) {}
+
+      Status send( const Protocol::Request& request );
+      Status receive( Protocol::Response* response );
+
+    private:
+      const DAWG&                       dawg_;
+      std::deque<Protocol::Response>    responses_;     ///< Answered but not yet received
+  };
+
+  /// A shard served by a dawg_server process.
+  class RemoteShard : public Shard {
+    public:
+      RemoteShard(
+          uint8_t dict = 0      ///< Index of the shard's dictionary on the server
+      ) : fd_(-1), dict_(dict) {}
+
+      ~RemoteShard();
+
+      /// Connect to a server listening on a Unix socket.
+      Status connect_unix(
+          const std::string& path   ///< Path of the socket
+      );
+
+      /// Connect to a server listening on a TCP port.
+      Status connect_tcp(
+          const std::string& host,  ///< IPv4 address of the server
+          int                port   ///< Port it listens on
+      );
+
+      Status send( const Protocol::Request& request );
+      Status receive( Protocol::Response* response );
+
+    private:
+      int           fd_;
+      uint8_t       dict_;
+      std::string   in_;        ///< Bytes received but not yet decoded
+  };
+
+  /// Sends queries to the shards of a dictionary split by a RoutingTable and
+  /// merges their answers.
+  ///
+  /// Only the shards whose range a query can touch are asked; they all work on
+  /// it at once. Because each shard holds a contiguous range of words, results
+  /// from list queries come back in dictionary order just by taking the
+  /// shards in order.
+  ///
+  /// A shard that runs out of budget answers with the words it found so far.
+  /// Range and prefix queries carry on from its last word; where a query
+  /// can't, the router answers with what it has and sets truncated().
+  class Router {
+    public:
+      /// Default constructor
+      Router() : truncated_(false) {}
+
+      /// Destructor
+      ~Router();
+
+      /// Clear the routing table and all shards.
+      void clear();
+
+      /// Load a routing table from a stream.
+      Status load_routes(
+          std::istream& input   ///< Stream containing a saved RoutingTable
+      );
+
+      /// Add the next shard, in routing table order. The router deletes it.
+      void add_shard(
+          Shard* shard          ///< Shard to add
+      );
+
+      /// See if a word is in the dictionary.
+      Status contains_word(
+          const std::string& word,          ///< Word to look for
+          bool*              found          ///< Receives whether it is there
+      );
+
+      /// Find the first words, in order, that start with a prefix.
+      Status complete(
+          const std::string&        prefix,     ///< Prefix to complete; empty for all words
+          size_t                    limit,      ///< Most words to find, 0 for no limit
+          std::vector<std::string>* results     ///< Receives the words
+      );
+
+      /// Find the shortest words that start with a prefix.
+      Status shortest(
+          const std::string&        prefix,     ///< Prefix to complete
+          size_t                    limit,      ///< Number of words to find, 0 for as many as a shard will return
+          std::vector<std::string>* results     ///< Receives the words, shortest first
+      );
+
+      /// Find the first words, in order, within an edit distance of a word.
+      Status fuzzy(
+          const std::string&        word,       ///< Word to match
+          uint8_t                   distance,   ///< Most edits allowed
+          size_t                    limit,      ///< Most words to find, 0 for all each shard will return
+          std::vector<std::string>* results     ///< Receives the words
+      );
+
+      /// Find the first words, in order, from one word up to another.
+      Status range(
+          const std::string&        first,      ///< First word of the range
+          const std::string&        last,       ///< Word after the range, empty for no end
+          size_t                    limit,      ///< Most words to find, 0 for no limit
+          std::vector<std::string>* results     ///< Receives the words
+      );
+
+      /// Whether a shard ran out of budget during the last query, so its
+      /// results may be missing some. List results are still in order.
+      inline bool truncated() const { return truncated_; }
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      RoutingTable          routes_;
+      std::vector<Shard*>   shards_;
+      bool                  truncated_;     ///< Set when a shard's answer was cut short
+      Error                 error_;
+
+      Status fan_out( Protocol::Request request, Index first, Index last,
+                      std::vector<Protocol::Response>* responses );
+      Status merge( const std::string& first, const std::string& last,
+                    size_t limit, std::vector<std::string>* results );
+  };
+}
+
+#endif /* not _ROUTER_HH */
@@ -0,0 +1,324 @@
+#include "spelling.hh"
+#include "parallel.hh"
+#include "query.hh"
+#include <algorithm>
+#include <string.h>
+
+namespace DAWG {
+
+  const unsigned MAX_PREFIX     = 7;                        /// Most letters of a word indexed; a deletion fits in a Key.
+  const unsigned SLICES         = 64;                       /// Parts the words are split into to make deletions.
+  const unsigned char SIGN_FLIP = (char)-1 < 0 ? 0x80 : 0;  /// Makes bytes sort the way chars do.
+
+  /// Up to MAX_PREFIX letters, first letter in the top byte, with the number
+  /// of letters in the bottom byte. Keys sort the way Creator wants words.
+  typedef uint64_t Key;
+
+  /// A deletion and the number of a word it came from.
+  struct Pair {
+    Key     key;
+    Index   word;
+
+    inline bool operator<( const Pair& other ) const {
+      return key != other.key ? key < other.key : word < other.word;
+    }
+    inline bool operator==( const Pair& other ) const {
+      return key == other.key && word == other.word;
+    }
+  };
+
+  // Pack letters into a key
+  static Key make_key( const char* letters, size_t length ) {
+    Key key = 0;
+    for ( size_t i = 0; i < MAX_PREFIX; ++i )
+      key = (key << 8) | (i < length ? (unsigned char)letters[i] ^ SIGN_FLIP : 0);
+    return (key << 8) | length;
+  }
+
+  // The letters in a key
+  static std::string key_letters( Key key ) {
+    std::string letters( key & 0xFF, 0 );
+    for ( size_t i = 0; i < letters.length(); ++i )
+      letters[i] = (char)(((key >> (8 * (MAX_PREFIX - i))) & 0xFF) ^ SIGN_FLIP);
+    return letters;
+  }
+
+  // First letter of a key
+  static inline size_t key_first( Key key ) {
+    return (size_t)(((key >> (8 * MAX_PREFIX)) & 0xFF) ^ SIGN_FLIP);
+  }
+
+  // Every way of deleting up to max_distance letters from a key, the key
+  // itself included. Some may come out more than once.
+  static void deletions( Key key, unsigned max_distance, std::vector<Key>* out ) {
+    std::string letters = key_letters( key );
+    size_t      length  = letters.length();
+    char        kept[MAX_PREFIX];
+
+    for ( unsigned mask = 0; mask < (1u << length); ++mask ) {
+      unsigned  deleted = 0;
+      size_t    k       = 0;
+      for ( size_t i = 0; i < length; ++i ) {
+        if ( mask & (1u << i) )
+          ++deleted;
+        else
+          kept[k++] = letters[i];
+      }
+      if ( deleted <= max_distance )
+        out->push_back( make_key( kept, k ) );
+    }
+  }
+
+  // Edit distance, or anything over max once it's sure to be over max
+  static unsigned distance( const std::string& a, const std::string& b, unsigned max ) {
+    if ( a.length() > b.length() + max || b.length() > a.length() + max )
+      return max + 1;
+
+    std::vector<unsigned> row( b.length() + 1 );
+    for ( size_t j = 0; j <= b.length(); ++j )
+      row[j] = j;
+    for ( size_t i = 1; i <= a.length(); ++i ) {
+      unsigned diagonal = row[0];
+      unsigned best     = row[0] = i;
+      for ( size_t j = 1; j <= b.length(); ++j ) {
+        unsigned cost = std::min( diagonal + (a[i - 1] != b[j - 1]), std::min( row[j], row[j - 1] ) + 1 );
+        diagonal = row[j];
+        row[j]   = cost;
+        best     = std::min( best, cost );
+      }
+      if ( best > max )
+        return max + 1;
+    }
+    return row[b.length()];
+  }
+
+  // Count a step against a budget, looking at the budget when it's due
+  // @return  false once the budget is spent
+  static inline bool take_step( const Budget& budget, size_t* steps, size_t* check_at ) {
+    if ( *steps == *check_at ) {
+      if ( budget.spent( *steps ) )
+        return false;
+      *check_at = budget.next_check( *steps );
+    }
+    ++*steps;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------//
+  // SpellingIndex                                                              //
+  //----------------------------------------------------------------------------//
+
+  /// The deletions that start with one letter.
+  struct SpellingIndex::Part {
+    DAWG*               deletions;
+    WordNumbering       numbering;      ///< Number of each deletion
+    std::vector<Index>  offsets;        ///< Where each deletion's words start in words, and one past the end
+    std::vector<Index>  words;          ///< Words each deletion came from, in order
+
+    Part() : deletions(NULL) {}
+    ~Part() { delete deletions; }
+  };
+
+  /// What the build threads share.
+  struct SpellingIndex::Build {
+    unsigned                    max_distance;
+    std::vector<Key>            prefixes;       ///< Indexed letters of each word
+    std::vector<Pair>           pairs[SLICES][256]; ///< Deletions of each slice of the words, by first letter
+    Part*                       parts[256];
+    Status                      status[256];
+    std::string                 errors[256];
+  };
+
+  // Constructor
+  SpellingIndex::SpellingIndex() : dawg_(NULL), max_distance_(0), prefix_length_(0) {
+    memset( (void*)parts_, 0, sizeof(parts_) );
+  }
+
+  // Destructor
+  SpellingIndex::~SpellingIndex() {
+    clear();
+  }
+
+  // Free the index
+  void SpellingIndex::clear() {
+    for ( size_t i = 0; i < 256; ++i ) {
+      delete parts_[i];
+      parts_[i] = NULL;
+    }
+    short_words_.clear();
+    dawg_ = NULL;
+  }
+
+  // Make the deletions of one slice of the words
+  void SpellingIndex::make_pairs( size_t slice, void* arg ) {
+    Build*              build   = (Build*)arg;
+    size_t              count   = build->prefixes.size();
+    std::vector<Key>    keys;
+
+    for ( size_t w = count * slice / SLICES; w < count * (slice + 1) / SLICES; ++w ) {
+      keys.clear();
+      deletions( build->prefixes[w], build->max_distance, &keys );
+      for ( size_t k = 0; k < keys.size(); ++k ) {
+        if ( (keys[k] & 0xFF) == 0 )
+          continue;
+        Pair pair = { keys[k], (Index)w };
+        build->pairs[slice][key_first( keys[k] )].push_back( pair );
+      }
+    }
+  }
+
+  // Build the DAWG of the deletions that start with one letter
+  void SpellingIndex::make_part( size_t letter, void* arg ) {
+    Build*              build   = (Build*)arg;
+    std::vector<Pair>   pairs;
+
+    build->parts[letter]  = NULL;
+    build->status[letter] = SUCCESS;
+    for ( size_t s = 0; s < SLICES; ++s ) {
+      pairs.insert( pairs.end(), build->pairs[s][letter].begin(), build->pairs[s][letter].end() );
+      std::vector<Pair>().swap( build->pairs[s][letter] );
+    }
+    if ( pairs.empty() )
+      return;
+    std::sort( pairs.begin(), pairs.end() );
+    pairs.erase( std::unique( pairs.begin(), pairs.end() ), pairs.end() );
+
+    Part*   part = new Part;
+    Creator creator;
+    creator.start();
+    for ( size_t i = 0; i < pairs.size(); ++i ) {
+      if ( i == 0 || pairs[i].key != pairs[i - 1].key ) {
+        if ( creator.add_word( key_letters( pairs[i].key ) ) != SUCCESS ) {
+          build->status[letter] = FAILURE;
+          build->errors[letter] = creator.error();
+          delete part;
+          return;
+        }
+        part->offsets.push_back( part->words.size() );
+      }
+      part->words.push_back( pairs[i].word );
+    }
+    part->offsets.push_back( part->words.size() );
+
+    part->deletions = creator.finish();
+    if ( part->deletions == NULL ) {
+      build->status[letter] = FAILURE;
+      build->errors[letter] = creator.error();
+      delete part;
+      return;
+    }
+    part->numbering.build( *part->deletions );
+    build->parts[letter] = part;
+  }
+
+  // Index every word of a dictionary
+  Status SpellingIndex::build( const DAWG& dawg, unsigned max_distance, unsigned prefix_length, unsigned threads ) {
+    clear();
+    if ( prefix_length == 0 || prefix_length > MAX_PREFIX || max_distance >= prefix_length ) {
+      error_() << "Prefix length must be from " << max_distance + 1 << " to " << MAX_PREFIX;
+      return FAILURE;
+    }
+
+    // Number the words and keep the letters of each to index
+    Build*          build = new Build;
+    WordIterator    words( dawg );
+    build->max_distance = max_distance;
+    while ( words.next_word() ) {
+      size_t length = std::min( words.word().length(), (size_t)prefix_length );
+      if ( length <= max_distance )
+        short_words_.push_back( build->prefixes.size() );
+      build->prefixes.push_back( make_key( words.word().data(), length ) );
+    }
+
+    parallel_for( SLICES, threads, make_pairs, build );
+    parallel_for( 256, threads, make_part, build );
+
+    Status status = SUCCESS;
+    for ( size_t i = 0; i < 256; ++i ) {
+      parts_[i] = build->parts[i];
+      if ( build->status[i] != SUCCESS && status == SUCCESS ) {
+        error_() << "Couldn't index deletions starting with letter " << i << ": " << build->errors[i];
+        status = FAILURE;
+      }
+    }
+    delete build;
+    if ( status != SUCCESS ) {
+      clear();
+      return FAILURE;
+    }
+
+    dawg_           = &dawg;
+    max_distance_   = max_distance;
+    prefix_length_  = prefix_length;
+    words_.build( dawg );
+    return SUCCESS;
+  }
+
+  // Gather the words the deletions of the word lead to, then check each
+  bool SpellingIndex::lookup( const std::string& word, std::vector<std::string>* results,
+                              const Budget& budget ) const {
+    std::vector<Key>    keys;
+    std::vector<Index>  candidates;
+    std::string         candidate;
+    size_t              steps       = 0;
+    size_t              check_at    = 0;
+
+    results->clear();
+    if ( dawg_ == NULL )
+      return true;
+    deletions( make_key( word.data(), std::min( word.length(), (size_t)prefix_length_ ) ), max_distance_, &keys );
+    std::sort( keys.begin(), keys.end() );
+    keys.erase( std::unique( keys.begin(), keys.end() ), keys.end() );
+
+    for ( size_t k = 0; k < keys.size(); ++k ) {
+      if ( !take_step( budget, &steps, &check_at ) )
+        return false;
+      if ( (keys[k] & 0xFF) == 0 ) {
+        candidates.insert( candidates.end(), short_words_.begin(), short_words_.end() );
+        continue;
+      }
+      const Part* part = parts_[key_first( keys[k] )];
+      Index       number;
+      if ( part == NULL || !part->numbering.rank( key_letters( keys[k] ), &number ) )
+        continue;
+      candidates.insert( candidates.end(),
+                         part->words.begin() + part->offsets[number],
+                         part->words.begin() + part->offsets[number + 1] );
+    }
+    std::sort( candidates.begin(), candidates.end() );
+    candidates.erase( std::unique( candidates.begin(), candidates.end() ), candidates.end() );
+
+    // Candidates are numbered in order, so a cut short list is a prefix
+    for ( size_t c = 0; c < candidates.size(); ++c ) {
+      if ( !take_step( budget, &steps, &check_at ) )
+        return false;
+      words_.unrank( candidates[c], &candidate );
+      if ( distance( word, candidate, max_distance_ ) <= max_distance_ )
+        results->push_back( candidate );
+    }
+    return true;
+  }
+
+  // Number of distinct deletions indexed
+  size_t SpellingIndex::num_deletions() const {
+    size_t count = short_words_.empty() ? 0 : 1;
+    for ( size_t i = 0; i < 256; ++i ) {
+      if ( parts_[i] != NULL )
+        count += parts_[i]->offsets.size() - 1;
+    }
+    return count;
+  }
+
+  // Bytes used, not counting the dictionary
+  size_t SpellingIndex::memory() const {
+    size_t bytes = words_.memory() + short_words_.size() * sizeof(Index);
+    for ( size_t i = 0; i < 256; ++i ) {
+      const Part* part = parts_[i];
+      if ( part != NULL )
+        bytes += (part->deletions->num_edges() + 1) * sizeof(Edge) + part->numbering.memory()
+                 + (part->offsets.size() + part->words.size()) * sizeof(Index);
+    }
+    return bytes;
+  }
+
+}
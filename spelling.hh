@@ -0,0 +1,84 @@
+#ifndef _SPELLING_HH
+#define _SPELLING_HH 1
+
+#include "dawg.hh"
+#include "numbering.hh"
+#include "query.hh"
+#include <string>
+#include <vector>
+
+namespace DAWG {
+
+  /// Finds the words within a few edits of a word by symmetric deletion.
+  ///
+  /// Two words are within k edits only if deleting at most k letters from
+  /// each can make them the same, so the index holds every such deletion of
+  /// every dictionary word, with the numbers of the words it came from.
+  /// Looking a word up deletes from it the same way and checks only the
+  /// words its deletions lead to. As in SymSpell, only the first few letters
+  /// of each word are indexed: prefixes within k edits of each other still
+  /// share a deletion, and candidates are checked against the whole word.
+  ///
+  /// The deletions are stored as DAWGs built by Creator, one for each first
+  /// letter, and each deletion's number in its DAWG indexes the list of
+  /// words it came from. Building runs on several threads.
+  class SpellingIndex {
+    public:
+      /// Default constructor
+      SpellingIndex();
+
+      /// Destructor
+      ~SpellingIndex();
+
+      /// Free the index.
+      void clear();
+
+      /// Index every word of a dictionary.
+      Status build(
+          const DAWG&   dawg,               ///< Dictionary; must outlive the index
+          unsigned      max_distance = 2,   ///< Most edits lookups will allow
+          unsigned      prefix_length = 7,  ///< Letters of each word to index, 7 at most
+          unsigned      threads = 0         ///< Threads to build with, 0 for one per CPU
+      );
+
+      /// Find the words within max_distance edits of a word, in order. Each
+      /// deletion looked up and each candidate checked is a step of the
+      /// budget.
+      /// @return   false if the budget ran out, leaving only the first of the
+      ///           words found
+      bool lookup(
+          const std::string&        word,               ///< Word to look for
+          std::vector<std::string>* results,            ///< Receives the words found
+          const Budget&             budget = Budget()   ///< Limits on the work done
+      ) const;
+
+      /// Most edits lookups allow.
+      inline unsigned max_distance() const { return max_distance_; }
+
+      /// Number of distinct deletions indexed.
+      size_t num_deletions() const;
+
+      /// Bytes used, not counting the dictionary.
+      size_t memory() const;
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      struct Part;
+      struct Build;
+
+      const DAWG*           dawg_;
+      WordNumbering         words_;             ///< Numbers of the dictionary's words
+      unsigned              max_distance_;
+      unsigned              prefix_length_;
+      Part*                 parts_[256];        ///< Deletions by first letter, NULL if none
+      std::vector<Index>    short_words_;       ///< Words all of whose prefix can be deleted
+      Error                 error_;
+
+      static void   make_pairs( size_t slice, void* build );
+      static void   make_part( size_t letter, void* build );
+  };
+}
+
+#endif /* not _SPELLING_HH */
@@ -0,0 +1,249 @@
+#ifndef _STATIC_DAWG_HH
+#define _STATIC_DAWG_HH 1
+
+#include "dawg.hh"
+
+#if __cplusplus >= 202002L
+#include <cstddef>
+#include <string_view>
+
+namespace DAWG {
+
+  /// Raised, at compile time, by building a StaticDAWG from bad words. The
+  /// name of the function called shows up in the compiler's error.
+  void static_dawg_word_is_empty();
+  void static_dawg_word_is_too_long();
+  void static_dawg_words_are_out_of_order();
+  void static_dawg_is_full();
+
+  /// Size of a StaticDAWG's node register: a power of two at least twice
+  /// the capacity, so probing the way Creator probes its hash table always
+  /// finds a free slot.
+  constexpr Index static_register_size(
+      size_t        capacity    ///< Most edges the DAWG can hold
+  ) {
+    Index size = 1;
+    while ( size < 2 * capacity )
+      size *= 2;
+    return size;
+  }
+
+  /// A DAWG built at compile time into a fixed array, laid out exactly as
+  /// Creator lays it out, so it takes no time to start up:
+  ///
+  ///     constexpr auto keywords = DAWG::build( { "from", "select", "where" } );
+  ///     static_assert( keywords.contains_word( "select" ) );
+  ///
+  /// Words have to be in the order Creator wants. Without a capacity, room
+  /// is left for every letter of every word to need its own edge; to store
+  /// no more than the edges used, give static_size() as the capacity:
+  ///
+  ///     constexpr const char* words[] = { "from", "select", "where" };
+  ///     constexpr auto keywords = DAWG::build<DAWG::static_size( words )>( words );
+  template <size_t Capacity>
+  class StaticDAWG {
+    // Creator's edge layout and limits; see Edge and dawg.cc
+    static constexpr uint32_t   MASK_LETTER         = 0x000000FF;
+    static constexpr uint32_t   MASK_END_OF_WORD    = 0x00000100;
+    static constexpr uint32_t   MASK_END_OF_NODE    = 0x00000200;
+    static constexpr uint32_t   SHIFT_CHILD         = 10;
+    static constexpr Index      MAX_CHARS           = 256;
+    static constexpr Index      MAX_WORD_LENGTH     = 32;
+    static constexpr Index      REGISTER_SIZE       = static_register_size( Capacity );
+
+    public:
+      /// Build from words in order.
+      consteval StaticDAWG(
+          const char* const*    words,      ///< Words to add
+          size_t                count       ///< Number of words
+      ) : edges_(), num_edges_(1 + MAX_CHARS) {
+        Builder builder;
+        if ( num_edges_ > Capacity )
+          static_dawg_is_full();
+        for ( size_t w = 0; w < count; ++w )
+          builder.add_word( *this, words[w] );
+        builder.finish( *this );
+      }
+
+      /// See if a word is in the DAWG.
+      constexpr bool contains_word(
+          std::string_view  word    ///< Word to look for
+      ) const {
+        Index   node    = child( edges_[num_edges_] );
+        bool    eow     = false;
+        for ( char c : word ) {
+          Index i = node;
+          while ( i != 0 && letter( edges_[i] ) != c )
+            i = (edges_[i] & MASK_END_OF_NODE) ? 0 : i + 1;
+          if ( i == 0 )
+            return false;
+          eow   = (edges_[i] & MASK_END_OF_WORD) != 0;
+          node  = child( edges_[i] );
+        }
+        return eow;
+      }
+
+      /// Number of edges, as DAWG counts them: the null edge and the root
+      /// node's reserved edges included, the root edge not.
+      constexpr Index num_edges() const { return num_edges_; }
+
+      /// An individual edge's data.
+      constexpr uint32_t edge(
+          Index         index       ///< Index of the edge
+      ) const {
+        return edges_[index];
+      }
+
+      /// Let a DAWG use these edges, for queries this class doesn't have.
+      /// Nothing is copied, so this has to outlive the DAWG's use of them.
+      void share(
+          DAWG*         dawg        ///< DAWG to point at the edges
+      ) const {
+        dawg->share( reinterpret_cast<const Edge*>( edges_ ), num_edges_ );
+      }
+
+    private:
+      uint32_t  edges_[Capacity + 1];   ///< Edges, then the root edge
+      Index     num_edges_;
+
+      static constexpr char     letter( uint32_t edge ) { return (char)(edge & MASK_LETTER); }
+      static constexpr Index    child( uint32_t edge )  { return edge >> SHIFT_CHILD; }
+
+      /// Creator's build state: the edges of the last word's nodes, and the
+      /// register of nodes already finished.
+      class Builder {
+        public:
+          constexpr Builder() : stack_(), stack_count_(), stack_pos_(0), num_words_(0), register_() {}
+
+          // Same steps as Creator::add_word(), failing where it fails
+          constexpr void add_word( StaticDAWG& dawg, std::string_view word ) {
+            if ( word.empty() )
+              static_dawg_word_is_empty();
+            if ( word.length() >= MAX_WORD_LENGTH )
+              static_dawg_word_is_too_long();
+
+            if ( num_words_ > 0 ) {
+              Index i = 0;
+              while ( i <= stack_pos_ && i < word.length() && word[i] == letter( *current( i ) ) )
+                ++i;
+              if ( i <= stack_pos_ ) {
+                if ( i == word.length() || word[i] < letter( *current( i ) ) )
+                  static_dawg_words_are_out_of_order();
+                for ( ; stack_pos_ > i; --stack_pos_ )
+                  finish_node( dawg, stack_pos_ );
+              } else if ( i == word.length() ) {
+                return;
+              } else {
+                ++stack_pos_;
+              }
+            }
+
+            for ( ; stack_pos_ < word.length(); ++stack_pos_ ) {
+              ++stack_count_[stack_pos_];
+              *current( stack_pos_ ) = (unsigned char)word[stack_pos_];
+            }
+            --stack_pos_;
+            *current( stack_pos_ ) |= MASK_END_OF_WORD;
+            ++num_words_;
+          }
+
+          // Same steps as Creator::finish()
+          constexpr void finish( StaticDAWG& dawg ) {
+            if ( num_words_ > 0 ) {
+              for ( ; stack_pos_ > 0; --stack_pos_ )
+                finish_node( dawg, stack_pos_ );
+              *current( 0 ) |= MASK_END_OF_NODE;
+            }
+            for ( Index i = 0; i < MAX_CHARS; ++i )
+              dawg.edges_[1 + i] = stack_[0][i];
+            dawg.edges_[MAX_CHARS] |= MASK_END_OF_NODE;
+            dawg.edges_[dawg.num_edges_] = 1 << SHIFT_CHILD;
+          }
+
+        private:
+          uint32_t  stack_[MAX_WORD_LENGTH][MAX_CHARS];
+          Index     stack_count_[MAX_WORD_LENGTH];
+          Index     stack_pos_;
+          size_t    num_words_;
+          Index     register_[REGISTER_SIZE];     ///< First edge of each finished node, 0 for empty
+
+          constexpr uint32_t* current( Index pos ) { return &stack_[pos][stack_count_[pos] - 1]; }
+
+          // Same as Creator::compute_hash()
+          static constexpr Index compute_hash( const uint32_t* edges, Index num_edges ) {
+            Index result = 0;
+            for ( Index i = 0; i < num_edges; ++i )
+              result = ((result << 1) | (result >> 31)) ^ edges[i];
+            return result;
+          }
+
+          // Creator::finish_node(), with the same dedup and probing
+          constexpr void finish_node( StaticDAWG& dawg, Index pos ) {
+            *current( pos ) |= MASK_END_OF_NODE;
+
+            const uint32_t* edges   = stack_[pos];
+            Index           count   = stack_count_[pos];
+            Index           mask    = REGISTER_SIZE - 1;
+            Index           slot    = compute_hash( edges, count ) & mask;
+            Index           step    = 9;
+
+            for ( ; ; ) {
+              Index start = register_[slot];
+              if ( start == 0 )
+                break;
+              Index i = 0;
+              while ( i < count && dawg.edges_[start + i] == edges[i] )
+                ++i;
+              if ( i == count )
+                break;
+              slot  = (slot + step) & mask;
+              step += 9;
+            }
+
+            Index start = register_[slot];
+            if ( start == 0 ) {
+              if ( dawg.num_edges_ + count > Capacity )
+                static_dawg_is_full();
+              start = dawg.num_edges_;
+              for ( Index i = 0; i < count; ++i )
+                dawg.edges_[start + i] = edges[i];
+              register_[slot]   = start;
+              dawg.num_edges_  += count;
+            }
+            *current( pos - 1 ) = (*current( pos - 1 ) & ~(~0u << SHIFT_CHILD)) | (start << SHIFT_CHILD);
+
+            for ( Index i = 0; i < count; ++i )
+              stack_[pos][i] = 0;
+            stack_count_[pos] = 0;
+          }
+      };
+  };
+
+  /// Room for a StaticDAWG of count words, if no two of them shared an edge.
+  constexpr size_t static_capacity(
+      size_t        count       ///< Number of words
+  ) {
+    return 1 + 256 + count * 31;
+  }
+
+  /// Build a StaticDAWG from words in order.
+  template <size_t Capacity = 0, size_t N>
+  consteval StaticDAWG<Capacity != 0 ? Capacity : static_capacity( N )> build(
+      const char* const (&words)[N]     ///< Words to add
+  ) {
+    return StaticDAWG<Capacity != 0 ? Capacity : static_capacity( N )>( words, N );
+  }
+
+  /// Edges a StaticDAWG of words needs; the smallest capacity to build it
+  /// with.
+  template <size_t N>
+  consteval size_t static_size(
+      const char* const (&words)[N]     ///< Words to add
+  ) {
+    return StaticDAWG<static_capacity( N )>( words, N ).num_edges();
+  }
+}
+
+#endif /* __cplusplus >= 202002L */
+
+#endif /* not _STATIC_DAWG_HH */
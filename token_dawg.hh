@@ -0,0 +1,437 @@
+#ifndef _TOKEN_DAWG_HH
+#define _TOKEN_DAWG_HH 1
+
+#include "dawg.hh"
+#include <algorithm>
+#include <vector>
+
+namespace DAWG {
+
+  const uint32_t TOKEN_DAWG_MAGIC   = 0xC6ACC2F3;   /// Identifies token DAWGs we write.
+  const size_t   MIN_TOKEN_REGISTER = 1024;         /// Smallest node register; always a power of two.
+
+  /// The edge of a TokenDAWG node: a symbol, plus the index of the first edge
+  /// of the child node with the end-of-phrase flag in its low bit. Symbol and
+  /// Link must be unsigned integer types.
+  ///
+  /// The edge before the first edge of every node is a header which holds
+  /// the number of edges in the node instead, so nodes with thousands of
+  /// edges can be binary searched.
+  template <typename Symbol, typename Link>
+  class TokenEdge {
+    static const Link MASK_END_OF_PHRASE    = 1;    ///< Bit 0 = end-of-phrase
+    static const int  SHIFT_CHILD           = 1;    ///< Bits 1- = index of first child edge
+
+    public:
+      TokenEdge(Symbol _symbol = 0, bool _end_of_phrase = false, Link _child = 0)
+        : symbol_(_symbol), link_((Link)(_child << SHIFT_CHILD) | (_end_of_phrase ? (Link)MASK_END_OF_PHRASE : (Link)0)) {}
+
+      /// A header edge for a node.
+      static inline TokenEdge header( Link size ) { TokenEdge edge; edge.link_ = size; return edge; }
+
+      /// Largest index a child can point to.
+      static inline Link max_index() { return (Link)~(Link)0 >> SHIFT_CHILD; }
+
+      /// The symbol of this edge.
+      inline Symbol symbol()        const { return symbol_; }
+      /// Is this the last symbol of a phrase?
+      inline bool   end_of_phrase() const { return (link_ & MASK_END_OF_PHRASE) != 0; }
+      /// Index of the first edge of the child node, 0 if there is none.
+      inline Link   child()         const { return link_ >> SHIFT_CHILD; }
+      /// Number of edges in the node after a header edge.
+      inline Link   size()          const { return link_; }
+
+      /// Set the end-of-phrase flag.
+      inline void   end_of_phrase(bool b) { link_ = b ? (link_ | MASK_END_OF_PHRASE) : (link_ & ~MASK_END_OF_PHRASE); }
+      /// Set the child index.
+      inline void   child(Link n)         { link_ = (Link)(n << SHIFT_CHILD) | (link_ & MASK_END_OF_PHRASE); }
+
+      inline bool operator==(const TokenEdge& other) const { return symbol_ == other.symbol_ && link_ == other.link_; }
+      inline bool operator<(const TokenEdge& other)  const { return symbol_ < other.symbol_; }
+
+    private:
+      Symbol    symbol_;
+      Link      link_;
+  };
+
+  /// A DAWG over sequences of wide symbols, such as phrases as sequences of
+  /// 32-bit word IDs. Each symbol takes one edge however large it is, so a
+  /// phrase is as deep as it has words rather than bytes.
+  ///
+  /// To find the entities in a token stream, call longest_match() at each
+  /// position and skip past whatever it matches:
+  ///
+  ///     for ( size_t i = 0; i < tokens.size(); ) {
+  ///       size_t length = phrases.longest_match( &tokens[i], tokens.size() - i );
+  ///       if ( length != 0 )
+  ///         link( i, length );
+  ///       i += length != 0 ? length : 1;
+  ///     }
+  template <typename Symbol, typename Link = uint32_t>
+  class TokenDAWG {
+    public:
+      typedef TokenEdge<Symbol, Link>   Edge;
+      typedef std::vector<Symbol>       Phrase;
+
+      /// Default constructor
+      TokenDAWG() : edges_(1, Edge()), root_(0) {}
+
+      /// Clear the DAWG.
+      inline void clear() {
+        edges_.assign( 1, Edge() );
+        root_ = 0;
+      }
+
+      /// See if a phrase is in the DAWG.
+      bool contains(
+          const Symbol* phrase,     ///< Symbols of the phrase
+          size_t        length      ///< Number of symbols
+      ) const {
+        Link node = root_;
+        for ( size_t i = 0; i < length; ++i ) {
+          Link e = find( node, phrase[i] );
+          if ( e == 0 )
+            return false;
+          if ( i + 1 == length )
+            return edges_[e].end_of_phrase();
+          node = edges_[e].child();
+        }
+        return false;
+      }
+
+      /// See if a phrase is in the DAWG.
+      inline bool contains( const Phrase& phrase ) const {
+        return !phrase.empty() && contains( &phrase[0], phrase.size() );
+      }
+
+      /// Find the longest phrase the tokens start with.
+      /// @return   its length, or 0 if they don't start with any phrase
+      size_t longest_match(
+          const Symbol* tokens,     ///< Tokens to match
+          size_t        length      ///< Number of tokens
+      ) const {
+        size_t  longest = 0;
+        Link    node    = root_;
+        for ( size_t i = 0; i < length && node != 0; ++i ) {
+          Link e = find( node, tokens[i] );
+          if ( e == 0 )
+            break;
+          if ( edges_[e].end_of_phrase() )
+            longest = i + 1;
+          node = edges_[e].child();
+        }
+        return longest;
+      }
+
+      /// Find the phrases that start with a prefix, in order. An empty prefix
+      /// gives every phrase.
+      void complete(
+          const Symbol*         prefix,             ///< Symbols of the prefix
+          size_t                length,             ///< Number of symbols
+          std::vector<Phrase>*  results,            ///< Receives the phrases
+          size_t                max_results = 0     ///< Stop after this many, 0 for no limit
+      ) const {
+        Phrase  phrase( prefix, prefix + length );
+        Link    node = root_;
+
+        results->clear();
+        for ( size_t i = 0; i < length; ++i ) {
+          Link e = find( node, prefix[i] );
+          if ( e == 0 )
+            return;
+          if ( i + 1 == length && edges_[e].end_of_phrase() )
+            results->push_back( phrase );
+          node = edges_[e].child();
+        }
+        collect( node, &phrase, results, max_results );
+      }
+
+      /// Find the edge for a symbol in a node.
+      /// @return   its index, or 0 if the node has no such edge
+      inline Link find(
+          Link          node,       ///< First edge of the node
+          Symbol        symbol      ///< Symbol to look for
+      ) const {
+        if ( node == 0 )
+          return 0;
+        const Edge* first = &edges_[node];
+        const Edge* last  = first + edges_[node - 1].size();
+        const Edge* e     = std::lower_bound( first, last, Edge( symbol ) );
+        return e != last && e->symbol() == symbol ? node + (Link)(e - first) : 0;
+      }
+
+      /// First edge of the root node, 0 if the DAWG is empty.
+      inline Link root() const { return root_; }
+
+      /// Get an individual edge.
+      inline const Edge& edge(
+          Link          index       ///< Index of the edge
+      ) const {
+        return edges_[index];
+      }
+
+      /// Number of edges, counting node headers.
+      inline Link num_edges() const { return (Link)(edges_.size() - 1); }
+
+      /// Use edges built by TokenCreator. They are swapped in, not copied.
+      inline void assign(
+          std::vector<Edge>*    edges,  ///< Edges from the null edge on
+          Link                  root    ///< First edge of the root node
+      ) {
+        edges_.swap( *edges );
+        root_ = root;
+      }
+
+      /// Load a saved DAWG from a stream. It must have been saved with the
+      /// same Symbol and Link types.
+      Status load(
+          std::istream& input   ///< Stream containing a saved DAWG
+      ) {
+        uint32_t        magic   = 0;
+        unsigned char   sizes[2];
+        Link            count   = 0;
+        Link            root    = 0;
+
+        clear();
+        input.read( (char*)&magic, sizeof(magic) );
+        if ( input.gcount() != sizeof(magic) || magic != TOKEN_DAWG_MAGIC ) {
+          error_() << "Not a token DAWG";
+          return FAILURE;
+        }
+        input.read( (char*)sizes, 2 );
+        if ( input.gcount() != 2 || sizes[0] != sizeof(Symbol) || sizes[1] != sizeof(Link) ) {
+          error_() << "Token DAWG has different symbol or index sizes";
+          return FAILURE;
+        }
+        input.read( (char*)&count, sizeof(count) );
+        input.read( (char*)&root, sizeof(root) );
+        if ( !input.good() || count > Edge::max_index() || root > count ) {
+          error_() << "Couldn't read number of edges";
+          return FAILURE;
+        }
+        edges_.resize( (size_t)count + 1 );
+        input.read( (char*)&edges_[0], sizeof(Edge) * edges_.size() );
+        if ( (size_t)input.gcount() != sizeof(Edge) * edges_.size() ) {
+          error_() << "Token DAWG is truncated";
+          clear();
+          return FAILURE;
+        }
+        root_ = root;
+        return SUCCESS;
+      }
+
+      /// Save the DAWG to a stream.
+      Status save(
+          std::ostream& output  ///< Stream to write to
+      ) {
+        char        sizes[2]    = { (char)sizeof(Symbol), (char)sizeof(Link) };
+        Link        count       = num_edges();
+
+        output.write( (const char*)&TOKEN_DAWG_MAGIC, sizeof(TOKEN_DAWG_MAGIC) );
+        output.write( sizes, 2 );
+        output.write( (const char*)&count, sizeof(count) );
+        output.write( (const char*)&root_, sizeof(root_) );
+        output.write( (const char*)&edges_[0], sizeof(Edge) * edges_.size() );
+        if ( output.fail() ) {
+          error_() << "Couldn't write token DAWG";
+          return FAILURE;
+        }
+        return SUCCESS;
+      }
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      std::vector<Edge>     edges_;     ///< Edges, from the null edge on
+      Link                  root_;      ///< First edge of the root node
+      Error                 error_;
+
+      // Every phrase below a node
+      bool collect( Link node, Phrase* phrase, std::vector<Phrase>* results, size_t max_results ) const {
+        if ( node == 0 )
+          return true;
+        for ( Link i = node; i < node + edges_[node - 1].size(); ++i ) {
+          if ( max_results != 0 && results->size() >= max_results )
+            return false;
+          phrase->push_back( edges_[i].symbol() );
+          if ( edges_[i].end_of_phrase() )
+            results->push_back( *phrase );
+          bool more = collect( edges_[i].child(), phrase, results, max_results );
+          phrase->pop_back();
+          if ( !more )
+            return false;
+        }
+        return true;
+      }
+  };
+
+  /// Builds a TokenDAWG from phrases fed in order, comparing symbols as
+  /// numbers and putting a prefix before its extensions. As with Creator,
+  /// each node is finished once no later phrase can add to it, and is
+  /// replaced by an identical node already built if there is one, so the
+  /// result is minimal.
+  template <typename Symbol, typename Link = uint32_t>
+  class TokenCreator {
+    public:
+      typedef TokenEdge<Symbol, Link>   Edge;
+      typedef TokenDAWG<Symbol, Link>   Graph;
+
+      /// Default constructor
+      TokenCreator() { start(); }
+
+      /// Throw away anything added and start a new DAWG.
+      void start() {
+        edges_.assign( 1, Edge() );
+        stack_.clear();
+        previous_.clear();
+        register_.assign( MIN_TOKEN_REGISTER, 0 );
+        num_nodes_      = 0;
+        num_phrases_    = 0;
+      }
+
+      /// Add a phrase. Phrases must be fed in order; a phrase the same as the
+      /// one before it is skipped.
+      Status add_phrase(
+          const Symbol* phrase,     ///< Symbols of the phrase
+          size_t        length      ///< Number of symbols
+      ) {
+        if ( length == 0 ) {
+          error_() << "Phrase " << num_phrases_ << " is empty";
+          return FAILURE;
+        }
+
+        // Find where it leaves the phrase before
+        size_t i = 0;
+        while ( i < length && i < previous_.size() && phrase[i] == previous_[i] )
+          ++i;
+        if ( i == length && i == previous_.size() )
+          return SUCCESS;
+        if ( i == length || (i < previous_.size() && phrase[i] < previous_[i]) ) {
+          error_() << "Phrase " << num_phrases_ << " is out of order at symbol " << i;
+          return FAILURE;
+        }
+
+        // Nothing can be added to the nodes below there now
+        for ( size_t depth = previous_.size(); depth > i + 1; --depth ) {
+          if ( finish_node( depth - 1 ) != SUCCESS )
+            return FAILURE;
+        }
+
+        if ( stack_.size() < length )
+          stack_.resize( length );
+        for ( size_t depth = i; depth < length; ++depth )
+          stack_[depth].push_back( Edge( phrase[depth] ) );
+        stack_[length - 1].back().end_of_phrase( true );
+        previous_.assign( phrase, phrase + length );
+        ++num_phrases_;
+        return SUCCESS;
+      }
+
+      /// Add a phrase.
+      inline Status add_phrase( const std::vector<Symbol>& phrase ) {
+        return add_phrase( phrase.empty() ? NULL : &phrase[0], phrase.size() );
+      }
+
+      /// Finish the last nodes and hand over the DAWG.
+      /// @return   a new DAWG on success, NULL on failure
+      Graph* finish() {
+        for ( size_t depth = previous_.size(); depth > 1; --depth ) {
+          if ( finish_node( depth - 1 ) != SUCCESS )
+            return NULL;
+        }
+        Link root = 0;
+        if ( !previous_.empty() && add_node( &stack_[0], &root ) != SUCCESS )
+          return NULL;
+
+        Graph* graph = new Graph;
+        graph->assign( &edges_, root );
+        start();
+        return graph;
+      }
+
+      /// Number of phrases added since start().
+      inline size_t num_phrases() const { return num_phrases_; }
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      std::vector<Edge>                 edges_;         ///< Finished nodes, from the null edge on
+      std::vector< std::vector<Edge> >  stack_;         ///< Node being built at each depth
+      std::vector<Symbol>               previous_;      ///< Last phrase added
+      std::vector<Link>                 register_;      ///< Hash table of finished nodes' first edges, 0 for empty
+      size_t                            num_nodes_;     ///< Nodes in the register
+      size_t                            num_phrases_;
+      Error                             error_;
+
+      // Hash of a node's edges
+      static size_t hash_node( const Edge* edges, size_t size ) {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for ( size_t i = 0; i < size; ++i ) {
+          hash = (hash ^ (uint64_t)edges[i].symbol()) * 0x100000001B3ULL;
+          hash = (hash ^ (uint64_t)edges[i].size()) * 0x100000001B3ULL;
+        }
+        return (size_t)(hash ^ (hash >> 32));
+      }
+
+      // Look for a node in the register
+      // @return  its first edge, or 0 with the empty slot it would go in
+      Link find_node( const Edge* edges, size_t size, size_t* slot ) const {
+        size_t mask = register_.size() - 1;
+        for ( size_t s = hash_node( edges, size ) & mask; ; s = (s + 1) & mask ) {
+          Link start = register_[s];
+          if ( start == 0 ) {
+            *slot = s;
+            return 0;
+          }
+          if ( edges_[start - 1].size() == size && std::equal( edges, edges + size, &edges_[start] ) )
+            return start;
+        }
+      }
+
+      // Double the register, putting every node back in
+      void grow_register() {
+        std::vector<Link> old( register_.size() * 2, 0 );
+        old.swap( register_ );
+        for ( size_t i = 0; i < old.size(); ++i ) {
+          if ( old[i] != 0 ) {
+            size_t slot = 0;
+            find_node( &edges_[old[i]], edges_[old[i] - 1].size(), &slot );
+            register_[slot] = old[i];
+          }
+        }
+      }
+
+      // Store a node, or find the same node already stored
+      Status add_node( std::vector<Edge>* node, Link* start ) {
+        size_t slot = 0;
+        *start = find_node( &(*node)[0], node->size(), &slot );
+        if ( *start == 0 ) {
+          if ( edges_.size() + 1 + node->size() > (size_t)Edge::max_index() ) {
+            error_() << "DAWG would need more than " << (uint64_t)Edge::max_index() << " edges";
+            return FAILURE;
+          }
+          edges_.push_back( Edge::header( (Link)node->size() ) );
+          *start = (Link)edges_.size();
+          edges_.insert( edges_.end(), node->begin(), node->end() );
+          register_[slot] = *start;
+          if ( ++num_nodes_ * 2 > register_.size() )
+            grow_register();
+        }
+        node->clear();
+        return SUCCESS;
+      }
+
+      // Finish the node at a depth and point its parent edge at it
+      Status finish_node( size_t depth ) {
+        Link start;
+        if ( add_node( &stack_[depth], &start ) != SUCCESS )
+          return FAILURE;
+        stack_[depth - 1].back().child( start );
+        return SUCCESS;
+      }
+  };
+}
+
+#endif /* not _TOKEN_DAWG_HH */
@@ -0,0 +1,114 @@
+// Compare batch lookups with looking words up one at a time.
+//
+// Usage: dawg_batch [-r rounds] dictionary.dawg words.txt
+//
+// Looks up every word in the file, the same word with its last letter
+// changed and the first half of it, in shuffled order, rounds times over:
+// once a word at a time through DAWG::contains_word, which scans each node
+// with find_edge, and once through DAWG::contains_words. Reports the time
+// per lookup of each and which kernel the batch call used, and fails if they
+// ever disagree.
+
+#include "dawg.hh"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace DAWG;
+
+static void usage() {
+  std::cerr << "Usage: dawg_batch [-r rounds] dictionary.dawg words.txt" << std::endl;
+  exit(1);
+}
+
+static double now() {
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The kernel contains_words() picks on this CPU
+static const char* kernel() {
+#if defined(__GNUC__) && defined(__x86_64__)
+  if ( __builtin_cpu_supports("avx512f") )
+    return "AVX-512";
+#endif /* __GNUC__ && __x86_64__ */
+  return "scalar";
+}
+
+int main( int argc, char** argv ) {
+  unsigned      rounds      = 5;
+  int           opt;
+
+  while ( (opt = getopt( argc, argv, "r:" )) != -1 ) {
+    switch ( opt ) {
+      case 'r': rounds      = atoi( optarg ); break;
+      default:  usage();
+    }
+  }
+  if ( optind + 2 != argc || rounds == 0 )
+    usage();
+
+  DAWG::DAWG dawg;
+  if ( dawg.map( argv[optind] ) != SUCCESS ) {
+    std::cerr << "dawg_batch: " << dawg.error() << std::endl;
+    return 1;
+  }
+
+  // Every word, the word with its last letter changed, and its first half
+  std::ifstream             in( argv[optind + 1] );
+  std::vector<std::string>  keys;
+  std::string               word;
+  while ( std::getline( in, word ) ) {
+    if ( word.empty() )
+      continue;
+    keys.push_back( word );
+    keys.push_back( word );
+    keys.back()[word.length() - 1] ^= 1;
+    keys.push_back( word.substr( 0, (word.length() + 1) / 2 ) );
+  }
+  if ( keys.empty() ) {
+    std::cerr << "dawg_batch: no words in " << argv[optind + 1] << std::endl;
+    return 1;
+  }
+  srand( 1 );
+  std::random_shuffle( keys.begin(), keys.end() );
+
+  std::vector<char> expected( keys.size() );
+  size_t            found = 0;
+  double            start = now();
+  for ( unsigned r = 0; r < rounds; ++r ) {
+    for ( size_t i = 0; i < keys.size(); ++i ) {
+      expected[i] = dawg.contains_word( keys[i] );
+      found      += expected[i];
+    }
+  }
+  double serial = now() - start;
+
+  bool*   results     = new bool[keys.size()];
+  size_t  mismatches  = 0;
+  start = now();
+  for ( unsigned r = 0; r < rounds; ++r )
+    dawg.contains_words( &keys[0], keys.size(), results );
+  double batch = now() - start;
+  for ( size_t i = 0; i < keys.size(); ++i )
+    mismatches += results[i] != (bool)expected[i];
+  delete [] results;
+
+  double lookups = (double)rounds * keys.size();
+  std::cout << std::fixed << std::setprecision(1)
+            << "lookups:        " << (size_t)lookups << ", "
+                                  << 100.0 * found / lookups << "% found" << std::endl
+            << "find_edge loop: " << serial * 1e9 / lookups << " ns/lookup" << std::endl
+            << "contains_words: " << batch * 1e9 / lookups << " ns/lookup ("
+                                  << kernel() << ")" << std::endl;
+  if ( mismatches != 0 ) {
+    std::cerr << "dawg_batch: " << mismatches << " lookups disagree" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,114 @@
+// Build a DAWG from a sorted word list, surviving interruption.
+//
+// Usage: dawg_build [-l] [-c checkpoint [-e words]] words.txt output.dawg
+//
+// With -l, words that can't be added (too long, out of order) are skipped
+// and counted rather than stopping the build.
+// With -c, the builder's state is saved to the checkpoint file every -e
+// words (a million by default). If the checkpoint already exists when the
+// build starts, it carries on from there, skipping the words the checkpoint
+// already holds. The checkpoint is removed once the DAWG has been written.
+// A summary of the words added and skipped is printed at the end.
+
+#include "dawg.hh"
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace DAWG;
+
+static void usage() {
+  std::cerr << "Usage: dawg_build [-l] [-c checkpoint [-e words]] words.txt output.dawg" << std::endl;
+  exit(1);
+}
+
+int main( int argc, char** argv ) {
+  const char* checkpoint  = NULL;
+  size_t      every       = 1000000;
+  bool        lenient     = false;
+  int         opt;
+
+  while ( (opt = getopt( argc, argv, "lc:e:" )) != -1 ) {
+    switch ( opt ) {
+      case 'l': lenient     = true;           break;
+      case 'c': checkpoint  = optarg;         break;
+      case 'e': every       = atol( optarg ); break;
+      default:  usage();
+    }
+  }
+  if ( optind + 2 != argc || every == 0 )
+    usage();
+
+  std::ifstream input( argv[optind] );
+  if ( !input.good() ) {
+    std::cerr << "dawg_build: couldn't open " << argv[optind] << std::endl;
+    return 1;
+  }
+
+  Creator     creator;
+  std::string word;
+  creator.set_lenient( lenient );
+  if ( checkpoint != NULL && std::ifstream( checkpoint ).good() ) {
+    if ( creator.resume( checkpoint ) != SUCCESS ) {
+      std::cerr << "dawg_build: " << creator.error() << std::endl;
+      return 1;
+    }
+
+    // Skip what the checkpoint already has, checking it's the same input
+    size_t consumed = creator.num_words();
+    for ( int code = 0; code < NUM_ERROR_CODES; ++code )
+      consumed += creator.num_skipped( (ErrorCode)code );
+    for ( size_t skipped = 0; skipped < consumed; ) {
+      if ( !std::getline( input, word ) ) {
+        std::cerr << "dawg_build: input is shorter than the checkpoint" << std::endl;
+        return 1;
+      }
+      if ( !word.empty() )
+        ++skipped;
+    }
+    if ( word != creator.last_word() ) {
+      std::cerr << "dawg_build: checkpoint ends with \"" << creator.last_word()
+                << "\" but the input has \"" << word << "\" there" << std::endl;
+      return 1;
+    }
+    std::cerr << "dawg_build: resuming after " << creator.num_words() << " words" << std::endl;
+  } else {
+    creator.start();
+  }
+
+  while ( std::getline( input, word ) ) {
+    if ( word.empty() )
+      continue;
+    size_t added = creator.num_words();
+    if ( creator.add_word( word ) != SUCCESS ) {
+      std::cerr << "dawg_build: " << creator.error() << std::endl;
+      return 1;
+    }
+    // Only right after adding a word, so the checkpoint ends with it
+    added = creator.num_words() - added;
+    if ( checkpoint != NULL && added != 0 && creator.num_words() % every == 0
+         && creator.checkpoint( checkpoint ) != SUCCESS ) {
+      std::cerr << "dawg_build: " << creator.error() << std::endl;
+      return 1;
+    }
+  }
+
+  DAWG::DAWG* dawg = creator.finish();
+  if ( dawg == NULL ) {
+    std::cerr << "dawg_build: " << creator.error() << std::endl;
+    return 1;
+  }
+  std::ofstream output( argv[optind + 1], std::ios::binary );
+  if ( !output.good() || dawg->save( output ) != SUCCESS ) {
+    std::cerr << "dawg_build: couldn't write " << argv[optind + 1] << std::endl;
+    return 1;
+  }
+  output.close();
+  if ( checkpoint != NULL )
+    remove( checkpoint );
+  std::cout << creator.report() << std::endl;
+  delete dawg;
+  return 0;
+}
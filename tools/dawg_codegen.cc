@@ -0,0 +1,67 @@
+// Compile a small dictionary into a C++ lookup function.
+//
+// Usage: dawg_codegen [-n function] dictionary.dawg output
+//
+// Writes output.cc, defining
+//
+//     int function( const char* word, size_t length );
+//
+// which returns the word's position in the dictionary or -1, and output.hh
+// declaring it. The function name defaults to the last part of output. To
+// build a dictionary into a program, generate the source as a build step and
+// compile it like any other file, e.g. with make:
+//
+//     keywords.cc keywords.hh: keywords.dawg
+//             dawg_codegen -n match_keyword keywords.dawg keywords
+//
+// dawg_codegen_bench times a generated function against DAWG::contains_word.
+
+#include "dawg.hh"
+#include "codegen.hh"
+#include <fstream>
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace DAWG;
+
+static void usage() {
+  std::cerr << "Usage: dawg_codegen [-n function] dictionary.dawg output" << std::endl;
+  exit(1);
+}
+
+int main( int argc, char** argv ) {
+  std::string   name;
+  int           opt;
+
+  while ( (opt = getopt( argc, argv, "n:" )) != -1 ) {
+    switch ( opt ) {
+      case 'n': name = optarg;  break;
+      default:  usage();
+    }
+  }
+  if ( optind + 2 != argc )
+    usage();
+  std::string output = argv[optind + 1];
+  if ( name.empty() )
+    name = output.substr( output.find_last_of( '/' ) + 1 );
+
+  DAWG::DAWG dawg;
+  if ( dawg.map( argv[optind] ) != SUCCESS ) {
+    std::cerr << "dawg_codegen: " << dawg.error() << std::endl;
+    return 1;
+  }
+
+  Codegen       codegen;
+  std::ofstream source( (output + ".cc").c_str() );
+  if ( !source.good() || codegen.write_source( dawg, name, source ) != SUCCESS ) {
+    std::cerr << "dawg_codegen: " << (source.good() ? codegen.error() : "couldn't write " + output + ".cc") << std::endl;
+    return 1;
+  }
+  std::ofstream header( (output + ".hh").c_str() );
+  if ( !header.good() || codegen.write_header( dawg, name, header ) != SUCCESS ) {
+    std::cerr << "dawg_codegen: " << (header.good() ? codegen.error() : "couldn't write " + output + ".hh") << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Compare a matcher from dawg_codegen with looking words up in the DAWG.
+//
+// Usage: dawg_codegen_bench [-r rounds] dictionary.dawg
+//
+// Built together with the source dawg_codegen writes for the same
+// dictionary, under the name match_word unless MATCHER is defined:
+//
+//     dawg_codegen -n match_word keywords.dawg keywords
+//     c++ -O2 -I. tools/dawg_codegen_bench.cc keywords.cc *.cc -lpthread
+//
+// Makes queries from every word in the dictionary: the word itself, the
+// word with one letter changed, its first half and the word with an s on
+// the end. Checks that the matcher gives each word its position in the
+// dictionary and agrees with DAWG::contains_word on every query, then
+// times both over the queries, rounds times over.
+
+#include "dawg.hh"
+#include "query.hh"
+#include <iomanip>
+#include <iostream>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef MATCHER
+# define MATCHER match_word
+#endif /* not MATCHER */
+
+int MATCHER( const char* word, size_t length );
+
+using namespace DAWG;
+
+static void usage() {
+  std::cerr << "Usage: dawg_codegen_bench [-r rounds] dictionary.dawg" << std::endl;
+  exit(1);
+}
+
+static double now() {
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main( int argc, char** argv ) {
+  unsigned      rounds      = 0;
+  int           opt;
+
+  while ( (opt = getopt( argc, argv, "r:" )) != -1 ) {
+    switch ( opt ) {
+      case 'r': rounds      = atoi( optarg ); break;
+      default:  usage();
+    }
+  }
+  if ( optind + 1 != argc )
+    usage();
+
+  DAWG::DAWG dawg;
+  if ( dawg.map( argv[optind] ) != SUCCESS ) {
+    std::cerr << "dawg_codegen_bench: " << dawg.error() << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string>  queries;
+  WordIterator              words( dawg );
+  int                       position = 0;
+  srand( 1 );
+  for ( ; words.next_word(); ++position ) {
+    const std::string& word = words.word();
+    if ( MATCHER( word.data(), word.length() ) != position ) {
+      std::cerr << "dawg_codegen_bench: \"" << word << "\" should be word " << position << std::endl;
+      return 1;
+    }
+    queries.push_back( word );
+    queries.push_back( word );
+    queries.back()[rand() % word.length()] ^= 1;
+    queries.push_back( word.substr( 0, word.length() / 2 ) );
+    queries.push_back( word + "s" );
+  }
+  if ( queries.empty() ) {
+    std::cerr << "dawg_codegen_bench: no words in " << argv[optind] << std::endl;
+    return 1;
+  }
+
+  size_t mismatches = 0;
+  for ( size_t i = 0; i < queries.size(); ++i )
+    mismatches += (MATCHER( queries[i].data(), queries[i].length() ) >= 0) != dawg.contains_word( queries[i] );
+  if ( mismatches != 0 ) {
+    std::cerr << "dawg_codegen_bench: " << mismatches << " lookups disagree" << std::endl;
+    return 1;
+  }
+
+  // Enough rounds for a couple of million lookups by default
+  if ( rounds == 0 )
+    rounds = 2000000 / queries.size() + 1;
+
+  size_t found = 0;
+  double start = now();
+  for ( unsigned r = 0; r < rounds; ++r ) {
+    for ( size_t i = 0; i < queries.size(); ++i )
+      found += dawg.contains_word( queries[i] );
+  }
+  double generic = now() - start;
+
+  size_t matched = 0;
+  start = now();
+  for ( unsigned r = 0; r < rounds; ++r ) {
+    for ( size_t i = 0; i < queries.size(); ++i )
+      matched += MATCHER( queries[i].data(), queries[i].length() ) >= 0;
+  }
+  double generated = now() - start;
+
+  double lookups = (double)rounds * queries.size();
+  std::cout << std::fixed << std::setprecision(1)
+            << "words:          " << position << std::endl
+            << "lookups:        " << (size_t)lookups << ", "
+                                  << 100.0 * found / lookups << "% found" << std::endl
+            << "contains_word:  " << generic * 1e9 / lookups << " ns/lookup" << std::endl
+            << "generated:      " << generated * 1e9 / lookups << " ns/lookup" << std::endl;
+  return found == matched ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+// Make a patch that turns one version of a dictionary into another.
+//
+// Usage: dawg_diff old.dawg new.dawg output.patch
+//
+// The patch lists the words removed and added, prefix-compressed, so it is
+// about the size of the change rather than of the dictionary. Apply it with
+// dawg_patch.
+
+#include "dawg.hh"
+#include "patch.hh"
+#include <fstream>
+#include <iostream>
+
+using namespace DAWG;
+
+int main( int argc, char** argv ) {
+  if ( argc != 4 ) {
+    std::cerr << "Usage: dawg_diff old.dawg new.dawg output.patch" << std::endl;
+    return 1;
+  }
+
+  DAWG::DAWG from, to;
+  if ( from.map( argv[1] ) != SUCCESS ) {
+    std::cerr << "dawg_diff: " << from.error() << std::endl;
+    return 1;
+  }
+  if ( to.map( argv[2] ) != SUCCESS ) {
+    std::cerr << "dawg_diff: " << to.error() << std::endl;
+    return 1;
+  }
+
+  Patch patch;
+  if ( patch.diff( from, to ) != SUCCESS ) {
+    std::cerr << "dawg_diff: " << patch.error() << std::endl;
+    return 1;
+  }
+  std::ofstream output( argv[3], std::ios::binary );
+  if ( !output.good() || patch.save( output ) != SUCCESS ) {
+    std::cerr << "dawg_diff: couldn't write " << argv[3] << std::endl;
+    return 1;
+  }
+  std::cout << patch.removed().size() << " words removed, "
+            << patch.added().size() << " added" << std::endl;
+  return 0;
+}
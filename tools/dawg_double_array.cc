@@ -0,0 +1,112 @@
+// Convert a dictionary to a double array and compare lookups in the two.
+//
+// Usage: dawg_double_array [-t threads] [-r rounds] dictionary.dawg words.txt
+//
+// Times the conversion, then looks up every word in the file and the same
+// word with its last letter changed, which is usually a miss, rounds times
+// over with DAWG::contains_word and with DoubleArray::contains_word. Reports
+// the time per lookup of each, and fails if they ever disagree.
+
+#include "dawg.hh"
+#include "double_array.hh"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace DAWG;
+
+static void usage() {
+  std::cerr << "Usage: dawg_double_array [-t threads] [-r rounds] dictionary.dawg words.txt" << std::endl;
+  exit(1);
+}
+
+static double now() {
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main( int argc, char** argv ) {
+  unsigned      threads     = 0;
+  unsigned      rounds      = 5;
+  int           opt;
+
+  while ( (opt = getopt( argc, argv, "t:r:" )) != -1 ) {
+    switch ( opt ) {
+      case 't': threads     = atoi( optarg ); break;
+      case 'r': rounds      = atoi( optarg ); break;
+      default:  usage();
+    }
+  }
+  if ( optind + 2 != argc || rounds == 0 )
+    usage();
+
+  DAWG::DAWG dawg;
+  if ( dawg.map( argv[optind] ) != SUCCESS ) {
+    std::cerr << "dawg_double_array: " << dawg.error() << std::endl;
+    return 1;
+  }
+
+  // Every word, then every word with its last letter changed
+  std::ifstream             in( argv[optind + 1] );
+  std::vector<std::string>  keys;
+  std::string               word;
+  while ( std::getline( in, word ) ) {
+    if ( !word.empty() )
+      keys.push_back( word );
+  }
+  if ( keys.empty() ) {
+    std::cerr << "dawg_double_array: no words in " << argv[optind + 1] << std::endl;
+    return 1;
+  }
+  size_t count = keys.size();
+  for ( size_t i = 0; i < count; ++i ) {
+    keys.push_back( keys[i] );
+    keys.back()[keys.back().length() - 1] ^= 1;
+  }
+
+  DoubleArray array;
+  double      start = now();
+  if ( array.build( dawg, threads ) != SUCCESS ) {
+    std::cerr << "dawg_double_array: " << array.error() << std::endl;
+    return 1;
+  }
+  double      built = now() - start;
+
+  std::vector<bool> expected( keys.size() );
+  size_t            found = 0;
+  start = now();
+  for ( unsigned r = 0; r < rounds; ++r ) {
+    for ( size_t i = 0; i < keys.size(); ++i ) {
+      expected[i] = dawg.contains_word( keys[i] );
+      found      += expected[i];
+    }
+  }
+  double linear = now() - start;
+
+  size_t mismatches = 0;
+  start = now();
+  for ( unsigned r = 0; r < rounds; ++r ) {
+    for ( size_t i = 0; i < keys.size(); ++i )
+      mismatches += array.contains_word( keys[i] ) != expected[i];
+  }
+  double indexed = now() - start;
+
+  double lookups = (double)rounds * keys.size();
+  std::cout << std::fixed << std::setprecision(1)
+            << "edges:          " << dawg.num_edges() << std::endl
+            << "units:          " << array.num_units() << std::endl
+            << "build:          " << built * 1e3 << " ms" << std::endl
+            << "lookups:        " << (size_t)lookups << ", "
+                                  << 100.0 * found / lookups << "% found" << std::endl
+            << "DAWG:           " << linear * 1e9 / lookups << " ns/lookup" << std::endl
+            << "DoubleArray:    " << indexed * 1e9 / lookups << " ns/lookup" << std::endl;
+  if ( mismatches != 0 ) {
+    std::cerr << "dawg_double_array: " << mismatches << " lookups disagree" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,60 @@
+// List every pair of words in a dictionary within an edit distance of each
+// other, for finding near-duplicates and confusable words.
+//
+// Usage: dawg_join [-k distance] [-t threads] dictionary.dawg
+//
+// Prints one pair to a line, the earlier word first, then the distance,
+// separated by tabs. The distance defaults to 1. Pairs come out as they are
+// found, in batches from each thread, so lines aren't sorted overall.
+
+#include "dawg.hh"
+#include "join.hh"
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace DAWG;
+
+/// Writes pairs to standard output.
+class PairWriter : public PairSink {
+  public:
+    bool found( const std::string& first, const std::string& second, unsigned distance ) {
+      std::cout << first << '\t' << second << '\t' << distance << '\n';
+      return std::cout.good();
+    }
+};
+
+static void usage() {
+  std::cerr << "Usage: dawg_join [-k distance] [-t threads] dictionary.dawg" << std::endl;
+  exit(1);
+}
+
+int main( int argc, char** argv ) {
+  unsigned      distance    = 1;
+  unsigned      threads     = 0;
+  int           opt;
+
+  while ( (opt = getopt( argc, argv, "k:t:" )) != -1 ) {
+    switch ( opt ) {
+      case 'k': distance    = atoi( optarg ); break;
+      case 't': threads     = atoi( optarg ); break;
+      default:  usage();
+    }
+  }
+  if ( optind + 1 != argc )
+    usage();
+
+  DAWG::DAWG dawg;
+  if ( dawg.map( argv[optind] ) != SUCCESS ) {
+    std::cerr << "dawg_join: " << dawg.error() << std::endl;
+    return 1;
+  }
+
+  std::ios::sync_with_stdio( false );
+  PairWriter    writer;
+  SelfJoin      join( dawg, distance );
+  size_t        pairs       = join.run( &writer, threads );
+  std::cout.flush();
+  std::cerr << pairs << " pairs" << std::endl;
+  return std::cout.good() ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+// Compare the node layouts a DAWG can be given.
+//
+// Usage: dawg_layout [-r rounds] dictionary.dawg words.txt
+//
+// Loads the dictionary as saved, then rearranged by DAWG::align_nodes and by
+// DAWG::cluster_nodes. For each, reports the memory the edges take and how
+// much of it is padding, the nodes that cross a cache line they would fit in,
+// and, walking the lookup path of every word in the file, the cache lines and
+// pages each lookup touches. Then times the lookups, in shuffled order so the
+// walks go out to memory, rounds times over. Weigh the padding against the
+// lines and pages saved.
+
+#include "dawg.hh"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace DAWG;
+
+const size_t    LINE_SIZE   = 64;       /// Size of a cache line in bytes.
+const size_t    PAGE_SIZE   = 4096;     /// Size of a memory page in bytes.
+
+static void usage() {
+  std::cerr << "Usage: dawg_layout [-r rounds] dictionary.dawg words.txt" << std::endl;
+  exit(1);
+}
+
+static double now() {
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Note a block of memory as touched, once
+static void touch( std::vector<size_t>* blocks, size_t block ) {
+  if ( std::find( blocks->begin(), blocks->end(), block ) == blocks->end() )
+    blocks->push_back( block );
+}
+
+// Count the cache lines and pages that looking a word up reads, from the
+// first edge of each node on its path to the edge that matches
+static void walk( const DAWG::DAWG& dawg, const std::string& word, size_t* lines, size_t* pages ) {
+  std::vector<size_t> line_set, page_set;
+  Iterator            node = dawg.begin();
+
+  for ( size_t i = 0; i < word.length() && node != dawg.end(); ++i ) {
+    Iterator edge = node;
+    for (;;) {
+      size_t address = (size_t)&*edge;
+      touch( &line_set, address / LINE_SIZE );
+      touch( &page_set, address / PAGE_SIZE );
+      if ( edge->letter() == word[i] || edge->end_of_node() )
+        break;
+      ++edge;
+    }
+    if ( edge->letter() != word[i] )
+      break;
+    node = edge.child();
+  }
+  *lines += line_set.size();
+  *pages += page_set.size();
+}
+
+int main( int argc, char** argv ) {
+  unsigned      rounds      = 5;
+  int           opt;
+
+  while ( (opt = getopt( argc, argv, "r:" )) != -1 ) {
+    switch ( opt ) {
+      case 'r': rounds      = atoi( optarg ); break;
+      default:  usage();
+    }
+  }
+  if ( optind + 2 != argc || rounds == 0 )
+    usage();
+
+  std::ifstream             in( argv[optind + 1] );
+  std::vector<std::string>  words;
+  std::string               word;
+  while ( std::getline( in, word ) ) {
+    if ( !word.empty() )
+      words.push_back( word );
+  }
+  if ( words.empty() ) {
+    std::cerr << "dawg_layout: no words in " << argv[optind + 1] << std::endl;
+    return 1;
+  }
+  srand( 1 );
+  std::random_shuffle( words.begin(), words.end() );
+
+  const char* names[] = { "as saved", "align_nodes", "cluster_nodes" };
+  std::cout << "layout              KB   padding   split   lines/word   pages/word   ns/lookup" << std::endl;
+  for ( int layout = 0; layout < 3; ++layout ) {
+    DAWG::DAWG  dawg;
+    Status      status = dawg.map( argv[optind] );
+    if ( status == SUCCESS && layout == 1 )
+      status = dawg.align_nodes();
+    if ( status == SUCCESS && layout == 2 )
+      status = dawg.cluster_nodes();
+    if ( status != SUCCESS ) {
+      std::cerr << "dawg_layout: " << dawg.error() << std::endl;
+      return 1;
+    }
+
+    LayoutStats stats;
+    dawg.layout_stats( &stats );
+
+    size_t lines = 0, pages = 0;
+    for ( size_t i = 0; i < words.size(); ++i )
+      walk( dawg, words[i], &lines, &pages );
+
+    size_t found = 0;
+    double start = now();
+    for ( unsigned r = 0; r < rounds; ++r ) {
+      for ( size_t i = 0; i < words.size(); ++i )
+        found += dawg.contains_word( words[i] );
+    }
+    double elapsed = now() - start;
+    if ( found == 0 ) {
+      std::cerr << "dawg_layout: none of the words are in the dictionary" << std::endl;
+      return 1;
+    }
+
+    std::cout << std::left << std::setw(14) << names[layout] << std::right << std::fixed
+              << std::setprecision(0) << std::setw(8) << dawg.num_edges() * sizeof(Edge) / 1024.0
+              << std::setprecision(1) << std::setw(9) << 100.0 * stats.padding / dawg.num_edges() << "%"
+              << std::setw(8) << stats.split_nodes
+              << std::setprecision(2) << std::setw(13) << (double)lines / words.size()
+              << std::setw(13) << (double)pages / words.size()
+              << std::setprecision(1) << std::setw(12) << elapsed * 1e9 / ((double)rounds * words.size())
+              << std::endl;
+  }
+  return 0;
+}
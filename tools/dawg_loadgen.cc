@@ -0,0 +1,240 @@
+// Generate load against dawg_server and report throughput and latency.
+//
+// Usage: dawg_loadgen (-u path | -p port [-H host]) [-c connections]
+//                     [-d depth] [-n requests] [-o exact|prefix|top|fuzzy|typo]
+//                     [-l limit] [-k distance] [-D dictionary] words.txt
+//
+// Each connection keeps depth requests in flight, pipelined, cycling through
+// the words in the file. Latency is measured from writing a request to
+// reading its response.
+
+#include "dawg.hh"
+#include "protocol.hh"
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace DAWG;
+
+const size_t    READ_SIZE   = 65536;    /// Bytes read from a socket at a time.
+
+/// A connection to the server.
+struct Connection {
+  int                   fd;
+  std::string           in;         ///< Bytes received but not yet handled
+  std::string           out;        ///< Bytes waiting to be sent
+  std::deque<double>    started;    ///< Send time of each request in flight
+};
+
+static void usage() {
+  std::cerr << "Usage: dawg_loadgen (-u path | -p port [-H host]) [-c connections] [-d depth]" << std::endl
+            << "                    [-n requests] [-o exact|prefix|top|fuzzy|typo] [-l limit]" << std::endl
+            << "                    [-k distance] [-D dictionary] words.txt" << std::endl;
+  exit(1);
+}
+
+static void die( const char* what ) {
+  std::cerr << "dawg_loadgen: " << what << ": " << strerror(errno) << std::endl;
+  exit(1);
+}
+
+static double now() {
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int connect_to( const char* path, const char* host, int port ) {
+  int fd;
+  if ( path != NULL ) {
+    sockaddr_un addr;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strncpy( addr.sun_path, path, sizeof(addr.sun_path) - 1 );
+    fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd < 0 || connect( fd, (sockaddr*)&addr, sizeof(addr) ) < 0 )
+      die( path );
+  } else {
+    sockaddr_in addr;
+    int         one = 1;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons( port );
+    if ( inet_pton( AF_INET, host, &addr.sin_addr ) != 1 ) {
+      std::cerr << "dawg_loadgen: bad address " << host << std::endl;
+      exit(1);
+    }
+    fd = socket( AF_INET, SOCK_STREAM, 0 );
+    if ( fd < 0 || connect( fd, (sockaddr*)&addr, sizeof(addr) ) < 0 )
+      die( host );
+    setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+  }
+  fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+  return fd;
+}
+
+int main( int argc, char** argv ) {
+  const char*         path        = NULL;
+  const char*         host        = "127.0.0.1";
+  int                 port        = 0;
+  size_t              connections = 16;
+  size_t              depth       = 32;
+  size_t              total       = 1000000;
+  Protocol::Request   request;
+  int                 opt;
+
+  request.id        = 0;
+  request.op        = Protocol::OP_EXACT;
+  request.dict      = 0;
+  request.distance  = 1;
+  request.limit     = 10;
+
+  while ( (opt = getopt( argc, argv, "u:p:H:c:d:n:o:l:k:D:" )) != -1 ) {
+    switch ( opt ) {
+      case 'u': path        = optarg;         break;
+      case 'p': port        = atoi( optarg ); break;
+      case 'H': host        = optarg;         break;
+      case 'c': connections = atol( optarg ); break;
+      case 'd': depth       = atol( optarg ); break;
+      case 'n': total       = atol( optarg ); break;
+      case 'l': request.limit     = atoi( optarg ); break;
+      case 'k': request.distance  = atoi( optarg ); break;
+      case 'D': request.dict      = atoi( optarg ); break;
+      case 'o':
+        if      ( strcmp( optarg, "exact" )  == 0 ) request.op = Protocol::OP_EXACT;
+        else if ( strcmp( optarg, "prefix" ) == 0 ) request.op = Protocol::OP_PREFIX;
+        else if ( strcmp( optarg, "top" )    == 0 ) request.op = Protocol::OP_TOP;
+        else if ( strcmp( optarg, "fuzzy" )  == 0 ) request.op = Protocol::OP_FUZZY;
+        else if ( strcmp( optarg, "typo" )   == 0 ) request.op = Protocol::OP_FUZZY_PREFIX;
+        else usage();
+        break;
+      default:  usage();
+    }
+  }
+  if ( (path == NULL) == (port == 0) || optind + 1 != argc || connections == 0 || depth == 0 )
+    usage();
+
+  std::vector<std::string>  words;
+  std::ifstream             input( argv[optind] );
+  std::string               line;
+  while ( std::getline( input, line ) )
+    if ( !line.empty() )
+      words.push_back( line );
+  if ( words.empty() ) {
+    std::cerr << "dawg_loadgen: no words in " << argv[optind] << std::endl;
+    return 1;
+  }
+
+  int epoll = epoll_create1( 0 );
+  if ( epoll < 0 )
+    die( "epoll_create1" );
+
+  std::vector<Connection>   conns( connections );
+  std::vector<double>       latencies;
+  std::vector<char>         buffer( READ_SIZE );
+  size_t                    sent      = 0;
+  size_t                    received  = 0;
+  size_t                    not_found = 0;
+  size_t                    truncated = 0;
+  double                    start     = now();
+
+  latencies.reserve( total );
+  for ( size_t i = 0; i < connections; ++i ) {
+    epoll_event event;
+    conns[i].fd     = connect_to( path, host, port );
+    event.events    = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.u64  = i;
+    epoll_ctl( epoll, EPOLL_CTL_ADD, conns[i].fd, &event );
+  }
+
+  while ( received < total ) {
+    epoll_event events[64];
+    int count = epoll_wait( epoll, events, 64, -1 );
+    if ( count < 0 && errno != EINTR )
+      die( "epoll_wait" );
+
+    for ( int e = 0; e < count; ++e ) {
+      Connection& c = conns[events[e].data.u64];
+
+      // Read responses
+      for (;;) {
+        ssize_t n = read( c.fd, &buffer[0], buffer.size() );
+        if ( n > 0 ) {
+          c.in.append( &buffer[0], n );
+          continue;
+        }
+        if ( n == 0 ) {
+          std::cerr << "dawg_loadgen: server closed the connection" << std::endl;
+          return 1;
+        }
+        if ( errno != EAGAIN && errno != EWOULDBLOCK )
+          die( "read" );
+        break;
+      }
+      double  t   = now();
+      size_t  pos = 0;
+      for (;;) {
+        size_t size = Protocol::frame_size( c.in.data() + pos, c.in.length() - pos );
+        if ( size == 0 || size > c.in.length() - pos )
+          break;
+        Protocol::Response response;
+        if ( Protocol::decode( c.in.data() + pos, size, &response ) != SUCCESS
+             || response.status == Protocol::STATUS_BAD_REQUEST ) {
+          std::cerr << "dawg_loadgen: bad response" << std::endl;
+          return 1;
+        }
+        if ( response.status == Protocol::STATUS_NOT_FOUND )
+          ++not_found;
+        if ( response.status == Protocol::STATUS_TRUNCATED )
+          ++truncated;
+        latencies.push_back( t - c.started.front() );
+        c.started.pop_front();
+        ++received;
+        pos += size;
+      }
+      c.in.erase( 0, pos );
+
+      // Top up the pipeline
+      t = now();
+      while ( c.started.size() < depth && sent < total ) {
+        request.id  = sent;
+        request.key = words[sent % words.size()];
+        Protocol::encode( request, &c.out );
+        c.started.push_back( t );
+        ++sent;
+      }
+      while ( !c.out.empty() ) {
+        ssize_t n = write( c.fd, c.out.data(), c.out.length() );
+        if ( n < 0 ) {
+          if ( errno == EAGAIN || errno == EWOULDBLOCK )
+            break;
+          die( "write" );
+        }
+        c.out.erase( 0, n );
+      }
+    }
+  }
+
+  double elapsed = now() - start;
+  std::sort( latencies.begin(), latencies.end() );
+  std::cout << received << " requests in " << elapsed << " s: "
+            << (size_t)(received / elapsed) << " per second, "
+            << not_found << " not found, " << truncated << " truncated" << std::endl
+            << "latency us: p50 " << latencies[latencies.size() / 2] * 1e6
+            << " p99 " << latencies[latencies.size() * 99 / 100] * 1e6
+            << " max " << latencies.back() * 1e6 << std::endl;
+  return 0;
+}
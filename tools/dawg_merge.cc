@@ -0,0 +1,95 @@
+// Merge saved DAWGs into one holding every word in any of them.
+//
+// Usage: dawg_merge output.dawg input.dawg...
+//
+// The inputs are mapped rather than read, and walked together in order with
+// one WordIterator each, so the union goes straight into a Creator. Memory
+// use is the output graph, one stack per input, and whichever pages of the
+// inputs the walk currently needs.
+
+#include "dawg.hh"
+#include "query.hh"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+using namespace DAWG;
+
+/// The input whose current word comes first at the top of a heap.
+struct Later {
+  const std::vector<WordIterator*>& inputs;
+
+  Later( const std::vector<WordIterator*>& i ) : inputs(i) {}
+
+  bool operator()( size_t a, size_t b ) const {
+    return compare_words( inputs[a]->word(), inputs[b]->word() ) > 0;
+  }
+};
+
+int main( int argc, char** argv ) {
+  if ( argc < 3 ) {
+    std::cerr << "Usage: dawg_merge output.dawg input.dawg..." << std::endl;
+    return 1;
+  }
+
+  std::vector<DAWG::DAWG*>      dawgs( argc - 2 );
+  std::vector<WordIterator*>    inputs( argc - 2 );
+  std::vector<size_t>           heap;
+  Later                         later( inputs );
+
+  for ( int i = 2; i < argc; ++i ) {
+    DAWG::DAWG* dawg = new DAWG::DAWG;
+    if ( dawg->map( argv[i] ) != SUCCESS ) {
+      std::cerr << "dawg_merge: " << dawg->error() << std::endl;
+      return 1;
+    }
+    dawgs[i - 2]  = dawg;
+    inputs[i - 2] = new WordIterator( *dawg );
+    if ( inputs[i - 2]->next_word() )
+      heap.push_back( i - 2 );
+  }
+  std::make_heap( heap.begin(), heap.end(), later );
+
+  Creator     creator;
+  std::string last;
+  size_t      words = 0;
+  creator.start();
+  while ( !heap.empty() ) {
+    std::pop_heap( heap.begin(), heap.end(), later );
+    WordIterator* input = inputs[heap.back()];
+
+    // Words in several inputs come out together; keep the first
+    if ( words == 0 || input->word() != last ) {
+      if ( creator.add_word( input->word() ) != SUCCESS ) {
+        std::cerr << "dawg_merge: " << creator.error() << std::endl;
+        return 1;
+      }
+      last = input->word();
+      ++words;
+    }
+
+    if ( input->next_word() )
+      std::push_heap( heap.begin(), heap.end(), later );
+    else
+      heap.pop_back();
+  }
+
+  DAWG::DAWG* merged = creator.finish();
+  if ( merged == NULL ) {
+    std::cerr << "dawg_merge: " << creator.error() << std::endl;
+    return 1;
+  }
+  std::ofstream output( argv[1], std::ios::binary );
+  if ( !output.good() || merged->save( output ) != SUCCESS ) {
+    std::cerr << "dawg_merge: couldn't write " << argv[1] << std::endl;
+    return 1;
+  }
+  std::cout << words << " words from " << dawgs.size() << " inputs" << std::endl;
+
+  for ( size_t i = 0; i < dawgs.size(); ++i ) {
+    delete inputs[i];
+    delete dawgs[i];
+  }
+  delete merged;
+  return 0;
+}
@@ -0,0 +1,114 @@
+// Measure the cost of looking words up in a DAWG on another NUMA node.
+//
+// Usage: dawg_numa [-r rounds] dictionary.dawg words.txt
+//
+// Loads one copy of the dictionary per node with Replicas, then, pinned to
+// each node's CPUs in turn, looks up every word in the file against every
+// copy, in shuffled order so the walks go out to memory. Prints the time per
+// lookup from each node to each copy; the diagonal is what Replicas::local()
+// gives a thread, the rest is what sharing one copy would cost.
+
+#include "dawg.hh"
+#include "replicas.hh"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace DAWG;
+
+static void usage() {
+  std::cerr << "Usage: dawg_numa [-r rounds] dictionary.dawg words.txt" << std::endl;
+  exit(1);
+}
+
+static double now() {
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Keep the calling thread on some CPUs
+static bool pin( const std::vector<Index>& cpus ) {
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  for ( size_t i = 0; i < cpus.size(); ++i )
+    CPU_SET( cpus[i], &set );
+  return sched_setaffinity( 0, sizeof(set), &set ) == 0;
+}
+
+int main( int argc, char** argv ) {
+  unsigned      rounds      = 5;
+  int           opt;
+
+  while ( (opt = getopt( argc, argv, "r:" )) != -1 ) {
+    switch ( opt ) {
+      case 'r': rounds      = atoi( optarg ); break;
+      default:  usage();
+    }
+  }
+  if ( optind + 2 != argc || rounds == 0 )
+    usage();
+
+  std::ifstream dictionary( argv[optind], std::ios::binary );
+  Replicas      replicas;
+  if ( !dictionary || replicas.load( dictionary ) != SUCCESS ) {
+    std::cerr << "dawg_numa: " << (dictionary ? replicas.error() : strerror(errno)) << std::endl;
+    return 1;
+  }
+
+  std::ifstream             in( argv[optind + 1] );
+  std::vector<std::string>  words;
+  std::string               word;
+  while ( std::getline( in, word ) ) {
+    if ( !word.empty() )
+      words.push_back( word );
+  }
+  if ( words.empty() ) {
+    std::cerr << "dawg_numa: no words in " << argv[optind + 1] << std::endl;
+    return 1;
+  }
+  srand( 1 );
+  std::random_shuffle( words.begin(), words.end() );
+
+  std::cout << std::fixed << std::setprecision(1) << "ns/lookup    ";
+  for ( Index to = 0; to < replicas.num_replicas(); ++to )
+    std::cout << "   node " << std::setw(2) << replicas.node(to);
+  std::cout << std::endl;
+
+  size_t found = 0;
+  for ( Index from = 0; from < replicas.num_replicas(); ++from ) {
+    if ( replicas.cpus(from).empty() )
+      continue;
+    if ( !pin( replicas.cpus(from) ) ) {
+      std::cerr << "dawg_numa: couldn't run on node " << replicas.node(from) << ": " << strerror(errno) << std::endl;
+      return 1;
+    }
+    if ( &replicas.local() != &replicas.replica(from) )
+      std::cerr << "dawg_numa: node " << replicas.node(from) << " isn't given its own copy" << std::endl;
+
+    std::cout << "from node " << std::setw(2) << replicas.node(from) << " ";
+    for ( Index to = 0; to < replicas.num_replicas(); ++to ) {
+      const DAWG::DAWG& dawg  = replicas.replica(to);
+      double            start = now();
+      for ( unsigned r = 0; r < rounds; ++r ) {
+        for ( size_t i = 0; i < words.size(); ++i )
+          found += dawg.contains_word( words[i] );
+      }
+      std::cout << std::setw(10) << (now() - start) * 1e9 / ((double)rounds * words.size());
+    }
+    std::cout << std::endl;
+  }
+
+  if ( found == 0 ) {
+    std::cerr << "dawg_numa: none of the words are in the dictionary" << std::endl;
+    return 1;
+  }
+  return 0;
+}
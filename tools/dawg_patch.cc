@@ -0,0 +1,47 @@
+// Apply a patch made by dawg_diff.
+//
+// Usage: dawg_patch old.dawg input.patch output.dawg
+//
+// The output is the same, byte for byte, as building the new version from
+// its words; the patch carries a fingerprint of it which is checked before
+// anything is written.
+
+#include "dawg.hh"
+#include "patch.hh"
+#include <fstream>
+#include <iostream>
+
+using namespace DAWG;
+
+int main( int argc, char** argv ) {
+  if ( argc != 4 ) {
+    std::cerr << "Usage: dawg_patch old.dawg input.patch output.dawg" << std::endl;
+    return 1;
+  }
+
+  DAWG::DAWG from;
+  if ( from.map( argv[1] ) != SUCCESS ) {
+    std::cerr << "dawg_patch: " << from.error() << std::endl;
+    return 1;
+  }
+
+  Patch         patch;
+  std::ifstream input( argv[2], std::ios::binary );
+  if ( !input.good() || patch.load( input ) != SUCCESS ) {
+    std::cerr << "dawg_patch: " << argv[2] << ": " << patch.error() << std::endl;
+    return 1;
+  }
+
+  DAWG::DAWG* to = patch.apply( from );
+  if ( to == NULL ) {
+    std::cerr << "dawg_patch: " << patch.error() << std::endl;
+    return 1;
+  }
+  std::ofstream output( argv[3], std::ios::binary );
+  if ( !output.good() || to->save( output ) != SUCCESS ) {
+    std::cerr << "dawg_patch: couldn't write " << argv[3] << std::endl;
+    return 1;
+  }
+  delete to;
+  return 0;
+}
@@ -0,0 +1,403 @@
+// Serve queries against saved DAWGs over a Unix or TCP socket.
+//
+// Usage: dawg_server [-w workers] [-s steps] [-t milliseconds] [-c megabytes]
+//                    (-u path | -p port) dictionary.dawg...
+//
+// Dictionaries are numbered in the order given. One worker process runs per
+// CPU by default, each pinned to its own core with its own epoll loop; they
+// share the listening socket and the dictionaries' memory. The complete
+// requests read from a connection in one go are answered in batches, with the
+// queries interleaved by a Scheduler, and the responses written back together.
+// A client that sends faster than it reads stops being read from once
+// MAX_PENDING bytes of responses are waiting for it.
+// To keep tail latency down, -s limits the edges each query may visit and -t
+// the time a batch may take; queries cut short answer with what they found
+// so far and STATUS_TRUNCATED.
+//
+// With -c, each worker keeps the responses to recent requests in a
+// ResultCache of that size, keyed by the request and the dictionary's
+// fingerprint. Truncated responses aren't kept. Sending a worker SIGUSR1
+// makes it print its cache's hit rate.
+
+#include "dawg.hh"
+#include "cache.hh"
+#include "protocol.hh"
+#include <fstream>
+#include <iostream>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+using namespace DAWG;
+
+const int       MAX_EVENTS  = 256;      /// Events handled per epoll_wait.
+const size_t    READ_SIZE   = 65536;    /// Bytes read from a socket at a time.
+const size_t    MAX_READS   = 16;       /// Reads from one connection per wakeup.
+const size_t    MAX_BATCH   = 64;       /// Requests answered together.
+const size_t    MAX_PENDING = 1 << 20;  /// Unsent response bytes above which a connection isn't read.
+const int       BACKLOG     = 1024;     /// Pending connections allowed.
+
+/// A client connection.
+struct Connection {
+  int           fd;
+  std::string   in;         ///< Bytes received but not yet handled
+  std::string   out;        ///< Bytes waiting to be sent
+  size_t        sent;       ///< Bytes of out already sent
+  uint32_t      events;     ///< Events we've asked epoll for
+  bool          closing;    ///< No more input; hang up once out is sent
+};
+
+static std::vector<DAWG::DAWG*> dictionaries;
+static size_t                   max_steps   = 0;    ///< Steps each query may take, 0 for no limit
+static double                   timeout     = 0;    ///< Seconds each batch may take, 0 for no limit
+static std::vector<uint64_t>    versions;           ///< Fingerprint of each dictionary
+static size_t                   cache_size  = 0;    ///< Bytes of each worker's cache, 0 for none
+static ResultCache*             cache       = NULL;
+static volatile sig_atomic_t    report      = 0;    ///< Set by SIGUSR1 to ask for the cache's counts
+
+static void usage() {
+  std::cerr << "Usage: dawg_server [-w workers] [-s steps] [-t milliseconds] [-c megabytes]" << std::endl
+            << "                   (-u path | -p port) dictionary.dawg..." << std::endl;
+  exit(1);
+}
+
+static void die( const char* what ) {
+  std::cerr << "dawg_server: " << what << ": " << strerror(errno) << std::endl;
+  exit(1);
+}
+
+static void set_nonblocking( int fd ) {
+  fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+}
+
+static int listen_unix( const char* path ) {
+  sockaddr_un addr;
+  memset( &addr, 0, sizeof(addr) );
+  addr.sun_family = AF_UNIX;
+  strncpy( addr.sun_path, path, sizeof(addr.sun_path) - 1 );
+  unlink( path );
+
+  int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+  if ( fd < 0 )
+    die( "socket" );
+  if ( bind( fd, (sockaddr*)&addr, sizeof(addr) ) < 0 )
+    die( path );
+  return fd;
+}
+
+static int listen_tcp( int port ) {
+  sockaddr_in addr;
+  memset( &addr, 0, sizeof(addr) );
+  addr.sin_family       = AF_INET;
+  addr.sin_addr.s_addr  = htonl( INADDR_ANY );
+  addr.sin_port         = htons( port );
+
+  int fd  = socket( AF_INET, SOCK_STREAM, 0 );
+  int one = 1;
+  if ( fd < 0 )
+    die( "socket" );
+  setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one) );
+  if ( bind( fd, (sockaddr*)&addr, sizeof(addr) ) < 0 )
+    die( "bind" );
+  return fd;
+}
+
+// Answer up to MAX_BATCH complete requests from a connection's input.
+// @return  false if the client sent something we can't parse
+static bool process( Connection* c ) {
+  std::vector<Protocol::Request>  requests;
+  std::vector<Query*>             queries;
+  std::vector<std::string>        keys;       ///< Cache key of each request, empty if not cached
+  std::vector<Protocol::Response> hits;       ///< Response found in the cache, if any
+  std::vector<bool>               hit;
+  Scheduler                       scheduler;
+  Protocol::Response              response;
+  Budget                          budget;
+  size_t                          pos = 0;
+  bool                            ok  = true;
+
+  budget.max_steps = max_steps;
+  if ( timeout != 0 )
+    budget.set_timeout( timeout );
+
+  while ( requests.size() < MAX_BATCH ) {
+    size_t size = Protocol::frame_size( c->in.data() + pos, c->in.length() - pos );
+    if ( size > Protocol::MAX_REQUEST ) {
+      ok = false;
+      break;
+    }
+    if ( size == 0 || size > c->in.length() - pos )
+      break;
+
+    Protocol::Request request;
+    if ( Protocol::decode( c->in.data() + pos, size, &request ) != SUCCESS ) {
+      ok = false;
+      break;
+    }
+    Query*      query = NULL;
+    std::string key;
+    response.id = request.id;
+    hit.push_back( false );
+    if ( request.dict < dictionaries.size() ) {
+      if ( cache != NULL ) {
+        key = Protocol::cache_key( request, versions[request.dict] );
+        hit.back() = cache->find( key, &response.status, &response.words );
+      }
+      if ( !hit.back() )
+        query = Protocol::make_query( *dictionaries[request.dict], request );
+    }
+    if ( query != NULL ) {
+      query->set_budget( budget );
+      scheduler.add( query );
+    }
+    requests.push_back( request );
+    queries.push_back( query );
+    keys.push_back( query != NULL ? key : std::string() );
+    hits.push_back( hit.back() ? response : Protocol::Response() );
+    pos += size;
+  }
+  c->in.erase( 0, pos );
+
+  scheduler.run();
+  for ( size_t i = 0; i < requests.size(); ++i ) {
+    if ( hit[i] ) {
+      Protocol::encode( hits[i], &c->out );
+      continue;
+    }
+    Protocol::make_response( requests[i], queries[i], &response );
+    if ( !keys[i].empty() && response.status != Protocol::STATUS_TRUNCATED )
+      cache->insert( keys[i], response.status, response.words );
+    Protocol::encode( response, &c->out );
+    delete queries[i];
+  }
+  return ok;
+}
+
+// Whether a connection has room for more responses
+static inline bool has_room( const Connection* c ) {
+  return c->out.length() - c->sent < MAX_PENDING;
+}
+
+// Whether a connection's input holds a complete request
+static inline bool has_request( const Connection* c ) {
+  size_t size = Protocol::frame_size( c->in.data(), c->in.length() );
+  return size != 0 && size <= c->in.length();
+}
+
+// Send as much pending output as the socket will take
+// @return  false if the connection failed
+static bool flush( int epoll, Connection* c ) {
+  while ( c->sent < c->out.length() ) {
+    ssize_t n = write( c->fd, c->out.data() + c->sent, c->out.length() - c->sent );
+    if ( n < 0 ) {
+      if ( errno == EAGAIN || errno == EWOULDBLOCK )
+        break;
+      return false;
+    }
+    c->sent += n;
+  }
+  if ( c->sent == c->out.length() ) {
+    c->out.clear();
+    c->sent = 0;
+  }
+
+  // Only ask to hear about writability while there's something to write,
+  // and about input while we still want it and have room to answer it
+  uint32_t events = (c->closing || !has_room( c ) ? 0u : (uint32_t)EPOLLIN)
+                  | (c->out.empty() ? 0u : (uint32_t)EPOLLOUT);
+  if ( events != c->events ) {
+    epoll_event event;
+    event.events    = events;
+    event.data.ptr  = c;
+    epoll_ctl( epoll, EPOLL_CTL_MOD, c->fd, &event );
+    c->events = events;
+  }
+  return true;
+}
+
+static void disconnect( Connection* c ) {
+  close( c->fd );
+  delete c;
+}
+
+static void on_usr1( int ) {
+  report = 1;
+}
+
+// Print a worker's cache counts
+static void report_cache( int worker ) {
+  ResultCache::Stats stats;
+  cache->stats( &stats );
+  std::cerr << "dawg_server: worker " << worker << ": " << stats.hits << " hits, "
+            << stats.misses << " misses (" << stats.hit_rate() * 100 << "% hit), "
+            << stats.entries << " entries in " << stats.bytes << " bytes, "
+            << stats.evictions << " evicted" << std::endl;
+}
+
+// Event loop for one worker
+static void serve( int listener, int worker ) {
+  // Keep to one core
+  long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+  if ( cpus > 0 ) {
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    CPU_SET( worker % cpus, &set );
+    sched_setaffinity( 0, sizeof(set), &set );
+  }
+
+  int epoll = epoll_create1( 0 );
+  if ( epoll < 0 )
+    die( "epoll_create1" );
+
+  // Only wake one worker per new connection
+  epoll_event event;
+  event.events    = EPOLLIN;
+#ifdef EPOLLEXCLUSIVE
+  event.events   |= EPOLLEXCLUSIVE;
+#endif /* EPOLLEXCLUSIVE */
+  event.data.ptr  = NULL;
+  if ( epoll_ctl( epoll, EPOLL_CTL_ADD, listener, &event ) < 0 )
+    die( "epoll_ctl" );
+
+  if ( cache_size != 0 )
+    cache = new ResultCache( cache_size );
+
+  std::vector<char> buffer( READ_SIZE );
+  epoll_event       events[MAX_EVENTS];
+  for (;;) {
+    int count = epoll_wait( epoll, events, MAX_EVENTS, -1 );
+    if ( count < 0 && errno != EINTR )
+      die( "epoll_wait" );
+    if ( report ) {
+      report = 0;
+      if ( cache != NULL )
+        report_cache( worker );
+    }
+
+    for ( int e = 0; e < count; ++e ) {
+      // New connections
+      if ( events[e].data.ptr == NULL ) {
+        int fd;
+        while ( (fd = accept( listener, NULL, NULL )) >= 0 ) {
+          int one = 1;
+          set_nonblocking( fd );
+          setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+
+          Connection* c = new Connection;
+          c->fd       = fd;
+          c->sent     = 0;
+          c->events   = EPOLLIN;
+          c->closing  = false;
+          event.events    = EPOLLIN;
+          event.data.ptr  = c;
+          epoll_ctl( epoll, EPOLL_CTL_ADD, fd, &event );
+        }
+        continue;
+      }
+
+      Connection* c     = (Connection*)events[e].data.ptr;
+      bool        alive = true;
+
+      if ( !c->closing && has_room( c ) && (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) ) {
+        // Take what's available. Reads stop after MAX_READS so a fast client
+        // can't make us buffer without bound; epoll wakes us again for the
+        // rest.
+        for ( size_t reads = 0; reads < MAX_READS; ++reads ) {
+          ssize_t n = read( c->fd, &buffer[0], buffer.size() );
+          if ( n > 0 ) {
+            c->in.append( &buffer[0], n );
+            continue;
+          }
+          if ( n == 0 )
+            c->closing = true;
+          else if ( errno != EAGAIN && errno != EWOULDBLOCK )
+            alive = false;
+          break;
+        }
+      }
+      // Answer what we got, even from a client that has finished sending,
+      // while there's room for the responses. Answer what came before anything
+      // we can't parse, then stop reading. Go round again only while the
+      // socket takes everything, so requests left waiting for room are picked
+      // up when the output drains.
+      while ( alive ) {
+        if ( !c->in.empty() && has_room( c ) && !process( c ) ) {
+          c->in.clear();
+          c->closing = true;
+        }
+        alive = flush( epoll, c );
+        if ( !c->out.empty() || !has_request( c ) )
+          break;
+      }
+      // Hang up once everything has gone out
+      if ( !alive || (c->closing && c->out.empty()) )
+        disconnect( c );
+    }
+  }
+}
+
+int main( int argc, char** argv ) {
+  const char* path    = NULL;
+  int         port    = 0;
+  long        workers = sysconf( _SC_NPROCESSORS_ONLN );
+  int         opt;
+
+  while ( (opt = getopt( argc, argv, "u:p:w:s:t:c:" )) != -1 ) {
+    switch ( opt ) {
+      case 'u': path        = optarg;                       break;
+      case 'p': port        = atoi( optarg );               break;
+      case 'w': workers     = atol( optarg );               break;
+      case 's': max_steps   = atol( optarg );               break;
+      case 't': timeout     = atof( optarg ) / 1e3;         break;
+      case 'c': cache_size  = (size_t)atol( optarg ) << 20; break;
+      default:  usage();
+    }
+  }
+  if ( (path == NULL) == (port == 0) || optind == argc || workers < 1 )
+    usage();
+
+  // Load dictionaries before forking so workers share their memory
+  for ( int i = optind; i < argc; ++i ) {
+    std::ifstream   input( argv[i], std::ios::binary );
+    DAWG::DAWG*     dawg = new DAWG::DAWG;
+    if ( !input.good() ) {
+      std::cerr << "dawg_server: " << argv[i] << ": " << strerror(errno) << std::endl;
+      return 1;
+    }
+    if ( dawg->load( input ) != SUCCESS ) {
+      std::cerr << "dawg_server: " << argv[i] << ": " << dawg->error() << std::endl;
+      return 1;
+    }
+    dictionaries.push_back( dawg );
+    versions.push_back( dawg->fingerprint() );
+  }
+
+  int listener = path != NULL ? listen_unix( path ) : listen_tcp( port );
+  set_nonblocking( listener );
+  if ( listen( listener, BACKLOG ) < 0 )
+    die( "listen" );
+  signal( SIGPIPE, SIG_IGN );
+  signal( SIGUSR1, on_usr1 );
+
+  for ( long w = 1; w < workers; ++w ) {
+    pid_t pid = fork();
+    if ( pid < 0 )
+      die( "fork" );
+    if ( pid == 0 ) {
+      serve( listener, w );
+      return 0;
+    }
+  }
+  serve( listener, 0 );
+  return 0;
+}
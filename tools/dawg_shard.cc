@@ -0,0 +1,175 @@
+// Split a dictionary into prefix-range shards.
+//
+// Usage: dawg_shard -n shards (-d dictionary.dawg | -w words.txt) output
+//
+// Writes output.0.dawg to output.N-1.dawg, each a standalone DAWG holding one
+// contiguous range of words, and output.routes, the RoutingTable a Router
+// needs to find them. Shards get as near to the same number of words as
+// possible. A word list must already be sorted the way Creator wants it.
+
+#include "dawg.hh"
+#include "query.hh"
+#include "router.hh"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace DAWG;
+
+/// Words from a saved DAWG or a sorted word list, in order.
+class WordSource {
+  public:
+    WordSource() : words_(NULL) {}
+    ~WordSource() { delete words_; }
+
+    /// Open a DAWG.
+    bool open_dawg( const char* path ) {
+      std::ifstream input( path, std::ios::binary );
+      if ( !input.good() || dawg_.load( input ) != SUCCESS ) {
+        std::cerr << "dawg_shard: " << path << ": " << dawg_.error() << std::endl;
+        return false;
+      }
+      return rewind();
+    }
+
+    /// Open a word list.
+    bool open_list( const char* path ) {
+      path_ = path;
+      return rewind();
+    }
+
+    /// Start again from the first word.
+    bool rewind() {
+      if ( path_.empty() ) {
+        delete words_;
+        words_ = new WordIterator( dawg_ );
+        return true;
+      }
+      list_.close();
+      list_.clear();
+      list_.open( path_.c_str() );
+      if ( !list_.good() ) {
+        std::cerr << "dawg_shard: couldn't open " << path_ << std::endl;
+        return false;
+      }
+      return true;
+    }
+
+    /// Get the next word.
+    bool next( std::string* word ) {
+      if ( words_ != NULL ) {
+        if ( !words_->next_word() )
+          return false;
+        *word = words_->word();
+        return true;
+      }
+      while ( std::getline( list_, *word ) ) {
+        if ( !word->empty() )
+          return true;
+      }
+      return false;
+    }
+
+  private:
+    DAWG::DAWG      dawg_;
+    WordIterator*   words_;
+    std::string     path_;
+    std::ifstream   list_;
+};
+
+static void usage() {
+  std::cerr << "Usage: dawg_shard -n shards (-d dictionary.dawg | -w words.txt) output" << std::endl;
+  exit(1);
+}
+
+// Finish a shard and save it
+static bool save_shard( Creator* creator, const std::string& output, size_t shard ) {
+  DAWG::DAWG* dawg = creator->finish();
+  if ( dawg == NULL ) {
+    std::cerr << "dawg_shard: shard " << shard << ": " << creator->error() << std::endl;
+    return false;
+  }
+
+  std::ostringstream path;
+  path << output << "." << shard << ".dawg";
+  std::ofstream out( path.str().c_str(), std::ios::binary );
+  bool ok = out.good() && dawg->save( out ) == SUCCESS;
+  if ( !ok )
+    std::cerr << "dawg_shard: couldn't write " << path.str() << std::endl;
+  delete dawg;
+  return ok;
+}
+
+int main( int argc, char** argv ) {
+  const char* dawg_path = NULL;
+  const char* list_path = NULL;
+  size_t      shards    = 0;
+  int         opt;
+
+  while ( (opt = getopt( argc, argv, "n:d:w:" )) != -1 ) {
+    switch ( opt ) {
+      case 'n': shards    = atol( optarg ); break;
+      case 'd': dawg_path = optarg;         break;
+      case 'w': list_path = optarg;         break;
+      default:  usage();
+    }
+  }
+  if ( shards == 0 || (dawg_path == NULL) == (list_path == NULL) || optind + 1 != argc )
+    usage();
+  std::string output = argv[optind];
+
+  WordSource source;
+  if ( !(dawg_path != NULL ? source.open_dawg( dawg_path ) : source.open_list( list_path )) )
+    return 1;
+
+  // Count first so the split can be even
+  std::string word, previous;
+  size_t      total = 0;
+  while ( source.next( &word ) )
+    ++total;
+  if ( total < shards ) {
+    std::cerr << "dawg_shard: only " << total << " words for " << shards << " shards" << std::endl;
+    return 1;
+  }
+  if ( !source.rewind() )
+    return 1;
+
+  RoutingTable  routes;
+  Creator*      creator = NULL;
+  size_t        shard   = 0;
+  for ( size_t i = 0; source.next( &word ); ++i ) {
+    // Shard s holds words total * s / shards up to total * (s + 1) / shards
+    if ( creator == NULL || i == total * (shard + 1) / shards ) {
+      if ( creator != NULL ) {
+        if ( !save_shard( creator, output, shard++ ) )
+          return 1;
+        delete creator;
+      }
+      if ( routes.add( word, previous ) != SUCCESS ) {
+        std::cerr << "dawg_shard: " << routes.error() << std::endl;
+        return 1;
+      }
+      creator = new Creator;
+      creator->start();
+    }
+    if ( creator->add_word( word ) != SUCCESS ) {
+      std::cerr << "dawg_shard: " << creator->error() << std::endl;
+      return 1;
+    }
+    previous = word;
+  }
+  if ( !save_shard( creator, output, shard ) )
+    return 1;
+  delete creator;
+
+  std::string   path = output + ".routes";
+  std::ofstream out( path.c_str(), std::ios::binary );
+  if ( !out.good() || routes.save( out ) != SUCCESS ) {
+    std::cerr << "dawg_shard: couldn't write " << path << std::endl;
+    return 1;
+  }
+  std::cout << total << " words in " << shards << " shards" << std::endl;
+  return 0;
+}
@@ -0,0 +1,190 @@
+// Compare ways of finding the words within a few edits of a word.
+//
+// Usage: dawg_spelling [-k distance] [-n queries] [-c queries] [-t threads]
+//                      dictionary.dawg words.txt
+//
+// Builds a SpellingIndex of the dictionary, then makes queries from random
+// words of the file with up to distance + 1 random edits. Looks each up with
+// the index and with a FuzzyQuery; the first -c of them are also looked up
+// by making every string within distance edits and checking each with
+// DAWG::contains_word, which is slow. Reports the memory each way needs and
+// the queries it answers per second, and fails if any two ever disagree.
+
+#include "dawg.hh"
+#include "query.hh"
+#include "spelling.hh"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace DAWG;
+
+static void usage() {
+  std::cerr << "Usage: dawg_spelling [-k distance] [-n queries] [-c queries] [-t threads]" << std::endl
+            << "                     dictionary.dawg words.txt" << std::endl;
+  exit(1);
+}
+
+static double now() {
+  timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Add every string one edit from word to edits
+static void add_edits( const std::string& word, const std::string& letters, std::set<std::string>* edits ) {
+  for ( size_t i = 0; i <= word.length(); ++i ) {
+    if ( i < word.length() )
+      edits->insert( word.substr( 0, i ) + word.substr( i + 1 ) );
+    for ( size_t l = 0; l < letters.length(); ++l ) {
+      edits->insert( word.substr( 0, i ) + letters[l] + word.substr( i ) );
+      if ( i < word.length() && letters[l] != word[i] )
+        edits->insert( word.substr( 0, i ) + letters[l] + word.substr( i + 1 ) );
+    }
+  }
+}
+
+// Find the words within distance edits by trying every string that close
+static void candidates( const DAWG::DAWG& dawg, const std::string& word, unsigned distance,
+                        const std::string& letters, std::vector<std::string>* results ) {
+  std::set<std::string> reached;
+  std::set<std::string> edits;
+  reached.insert( word );
+  for ( unsigned d = 0; d < distance; ++d ) {
+    edits.clear();
+    for ( std::set<std::string>::const_iterator i = reached.begin(); i != reached.end(); ++i )
+      add_edits( *i, letters, &edits );
+    reached.insert( edits.begin(), edits.end() );
+  }
+  results->clear();
+  for ( std::set<std::string>::const_iterator i = reached.begin(); i != reached.end(); ++i ) {
+    if ( dawg.contains_word( *i ) )
+      results->push_back( *i );
+  }
+}
+
+static bool before( const std::string& a, const std::string& b ) {
+  return compare_words( a, b ) < 0;
+}
+
+int main( int argc, char** argv ) {
+  unsigned      distance    = 2;
+  size_t        count       = 2000;
+  size_t        slow_count  = 10;
+  unsigned      threads     = 0;
+  int           opt;
+
+  while ( (opt = getopt( argc, argv, "k:n:c:t:" )) != -1 ) {
+    switch ( opt ) {
+      case 'k': distance    = atoi( optarg ); break;
+      case 'n': count       = atoi( optarg ); break;
+      case 'c': slow_count  = atoi( optarg ); break;
+      case 't': threads     = atoi( optarg ); break;
+      default:  usage();
+    }
+  }
+  if ( optind + 2 != argc || count == 0 )
+    usage();
+  if ( slow_count > count )
+    slow_count = count;
+
+  DAWG::DAWG dawg;
+  if ( dawg.map( argv[optind] ) != SUCCESS ) {
+    std::cerr << "dawg_spelling: " << dawg.error() << std::endl;
+    return 1;
+  }
+
+  std::ifstream             in( argv[optind + 1] );
+  std::vector<std::string>  words;
+  std::string               word;
+  std::string               letters;
+  while ( std::getline( in, word ) ) {
+    if ( word.empty() )
+      continue;
+    words.push_back( word );
+    for ( size_t i = 0; i < word.length(); ++i ) {
+      if ( letters.find( word[i] ) == std::string::npos )
+        letters += word[i];
+    }
+  }
+  if ( words.empty() ) {
+    std::cerr << "dawg_spelling: no words in " << argv[optind + 1] << std::endl;
+    return 1;
+  }
+
+  // Random words with up to distance + 1 random edits
+  std::vector<std::string> queries;
+  srand( 1 );
+  for ( size_t q = 0; q < count; ++q ) {
+    std::string query = words[rand() % words.size()];
+    for ( unsigned e = rand() % (distance + 2); e > 0; --e ) {
+      size_t  at      = rand() % (query.length() + 1);
+      char    letter  = letters[rand() % letters.length()];
+      switch ( rand() % 3 ) {
+        case 0:  if ( at < query.length() ) query.erase( at, 1 ); break;
+        case 1:  query.insert( at, 1, letter ); break;
+        default: if ( at < query.length() ) query[at] = letter; break;
+      }
+    }
+    queries.push_back( query );
+  }
+
+  SpellingIndex index;
+  double        start = now();
+  if ( index.build( dawg, distance, 7, threads ) != SUCCESS ) {
+    std::cerr << "dawg_spelling: " << index.error() << std::endl;
+    return 1;
+  }
+  double built = now() - start;
+
+  std::vector< std::vector<std::string> > expected( queries.size() );
+  std::vector<std::string>                results;
+  size_t                                  found = 0, mismatches = 0;
+
+  start = now();
+  for ( size_t q = 0; q < queries.size(); ++q ) {
+    index.lookup( queries[q], &expected[q] );
+    found += expected[q].size();
+  }
+  double indexed = now() - start;
+
+  start = now();
+  for ( size_t q = 0; q < queries.size(); ++q ) {
+    FuzzyQuery query( dawg, queries[q], distance );
+    query.run();
+    mismatches += query.results() != expected[q];
+  }
+  double fuzzy = now() - start;
+
+  start = now();
+  for ( size_t q = 0; q < slow_count; ++q ) {
+    candidates( dawg, queries[q], distance, letters, &results );
+    std::sort( results.begin(), results.end(), before );
+    mismatches += results != expected[q];
+  }
+  double generated = now() - start;
+
+  size_t dictionary = dawg.num_edges() * sizeof(Edge);
+  std::cout << std::fixed << std::setprecision(1)
+            << "queries:        " << queries.size() << ", " << (double)found / queries.size()
+                                  << " words each within " << distance << " edits" << std::endl
+            << "dictionary:     " << dictionary / 1048576.0 << " MB, all FuzzyQuery and candidates need" << std::endl
+            << "index:          " << index.num_deletions() << " deletions, "
+                                  << index.memory() / 1048576.0 << " MB more, built in "
+                                  << built << " s" << std::endl
+            << "SpellingIndex:  " << queries.size() / indexed << " queries/s" << std::endl
+            << "FuzzyQuery:     " << queries.size() / fuzzy << " queries/s" << std::endl;
+  if ( slow_count != 0 )
+    std::cout << "candidates:     " << slow_count / generated << " queries/s, over the first "
+              << slow_count << std::endl;
+  if ( mismatches != 0 ) {
+    std::cerr << "dawg_spelling: " << mismatches << " lookups disagree" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,317 @@
+#include "versions.hh"
+
+namespace DAWG {
+
+  const uint32_t VERSIONS_MAGIC   = 0xC6ACC2E5;             /// Identifies stores we write.
+  const Index    MAX_INDEX        = 0x003FFFFF;             /// Largest edge index a child can point to.
+  const Index    NO_INDEX         = 0xFFFFFFFF;             /// Marks a node that hasn't been added yet.
+  const Index    MIN_REGISTER     = 1024;                   /// Smallest register; always a power of two.
+  const uint64_t FNV_OFFSET       = 0xCBF29CE484222325ULL;  /// Starting value for FNV-1a hashes.
+  const uint64_t FNV_PRIME        = 0x100000001B3ULL;       /// Multiplier for FNV-1a hashes.
+
+  // Hash of a node's edges
+  static uint64_t hash_node( const Edge* edges, Index size ) {
+    uint64_t hash = FNV_OFFSET;
+    for ( Index i = 0; i < size; ++i )
+      hash = (hash ^ edges[i].data()) * FNV_PRIME;
+    return hash ^ (hash >> 32);
+  }
+
+  //----------------------------------------------------------------------------//
+  // VersionStore                                                               //
+  //----------------------------------------------------------------------------//
+
+  // Constructor
+  VersionStore::VersionStore() {
+    clear();
+  }
+
+  // Destructor
+  VersionStore::~VersionStore() {
+    for ( size_t i = 0; i < views_.size(); ++i )
+      delete views_[i];
+  }
+
+  // Remove every version and node
+  void VersionStore::clear() {
+    for ( size_t i = 0; i < views_.size(); ++i )
+      delete views_[i];
+    views_.clear();
+    roots_.clear();
+    edges_.assign( 1, Edge() ); // the null edge
+    register_.assign( MIN_REGISTER, 0 );
+    num_nodes_ = 0;
+  }
+
+  // Look for a node in the register
+  // @return  its first edge, or 0 with the empty slot it would go in
+  Index VersionStore::find_node( const Edge* edges, Index size, Index* slot ) const {
+    Index mask = register_.size() - 1;
+    for ( Index s = hash_node( edges, size ) & mask; ; s = (s + 1) & mask ) {
+      Index start = register_[s];
+      if ( start == 0 ) {
+        *slot = s;
+        return 0;
+      }
+      Index i = 0;
+      while ( i < size && edges_[start + i] == edges[i] )
+        ++i;
+      if ( i == size )
+        return start;
+    }
+  }
+
+  // Put a node in the register, growing it if it gets half full
+  void VersionStore::insert_node( Index start, Index slot ) {
+    register_[slot] = start;
+    if ( ++num_nodes_ * 2 > register_.size() )
+      rebuild_register();
+  }
+
+  // Register every node, skipping root edges
+  void VersionStore::rebuild_register() {
+    std::vector<bool> is_root( edges_.size(), false );
+    for ( size_t v = 0; v < roots_.size(); ++v )
+      is_root[roots_[v]] = true;
+
+    // Every node ends with the only end-of-node edge in it
+    num_nodes_ = 0;
+    for ( Index i = 1; i < edges_.size(); ++i ) {
+      if ( edges_[i].end_of_node() && !is_root[i] )
+        ++num_nodes_;
+    }
+    Index size = MIN_REGISTER;
+    while ( size < num_nodes_ * 4 )
+      size *= 2;
+    register_.assign( size, 0 );
+
+    for ( Index start = 1; start < edges_.size(); ) {
+      if ( is_root[start] ) {
+        ++start;
+        continue;
+      }
+      Index length = 1;
+      while ( !edges_[start + length - 1].end_of_node() )
+        ++length;
+      Index slot;
+      find_node( &edges_[start], length, &slot );
+      register_[slot] = start;
+      start += length;
+    }
+  }
+
+  // Point each version's DAWG at the edges again after they may have moved
+  void VersionStore::update_views() {
+    for ( size_t v = 0; v < views_.size(); ++v ) {
+      if ( views_[v] != NULL )
+        views_[v]->share( &edges_[0], roots_[v] );
+    }
+  }
+
+  // Add a node and everything below it, bottom up, reusing any node already
+  // in the store. added maps the DAWG's nodes to the store's.
+  Status VersionStore::add_node( const DAWG& dawg, Index node, std::vector<Index>* added ) {
+    if ( node == 0 || (*added)[node] != NO_INDEX )
+      return SUCCESS;
+
+    std::vector<Edge> edges;
+    for ( Index i = node; ; ++i ) {
+      Edge edge = *dawg.edge( i );
+      if ( add_node( dawg, edge.child(), added ) != SUCCESS )
+        return FAILURE;
+      if ( edge.child() != 0 )
+        edge.child( (*added)[edge.child()] );
+      edges.push_back( edge );
+      if ( edge.end_of_node() )
+        break;
+    }
+
+    Index slot;
+    Index start = find_node( &edges[0], edges.size(), &slot );
+    if ( start == 0 ) {
+      start = edges_.size();
+      if ( start + edges.size() > MAX_INDEX ) {
+        error_() << "Store would need more than " << MAX_INDEX << " edges";
+        return FAILURE;
+      }
+      edges_.insert( edges_.end(), edges.begin(), edges.end() );
+      insert_node( start, slot );
+    }
+    (*added)[node] = start;
+    return SUCCESS;
+  }
+
+  // Add a version holding the same words as a DAWG
+  Status VersionStore::add_version( const DAWG& dawg, Index* version ) {
+    Index root;
+
+    if ( dawg.num_edges() == 0 || dawg.begin().index() == 0 ) {
+      error_() << "Can't add an empty DAWG";
+      return FAILURE;
+    }
+
+    if ( dawg.edge(0) == &edges_[0] ) {
+      // Already one of ours, so every node is here
+      root = dawg.begin().index();
+    } else {
+      Index               num_edges = edges_.size();
+      std::vector<Index>  added( dawg.num_edges() + 1, NO_INDEX );
+      if ( add_node( dawg, dawg.begin().index(), &added ) != SUCCESS ) {
+        // Forget the nodes added so far
+        edges_.resize( num_edges );
+        rebuild_register();
+        update_views();
+        return FAILURE;
+      }
+      root = added[dawg.begin().index()];
+    }
+
+    roots_.push_back( edges_.size() );
+    edges_.push_back( Edge( 0, false, true, root ) );
+    views_.push_back( new DAWG );
+    update_views();
+
+    *version = roots_.size() - 1;
+    return SUCCESS;
+  }
+
+  // Forget a version
+  Status VersionStore::remove_version( Index version ) {
+    if ( !has_version( version ) ) {
+      error_() << "No version " << version;
+      return FAILURE;
+    }
+    delete views_[version];
+    views_[version] = NULL;
+    return SUCCESS;
+  }
+
+  // Free the nodes no remaining version uses. Every child comes before its
+  // parent, so one pass in order can move nodes down and fix children.
+  void VersionStore::collect() {
+    std::vector<bool>   live( edges_.size(), false );
+    std::vector<Index>  root_of( edges_.size(), NO_INDEX );
+    std::vector<Index>  stack;
+
+    for ( Index v = 0; v < roots_.size(); ++v ) {
+      if ( roots_[v] == 0 )
+        continue;
+      root_of[roots_[v]] = v;
+      if ( views_[v] != NULL )
+        stack.push_back( edges_[roots_[v]].child() );
+    }
+    while ( !stack.empty() ) {
+      Index node = stack.back();
+      stack.pop_back();
+      if ( node == 0 || live[node] )
+        continue;
+      live[node] = true;
+      for ( Index i = node; ; ++i ) {
+        stack.push_back( edges_[i].child() );
+        if ( edges_[i].end_of_node() )
+          break;
+      }
+    }
+
+    std::vector<Edge>   kept( 1, Edge() );
+    std::vector<Index>  moved( edges_.size(), 0 );
+    for ( Index start = 1; start < edges_.size(); ) {
+      if ( root_of[start] != NO_INDEX ) {
+        Index v = root_of[start];
+        if ( views_[v] != NULL ) {
+          roots_[v] = kept.size();
+          kept.push_back( Edge( 0, false, true, moved[edges_[start].child()] ) );
+        } else {
+          roots_[v] = 0;
+        }
+        ++start;
+        continue;
+      }
+
+      bool keep = live[start];
+      if ( keep )
+        moved[start] = kept.size();
+      for ( ; ; ++start ) {
+        Edge edge = edges_[start];
+        if ( keep ) {
+          edge.child( moved[edge.child()] );
+          kept.push_back( edge );
+        }
+        if ( edge.end_of_node() )
+          break;
+      }
+      ++start;
+    }
+
+    edges_.swap( kept );
+    rebuild_register();
+    update_views();
+  }
+
+  // Load a store from a stream
+  Status VersionStore::load( std::istream& input ) {
+    uint32_t    magic           = 0;
+    Index       num_edges       = 0;
+    Index       num_versions    = 0;
+
+    clear();
+    input.read( (char*)&magic, sizeof(magic) );
+    if ( input.gcount() != sizeof(magic) || magic != VERSIONS_MAGIC ) {
+      error_() << "Not a version store";
+      return FAILURE;
+    }
+    input.read( (char*)&num_edges, sizeof(num_edges) );
+    if ( input.gcount() != sizeof(num_edges) || num_edges == 0 || num_edges > MAX_INDEX + 1 ) {
+      error_() << "Couldn't read number of edges";
+      return FAILURE;
+    }
+    edges_.resize( num_edges );
+    input.read( (char*)&edges_[0], sizeof(Edge) * num_edges );
+    input.read( (char*)&num_versions, sizeof(num_versions) );
+    if ( !input.good() ) {
+      error_() << "Store is truncated";
+      clear();
+      return FAILURE;
+    }
+
+    for ( Index v = 0; v < num_versions; ++v ) {
+      Index root = 0;
+      char  live = 0;
+      input.read( (char*)&root, sizeof(root) );
+      input.read( &live, 1 );
+      if ( input.gcount() != 1 || root >= num_edges || (live && root == 0) ) {
+        error_() << "Couldn't read version " << v;
+        clear();
+        return FAILURE;
+      }
+      roots_.push_back( root );
+      views_.push_back( live ? new DAWG : NULL );
+    }
+
+    rebuild_register();
+    update_views();
+    return SUCCESS;
+  }
+
+  // Save the store to a stream
+  Status VersionStore::save( std::ostream& output ) {
+    Index num_edges     = edges_.size();
+    Index num_versions  = roots_.size();
+
+    output.write( (const char*)&VERSIONS_MAGIC, sizeof(VERSIONS_MAGIC) );
+    output.write( (const char*)&num_edges, sizeof(num_edges) );
+    output.write( (const char*)&edges_[0], sizeof(Edge) * num_edges );
+    output.write( (const char*)&num_versions, sizeof(num_versions) );
+    for ( Index v = 0; v < num_versions; ++v ) {
+      char live = views_[v] != NULL;
+      output.write( (const char*)&roots_[v], sizeof(roots_[v]) );
+      output.write( &live, 1 );
+    }
+    if ( output.fail() ) {
+      error_() << "Couldn't write store";
+      return FAILURE;
+    }
+    return SUCCESS;
+  }
+
+}
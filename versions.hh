@@ -0,0 +1,96 @@
+#ifndef _VERSIONS_HH
+#define _VERSIONS_HH 1
+
+#include "dawg.hh"
+#include <vector>
+
+namespace DAWG {
+
+  /// Many versions of a dictionary sharing one set of nodes.
+  ///
+  /// Every node in the store is unique: adding a version minimizes it against
+  /// the nodes already there, so only the nodes it doesn't share with an
+  /// earlier version take up space, plus one root edge. Each version can be
+  /// queried as an ordinary DAWG. Removing a version only forgets its root;
+  /// collect() then frees the nodes no other version uses.
+  class VersionStore {
+    public:
+      /// Default constructor
+      VersionStore();
+
+      /// Destructor
+      ~VersionStore();
+
+      /// Remove every version and node.
+      void clear();
+
+      /// Add a version holding the same words as a DAWG.
+      Status add_version(
+          const DAWG&   dawg,       ///< Words of the new version
+          Index*        version     ///< Receives the number of the version
+      );
+
+      /// Forget a version. Its nodes stay until collect() is called.
+      Status remove_version(
+          Index         version     ///< Number of the version
+      );
+
+      /// Free the nodes no remaining version uses, moving the rest down to
+      /// fill the gaps.
+      void collect();
+
+      /// Whether a version is in the store. Versions are numbered from 0 in
+      /// the order they were added, and keep their numbers when others are
+      /// removed.
+      inline bool has_version(
+          Index version             ///< Number of the version
+      ) const {
+        return version < views_.size() && views_[version] != NULL;
+      }
+
+      /// Number of versions ever added, including removed ones.
+      inline Index num_versions() const { return roots_.size(); }
+
+      /// A version as a DAWG which shares the store's edges. It stays valid
+      /// until the version is removed, but must not be used while the store
+      /// is being changed.
+      inline const DAWG& version(
+          Index version             ///< Number of a version in the store
+      ) const {
+        assert( has_version( version ) );
+        return *views_[version];
+      }
+
+      /// Number of edges in the store, including each version's root edge.
+      inline Index num_edges() const { return edges_.size() - 1; }
+
+      /// Load a store from a stream.
+      Status load(
+          std::istream& input   ///< Stream containing a saved store
+      );
+
+      /// Save the store to a stream.
+      Status save(
+          std::ostream& output  ///< Stream to write to
+      );
+
+      /// Last error message.
+      inline const std::string error() const { return error_.str(); }
+
+    private:
+      std::vector<Edge>     edges_;         ///< Every node, and each version's root edge
+      std::vector<Index>    roots_;         ///< Index of each version's root edge, 0 once collected
+      std::vector<DAWG*>    views_;         ///< Each version as a DAWG, NULL if removed
+      std::vector<Index>    register_;      ///< Hash table of node starts, 0 for empty
+      Index                 num_nodes_;     ///< Nodes in the register
+      Error                 error_;
+
+      Status    add_node( const DAWG& dawg, Index node, std::vector<Index>* added );
+      Index     find_node( const Edge* edges, Index size, Index* slot ) const;
+      void      insert_node( Index start, Index slot );
+      void      rebuild_register();
+      void      update_views();
+  };
+}
+
+#endif /* not _VERSIONS_HH */